@@ -12,7 +12,7 @@
 ----------------------------------------------------------------------------------
 
 
-local function tick(target, ticknumber)
+local function tick_target(target, ticknumber)
     if (ticknumber % 10 == 0) then
         target:say("I have the jumping bug!")
     end
@@ -52,4 +52,10 @@ local function tick(target, ticknumber)
     victim:say("Now I have the jumping bug")
 end
 
+local function tick(targets, ticknumbers)
+    for i, target in ipairs(targets) do
+        tick_target(target, ticknumbers[i])
+    end
+end
+
 get_status_effect("jumping status"):on_tick(tick)
@@ -12,7 +12,7 @@
 --  Software Foundation; either version 2 of the License, or any later version. --
 ----------------------------------------------------------------------------------
 
-local function tick(target, ticknumber)
+local function tick_target(target, ticknumber)
     if (ticknumber % 10 == 0) then
         target:say("I have the plague! :( = " .. ticknumber)
     end
@@ -27,4 +27,10 @@ local function tick(target, ticknumber)
     end
 end
 
+local function tick(targets, ticknumbers)
+    for i, target in ipairs(targets) do
+        tick_target(target, ticknumbers[i])
+    end
+end
+
 get_status_effect("plague"):on_tick(tick)
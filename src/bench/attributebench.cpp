@@ -0,0 +1,200 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench/benchmark.h"
+
+#include "bench/baselineattribute.h"
+#include "common/defines.h"
+#include "game-server/attribute.h"
+#include "game-server/attributemanager.h"
+
+#include <cstdio>
+#include <map>
+#include <vector>
+
+/** The way attributes were stored before the flat table. */
+typedef std::map<unsigned, Baseline::Attribute> TreeAttributes;
+
+static const int DEFAULT_BEING_COUNT = 1000;
+static const int DEFAULT_TICK_COUNT = 1000;
+
+/** Runs of each storage, taking turns, of which the fastest is kept. */
+static const int RUN_COUNT = 5;
+
+/** Each being gets a timed modifier once every so many ticks. */
+static const int MODIFIER_INTERVAL = 10;
+static const int MODIFIER_DURATION = 50;
+
+static Attribute *findAttribute(AttributeMap &attributes, unsigned id)
+{
+    return attributes.find(id);
+}
+
+static Baseline::Attribute *findAttribute(TreeAttributes &attributes,
+                                          unsigned id)
+{
+    TreeAttributes::iterator it = attributes.find(id);
+    return it == attributes.end() ? nullptr : &it->second;
+}
+
+static void createAttributes(AttributeMap &attributes,
+                             const AttributeManager::AttributeScope &scope)
+{
+    for (AttributeManager::AttributeScope::const_iterator it = scope.begin(),
+         it_end = scope.end(); it != it_end; ++it)
+    {
+        attributes.insert(it->first, *it->second);
+    }
+}
+
+static void createAttributes(TreeAttributes &attributes,
+                             const AttributeManager::AttributeScope &scope)
+{
+    for (AttributeManager::AttributeScope::const_iterator it = scope.begin(),
+         it_end = scope.end(); it != it_end; ++it)
+    {
+        attributes.insert(std::make_pair(it->first,
+                                         Baseline::Attribute(*it->second)));
+    }
+}
+
+template <typename Attributes>
+static double getModifiedAttribute(Attributes &attributes, unsigned id)
+{
+    const auto *attribute = findAttribute(attributes, id);
+    return attribute ? attribute->getModifiedAttribute() : 0;
+}
+
+/**
+ * The baseline ticked the modifiers of every attribute of a being at each of
+ * its updates.
+ */
+static void expireModifiers(TreeAttributes &attributes, int)
+{
+    for (TreeAttributes::iterator it = attributes.begin(),
+         it_end = attributes.end(); it != it_end; ++it)
+    {
+        it->second.tick();
+    }
+}
+
+/**
+ * The flat table only looks at the attributes whose modifiers expire, which
+ * the being finds at the top of its heap.
+ */
+static void expireModifiers(AttributeMap &attributes, int tick)
+{
+    if (Attribute *defense = attributes.find(ATTR_DEFENSE))
+        defense->expire(tick);
+}
+
+static void addModifier(Baseline::Attribute *attribute, int)
+{
+    attribute->add(MODIFIER_DURATION, 1, 0);
+}
+
+static void addModifier(Attribute *attribute, int tick)
+{
+    attribute->add(tick + MODIFIER_DURATION, 1, 0);
+}
+
+/**
+ * Runs the ticks on the given storage. The reads follow those done for a
+ * being fighting while it walks: the move speed at the start of its update,
+ * twice per step and when informing the characters around, then the
+ * attributes used to resolve a hit and report the damage.
+ *
+ * @returns the elapsed time, in milliseconds.
+ */
+template <typename Attributes>
+static double runTicks(int beingCount, int ticks, double &sum)
+{
+    const AttributeManager::AttributeScope &scope =
+            attributeManager->getAttributeScope(BeingScope);
+
+    std::vector<Attributes> beings(beingCount);
+    for (int i = 0; i < beingCount; ++i)
+        createAttributes(beings[i], scope);
+
+    const bool defenseHasLayers =
+            scope.count(ATTR_DEFENSE) &&
+            !scope.find(ATTR_DEFENSE)->second->modifiers.empty();
+
+    const Stopwatch stopwatch;
+    for (int tick = 1; tick <= ticks; ++tick)
+    {
+        for (int i = 0; i < beingCount; ++i)
+        {
+            Attributes &attributes = beings[i];
+
+            expireModifiers(attributes, tick);
+
+            sum += getModifiedAttribute(attributes, ATTR_MOVE_SPEED_TPS);
+            sum += getModifiedAttribute(attributes, ATTR_MOVE_SPEED_TPS);
+            sum += getModifiedAttribute(attributes, ATTR_MOVE_SPEED_TPS);
+            sum += getModifiedAttribute(attributes, ATTR_MOVE_SPEED_TPS);
+
+            sum += getModifiedAttribute(attributes, ATTR_ACCURACY);
+            sum += getModifiedAttribute(attributes, ATTR_DODGE);
+            sum += getModifiedAttribute(attributes, ATTR_DEFENSE);
+            sum += getModifiedAttribute(attributes, ATTR_HP);
+            sum += getModifiedAttribute(attributes, ATTR_MAX_HP);
+
+            if (defenseHasLayers && (tick + i) % MODIFIER_INTERVAL == 0)
+                addModifier(findAttribute(attributes, ATTR_DEFENSE), tick);
+        }
+    }
+    return stopwatch.elapsed();
+}
+
+int runAttributeBenchmark(const BenchmarkOptions &options)
+{
+    const int beingCount = options.count ? options.count : DEFAULT_BEING_COUNT;
+    const int ticks = options.ticks ? options.ticks : DEFAULT_TICK_COUNT;
+
+    printf("%d beings with %u attributes, %d ticks\n", beingCount,
+           (unsigned) attributeManager->getAttributeScope(BeingScope).size(),
+           ticks);
+
+    // Printed so that the reads cannot be optimized away
+    double sum = 0;
+
+    // Taking turns spreads the noise of the machine over both storages
+    double tree = 0, flat = 0;
+    for (int run = 0; run < RUN_COUNT; ++run)
+    {
+        const double treeRun = runTicks<TreeAttributes>(beingCount, ticks,
+                                                        sum);
+        const double flatRun = runTicks<AttributeMap>(beingCount, ticks, sum);
+        if (run == 0 || treeRun < tree)
+            tree = treeRun;
+        if (run == 0 || flatRun < flat)
+            flat = flatRun;
+    }
+
+    const double beingTicks = (double) beingCount * ticks;
+    printf("%-20s %10.1f ms %10.1f ns/being/tick\n", "Baseline", tree,
+           tree * 1000000 / beingTicks);
+    printf("%-20s %10.1f ms %10.1f ns/being/tick  (%.2f times faster)\n",
+           "Flat table", flat, flat * 1000000 / beingTicks, tree / flat);
+
+    printf("(checksum %g)\n", sum);
+    return EXIT_NORMAL;
+}
@@ -0,0 +1,318 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench/baselineattribute.h"
+
+#include <cassert>
+
+namespace Baseline {
+
+AttributeModifiersEffect::AttributeModifiersEffect(StackableType stackableType,
+                                                   ModifierEffectType effectType) :
+    mCacheVal(0),
+    mMod(effectType == Multiplicative ? 1 : 0),
+    mStackableType(stackableType),
+    mEffectType(effectType)
+{
+}
+
+bool AttributeModifiersEffect::add(unsigned short duration,
+                                   double value,
+                                   double prevLayerValue,
+                                   int level)
+{
+    bool ret = false;
+    mStates.push_back(new AttributeModifierState(duration, value, level));
+    switch (mStackableType) {
+    case Stackable:
+        switch (mEffectType) {
+        case Additive:
+            if (value)
+            {
+                ret = true;
+                mMod += value;
+                mCacheVal = prevLayerValue + mMod;
+            }
+            break;
+        case Multiplicative:
+            if (value != 1)
+            {
+                ret = true;
+                mMod *= value;
+                mCacheVal = prevLayerValue * mMod;
+            }
+            break;
+        default:
+            assert(0);
+            break;
+        }
+        break;
+    case NonStackable:
+        switch (mEffectType) {
+        case Additive:
+            if (value > mMod)
+            {
+                ret = true;
+                mMod = value;
+                if (mMod > prevLayerValue)
+                    mCacheVal = mMod;
+            }
+            break;
+        default:
+            assert(0);
+        }
+        break;
+    case NonStackableBonus:
+        switch (mEffectType) {
+        case Additive:
+        case Multiplicative:
+            if (value > mMod)
+            {
+                ret = true;
+                mMod = value;
+                mCacheVal = mEffectType == Additive ? prevLayerValue + mMod
+                                              : prevLayerValue * mMod;
+            }
+            break;
+        default:
+            assert(0);
+        }
+        break;
+    default:
+        assert(0);
+    }
+    return ret;
+}
+
+bool durationCompare(const AttributeModifierState *lhs,
+                     const AttributeModifierState *rhs)
+{
+    return lhs->mDuration < rhs->mDuration;
+}
+
+bool AttributeModifiersEffect::remove(double value, unsigned id,
+                                      bool fullCheck)
+{
+    if (!fullCheck)
+        mStates.sort(durationCompare);
+    bool ret = false;
+
+    for (std::list< AttributeModifierState * >::iterator it = mStates.begin();
+         it != mStates.end() && (fullCheck || !(*it)->mDuration);)
+    {
+        if ((*it)->mValue != value || (*it)->mId != id)
+        {
+            ++it;
+            continue;
+        }
+
+        delete *it;
+        mStates.erase(it++);
+
+        if (mStackableType == Stackable)
+            updateMod(value);
+
+        ret = true;
+        if (!id)
+            break;
+    }
+    if (ret && mStackableType != Stackable)
+        updateMod();
+    return ret;
+}
+
+void AttributeModifiersEffect::updateMod(double value)
+{
+    if (mStackableType == Stackable)
+    {
+        if (mEffectType == Additive)
+        {
+            mMod -= value;
+        }
+        else if (mEffectType == Multiplicative)
+        {
+            if (value)
+                mMod /= value;
+            else
+            {
+                mMod = 1;
+                for (std::list< AttributeModifierState * >::const_iterator
+                     it = mStates.begin(),
+                     it_end = mStates.end();
+                    it != it_end;
+                    ++it)
+                    mMod *= (*it)->mValue;
+            }
+        }
+    }
+    else if (mStackableType == NonStackable || mStackableType == NonStackableBonus)
+    {
+        if (mMod == value)
+        {
+            mMod = 0;
+            for (std::list< AttributeModifierState * >::const_iterator
+                 it = mStates.begin(),
+                 it_end = mStates.end();
+                it != it_end;
+                ++it)
+                if ((*it)->mValue > mMod)
+                    mMod = (*it)->mValue;
+        }
+    }
+}
+
+bool AttributeModifiersEffect::recalculateModifiedValue(double newPrevLayerValue)
+{
+    double oldValue = mCacheVal;
+    switch (mEffectType) {
+        case Additive:
+            switch (mStackableType) {
+            case Stackable:
+            case NonStackableBonus:
+                mCacheVal = newPrevLayerValue + mMod;
+            break;
+            case NonStackable:
+                mCacheVal = newPrevLayerValue < mMod ? mMod : newPrevLayerValue;
+            break;
+            default:
+            assert(0);
+        } break;
+        case Multiplicative:
+            mCacheVal = newPrevLayerValue * mMod;
+        break;
+        default:
+        assert(0);
+    }
+    return oldValue != mCacheVal;
+}
+
+bool AttributeModifiersEffect::tick()
+{
+    bool ret = false;
+    std::list<AttributeModifierState *>::iterator it = mStates.begin();
+    while (it != mStates.end())
+    {
+        if ((*it)->tick())
+        {
+            double value = (*it)->mValue;
+            delete *it;
+            mStates.erase(it++);
+            updateMod(value);
+            ret = true;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return ret;
+}
+
+Attribute::Attribute(const AttributeManager::AttributeInfo &info):
+    mBase(0),
+    mMinValue(info.minimum),
+    mMaxValue(info.maximum)
+{
+    const std::vector<AttributeModifier> &modifiers = info.modifiers;
+    for (unsigned i = 0; i < modifiers.size(); ++i)
+    {
+        mMods.push_back(new AttributeModifiersEffect(modifiers[i].stackableType,
+                                                     modifiers[i].effectType));
+    }
+    mBase = checkBounds(mBase);
+}
+
+bool Attribute::add(unsigned short duration, double value,
+                    unsigned layer, int id)
+{
+    assert(mMods.size() > layer);
+    if (mMods.at(layer)->add(duration, value,
+                            (layer ? mMods.at(layer - 1)->getCachedModifiedValue()
+                                   : mBase)
+                            , id))
+    {
+        while (++layer < mMods.size())
+        {
+            if (!mMods.at(layer)->recalculateModifiedValue(
+                       mMods.at(layer - 1)->getCachedModifiedValue()))
+                return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool Attribute::remove(double value, unsigned layer,
+                       int lvl, bool fullcheck)
+{
+    assert(mMods.size() > layer);
+    if (mMods.at(layer)->remove(value, lvl, fullcheck))
+    {
+        for (; layer < mMods.size(); ++layer)
+            if (!mMods.at(layer)->recalculateModifiedValue(
+                        layer ? mMods.at(layer - 1)->getCachedModifiedValue()
+                              : mBase))
+               return false;
+        return true;
+    }
+    return false;
+}
+
+bool Attribute::tick()
+{
+    bool ret = false;
+    double prev = mBase;
+    for (std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin(),
+        it_end = mMods.end(); it != it_end; ++it)
+    {
+        if ((*it)->tick())
+            ret = true;
+        if (ret)
+            if (!(*it)->recalculateModifiedValue(prev)) ret = false;
+        prev = (*it)->getCachedModifiedValue();
+    }
+    return ret;
+}
+
+void Attribute::setBase(double base)
+{
+    base = checkBounds(base);
+    double prev = mBase = base;
+
+    std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin();
+    while (it != mMods.end())
+    {
+        if ((*it)->recalculateModifiedValue(prev))
+            prev = (*it++)->getCachedModifiedValue();
+        else
+            break;
+    }
+}
+
+double Attribute::checkBounds(double baseValue) const
+{
+    if (baseValue > mMaxValue)
+        baseValue = mMaxValue;
+    else if (baseValue < mMinValue)
+        baseValue = mMinValue;
+    return baseValue;
+}
+
+} // namespace Baseline
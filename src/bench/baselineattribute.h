@@ -0,0 +1,120 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCH_BASELINEATTRIBUTE_H
+#define BENCH_BASELINEATTRIBUTE_H
+
+#include "game-server/attributemanager.h"
+
+#include <list>
+#include <vector>
+
+/**
+ * The attribute code of the game server before its layers were stored inline
+ * and their modifiers expired from a heap, kept to benchmark against it. Each
+ * layer is allocated on its own, with a list of allocated modifiers, and
+ * every modifier is ticked. The debug logs are left out, and ticking no
+ * longer skips the modifier following an expired one.
+ */
+namespace Baseline {
+
+class AttributeModifierState
+{
+    public:
+        AttributeModifierState(unsigned short duration,
+                               double value,
+                               unsigned id)
+            : mDuration(duration)
+            , mValue(value)
+            , mId(id)
+        {}
+
+        bool tick() { return mDuration ? !--mDuration : false; }
+
+    private:
+        unsigned short mDuration;
+        const double mValue;
+        const unsigned mId;
+        friend bool durationCompare(const AttributeModifierState*,
+                                    const AttributeModifierState*);
+        friend class AttributeModifiersEffect;
+};
+
+class AttributeModifiersEffect
+{
+    public:
+        AttributeModifiersEffect(StackableType stackableType,
+                                 ModifierEffectType effectType);
+
+        bool add(unsigned short duration, double value,
+                 double prevLayerValue, int level);
+
+        bool remove(double value, unsigned id, bool fullCheck);
+
+        void updateMod(double value = 0);
+
+        bool recalculateModifiedValue(double newPrevLayerValue);
+
+        double getCachedModifiedValue() const { return mCacheVal; }
+
+        bool tick();
+
+    private:
+        std::list<AttributeModifierState *> mStates;
+        double mCacheVal;
+        double mMod;
+        const StackableType mStackableType;
+        const ModifierEffectType mEffectType;
+};
+
+/**
+ * As the baseline, copies share their layers and nothing is deleted.
+ */
+class Attribute
+{
+    public:
+        Attribute(const AttributeManager::AttributeInfo &info);
+
+        void setBase(double base);
+        double getBase() const { return mBase; }
+
+        double getModifiedAttribute() const
+        { return mMods.empty() ? mBase :
+                                 (*mMods.rbegin())->getCachedModifiedValue(); }
+
+        bool add(unsigned short duration, double value, unsigned layer,
+                 int id = 0);
+
+        bool remove(double value, unsigned layer, int id, bool fullcheck);
+
+        bool tick();
+
+    private:
+        double checkBounds(double baseValue) const;
+
+        double mBase;
+        double mMinValue;
+        double mMaxValue;
+        std::vector<AttributeModifiersEffect *> mMods;
+};
+
+} // namespace Baseline
+
+#endif // BENCH_BASELINEATTRIBUTE_H
@@ -0,0 +1,165 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+class Entity;
+class Map;
+class MapComposite;
+
+/**
+ * Options of the benchmarks, given on the command line of manaserv-bench.
+ * Each benchmark only looks at the options it needs.
+ */
+struct BenchmarkOptions
+{
+    BenchmarkOptions():
+        mapWidth(300),
+        mapHeight(250),
+        wallPercent(15),
+        seed(1),
+        count(0),
+        ticks(0),
+        range(32),
+        characters(-1)
+    {}
+
+    std::string configPath;
+    std::string mapFile;        /**< TMX map, or empty to generate one. */
+    int mapWidth, mapHeight;    /**< Size of the generated map, in tiles. */
+    int wallPercent;            /**< Walls on the generated map. */
+    unsigned seed;              /**< Seed of everything chosen at random. */
+    std::string pairsFile;      /**< Recorded start/destination pairs. */
+    std::string recordFile;     /**< Where to save the pairs used. */
+    int count;                  /**< Pairs, beings or monsters, 0: default. */
+    int ticks;                  /**< Ticks to run, 0: default. */
+    int range;                  /**< Distance to a target, in tiles. */
+    int characters;             /**< Characters, -1: default. */
+    std::string threads;        /**< Update threads to compare, "1,2,4". */
+};
+
+/**
+ * Measures the time elapsed since it was started.
+ */
+class Stopwatch
+{
+    public:
+        Stopwatch():
+            mStart(std::chrono::steady_clock::now())
+        {}
+
+        /** Elapsed time, in milliseconds. */
+        double elapsed() const
+        {
+            const std::chrono::duration<double, std::milli> time =
+                    std::chrono::steady_clock::now() - mStart;
+            return time.count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point mStart;
+};
+
+/**
+ * Loads the map given with --map, or generates one with randomly placed
+ * walls. Returns a null pointer when the map cannot be read.
+ */
+Map *loadBenchmarkMap(const BenchmarkOptions &options);
+
+/**
+ * Loads the data of the game server as it does on startup, without
+ * connecting to the account server. Needed by the benchmarks using beings.
+ */
+void initializeWorld(const BenchmarkOptions &options);
+
+/**
+ * Activates the maps of the world and fills them with monsters and connected
+ * characters, then lets them settle for a few ticks. Returns EXIT_NORMAL, or
+ * the exit code of the error.
+ */
+int populateWorld(int monsterCount, int characterCount,
+                  std::vector<MapComposite *> &maps,
+                  std::vector<Entity *> &characters, int &tick);
+
+/**
+ * Lets the characters that stand still walk somewhere close.
+ */
+void walkCharacters(const std::vector<Entity *> &characters);
+
+/**
+ * Amount of memory allocations done by the program so far.
+ */
+unsigned long getAllocationCount();
+
+/**
+ * Replays start/destination pairs with each of the tile pathfinders: plain
+ * A*, jump point search and the cluster graph.
+ */
+int runPathBenchmark(const BenchmarkOptions &options);
+
+/**
+ * Lets packs of beings chase targets, each being searching its own path or
+ * following a flow field shared with the rest of its pack.
+ */
+int runChaseBenchmark(const BenchmarkOptions &options);
+
+/**
+ * Runs combat-like attribute reads and modifier updates on a set of beings,
+ * using the flat attribute table and the attribute code of the baseline.
+ * Both storages run several times, taking turns, and the fastest run of
+ * each is kept.
+ */
+int runAttributeBenchmark(const BenchmarkOptions &options);
+
+/**
+ * Fills the maps of the world with monsters and connected characters, and
+ * measures the world update with different amounts of update threads. The
+ * threads only inform the characters, or update the maps too. The latter
+ * needs a world with several maps.
+ */
+int runWorldBenchmark(const BenchmarkOptions &options);
+
+/**
+ * Fills the maps of the world like the world benchmark, and measures the
+ * allocations and the time of the ticks and of queries around every being.
+ */
+int runZoneBenchmark(const BenchmarkOptions &options);
+
+/**
+ * Lets aggressive monsters attack characters that are healed every tick,
+ * and measures the ticks, the hits and the allocations. Every hit applies a
+ * timed modifier to the character. Also prints the size of the entity and
+ * of its components.
+ */
+int runCombatBenchmark(const BenchmarkOptions &options);
+
+/**
+ * Fills the maps of the world like the world benchmark, with every monster
+ * thinking, and measures the ticks updating the components entity by entity
+ * and type by type, taking turns.
+ */
+int runComponentBenchmark(const BenchmarkOptions &options);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,168 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench/benchmark.h"
+
+#include "common/configuration.h"
+#include "common/defines.h"
+#include "game-server/map.h"
+#include "game-server/pathqueue.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const int DEFAULT_CHASER_COUNT = 64;
+static const int DEFAULT_TARGET_COUNT = 300;
+
+/**
+ * A pack of beings around a target, all asking for a path to a tile next to
+ * it, like monsters do when they attack the same character.
+ */
+struct Chase
+{
+    Point target;
+    std::vector<Point> chasers;
+    std::vector<Point> destinations;
+};
+
+static void generateChases(const Map *map, const BenchmarkOptions &options,
+                           std::vector<Chase> &chases)
+{
+    const int chaserCount = options.count ? options.count
+                                          : DEFAULT_CHASER_COUNT;
+    const int targetCount = options.ticks ? options.ticks
+                                          : DEFAULT_TARGET_COUNT;
+    const unsigned char walkmask = Map::BLOCKMASK_WALL;
+    const int range = options.range;
+    std::mt19937 random(options.seed);
+
+    while ((int) chases.size() < targetCount)
+    {
+        Chase chase;
+        chase.target.x = random() % map->getWidth();
+        chase.target.y = random() % map->getHeight();
+        if (!map->getWalk(chase.target.x, chase.target.y, walkmask))
+            continue;
+
+        // Give up on targets that are walled in
+        for (int attempt = 0; attempt < chaserCount * 10 &&
+             (int) chase.chasers.size() < chaserCount; ++attempt)
+        {
+            const Point chaser(chase.target.x + random() % (2 * range + 1)
+                                              - range,
+                               chase.target.y + random() % (2 * range + 1)
+                                              - range);
+
+            // Attack from one of the four sides of the target
+            const int side = chase.chasers.size() % 4;
+            const Point destination(chase.target.x + (side == 0) - (side == 1),
+                                    chase.target.y + (side == 2) - (side == 3));
+
+            if (chaser == chase.target ||
+                    !map->getWalk(chaser.x, chaser.y, walkmask) ||
+                    !map->getWalk(destination.x, destination.y, walkmask))
+                continue;
+
+            chase.chasers.push_back(chaser);
+            chase.destinations.push_back(destination);
+        }
+
+        if ((int) chase.chasers.size() == chaserCount)
+            chases.push_back(chase);
+    }
+}
+
+/**
+ * Searches the paths of every chase in order, the target standing on its
+ * tile meanwhile. The paths are searched like the server does, unless a
+ * cost limit is given for the tile pathfinder.
+ *
+ * @returns the elapsed time, in milliseconds.
+ */
+static double runChases(Map *map, const std::vector<Chase> &chases,
+                        int maxCost, int &found)
+{
+    PathRequest request;
+    request.map = map;
+    request.walkmask = Map::BLOCKMASK_WALL | Map::BLOCKMASK_CHARACTER;
+    request.maxCost = 0;
+    request.followsFlowField = true;
+
+    found = 0;
+    const Stopwatch stopwatch;
+    for (std::vector<Chase>::const_iterator it = chases.begin(),
+         it_end = chases.end(); it != it_end; ++it)
+    {
+        map->blockTile(it->target.x, it->target.y, BLOCKTYPE_CHARACTER);
+        request.flowTarget = it->target;
+
+        for (unsigned i = 0; i < it->chasers.size(); ++i)
+        {
+            request.start = it->chasers[i];
+            request.dest = it->destinations[i];
+            const Path path = maxCost ?
+                    map->findPath(request.start.x, request.start.y,
+                                  request.dest.x, request.dest.y,
+                                  request.walkmask, maxCost) :
+                    request.search();
+            if (!path.empty())
+                ++found;
+        }
+
+        map->freeTile(it->target.x, it->target.y, BLOCKTYPE_CHARACTER);
+    }
+    return stopwatch.elapsed();
+}
+
+int runChaseBenchmark(const BenchmarkOptions &options)
+{
+    Map *map = loadBenchmarkMap(options);
+    if (!map)
+        return EXIT_MAP_FILE_NOT_FOUND;
+
+    std::vector<Chase> chases;
+    generateChases(map, options, chases);
+
+    printf("Map of %dx%d tiles, %u targets with %u chasers within %d tiles\n",
+           map->getWidth(), map->getHeight(), (unsigned) chases.size(),
+           (unsigned) chases.front().chasers.size(), options.range);
+
+    const unsigned searches = chases.size() * chases.front().chasers.size();
+    int found;
+
+    // The tile pathfinder alone, allowed to walk around the walls in range
+    Configuration::setValue("game_flowFields", "0");
+    const double tiles = runChases(map, chases, options.range * 2, found);
+    printf("%-20s %10.1f ms %10.1f us/search %8d found\n", "Tile pathfinder",
+           tiles, tiles * 1000 / searches, found);
+
+    const double direct = runChases(map, chases, 0, found);
+    printf("%-20s %10.1f ms %10.1f us/search %8d found\n", "Direct searches",
+           direct, direct * 1000 / searches, found);
+
+    Configuration::setValue("game_flowFields", "1");
+    const double fields = runChases(map, chases, 0, found);
+    printf("%-20s %10.1f ms %10.1f us/search %8d found\n", "Flow fields",
+           fields, fields * 1000 / searches, found);
+
+    delete map;
+    return EXIT_NORMAL;
+}
@@ -0,0 +1,187 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench/benchmark.h"
+
+#include "common/configuration.h"
+#include "common/defines.h"
+#include "game-server/being.h"
+#include "game-server/character.h"
+#include "game-server/combatcomponent.h"
+#include "game-server/mapcomposite.h"
+#include "game-server/monster.h"
+#include "game-server/monstermanager.h"
+#include "game-server/state.h"
+#include "utils/event.h"
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+static const int DEFAULT_CHARACTER_COUNT = 200;
+static const int DEFAULT_TICK_COUNT = 200;
+
+/** Monsters placed on each character. */
+static const int MONSTERS_PER_CHARACTER = 4;
+
+/** Each hit lowers the defense of the character for so many ticks. */
+static const int DEFENSE_MALUS_DURATION = 50;
+
+/** Ticks letting the monsters find their target before measuring. */
+static const int WARM_UP_TICKS = 20;
+
+static unsigned long hits = 0;
+static unsigned long damageDealt = 0;
+
+/**
+ * A character being attacked. It counts the hits it takes and heals right
+ * away, so that it keeps being attacked instead of dying and waiting for a
+ * respawn. Each hit also applies a timed modifier, so that the attribute
+ * layers get to expire modifiers during the ticks.
+ */
+class Target
+{
+    public:
+        Target():
+            mCharacter(nullptr)
+        {}
+
+        void connect(Entity *character)
+        {
+            mCharacter = character;
+            mDamagedListener.connect<Target, &Target::damaged>(
+                    character->getComponent<CombatComponent>()->signal_damaged,
+                    this);
+        }
+
+    private:
+        void damaged(Entity *, const Damage &, int damage)
+        {
+            ++hits;
+            damageDealt += damage;
+
+            auto *beingComponent = mCharacter->getComponent<BeingComponent>();
+            beingComponent->applyModifier(*mCharacter, ATTR_DEFENSE, -1, 0,
+                                          DEFENSE_MALUS_DURATION);
+            beingComponent->setAttribute(
+                    *mCharacter, ATTR_HP,
+                    beingComponent->getModifiedAttribute(ATTR_MAX_HP));
+        }
+
+        Entity *mCharacter;
+        utils::EventListener<Entity *, const Damage &, int> mDamagedListener;
+};
+
+static void createMonster(MonsterClass *specy, const Entity &character)
+{
+    Entity *monster = new Entity(OBJECT_MONSTER);
+    auto *actorComponent = new ActorComponent(*monster);
+    monster->addComponent(actorComponent);
+    monster->addComponent(new BeingComponent(*monster));
+    monster->addComponent(new MonsterComponent(*monster, specy));
+    monster->setMap(character.getMap());
+    actorComponent->setPosition(
+            *monster, character.getComponent<ActorComponent>()->getPosition());
+    GameState::enqueueInsert(monster);
+}
+
+int runCombatBenchmark(const BenchmarkOptions &options)
+{
+    const int characterCount = options.characters >= 0 ?
+            options.characters : DEFAULT_CHARACTER_COUNT;
+    const int ticks = options.ticks ? options.ticks : DEFAULT_TICK_COUNT;
+
+    // Keep every map awake, and the whole tick on this thread
+    Configuration::setValue("game_hibernationRate", "1");
+    Configuration::setValue("game_pathSearchTime", "0");
+    Configuration::setValue("game_updateThreads", "1");
+
+    MonsterClass *specy = nullptr;
+    for (int id = 1; MonsterClass *s = monsterManager->getMonster(id); ++id)
+    {
+        if (s->isAggressive())
+        {
+            specy = s;
+            break;
+        }
+    }
+    if (!specy)
+    {
+        std::cerr << "No aggressive monster class found" << std::endl;
+        return EXIT_BAD_CONFIG_PARAMETER;
+    }
+
+    // The example monsters wait further away than their attacks reach
+    const std::vector<AttackInfo *> &attacks = specy->getAttackInfos();
+    for (std::vector<AttackInfo *>::const_iterator it = attacks.begin(),
+         it_end = attacks.end(); it != it_end; ++it)
+    {
+        const unsigned range = (*it)->getDamage().range;
+        if (specy->getAttackDistance() > range)
+            specy->setAttackDistance(range);
+    }
+
+    std::vector<MapComposite *> maps;
+    std::vector<Entity *> characters;
+    int tick = 0;
+    if (int result = populateWorld(0, characterCount, maps, characters, tick))
+        return result;
+
+    // Sized once, as the targets are listening from where they are
+    std::vector<Target> targets(characters.size());
+    for (unsigned i = 0; i < characters.size(); ++i)
+    {
+        for (int j = 0; j < MONSTERS_PER_CHARACTER; ++j)
+            createMonster(specy, *characters[i]);
+        targets[i].connect(characters[i]);
+    }
+
+    for (int i = 0; i < WARM_UP_TICKS; ++i)
+        GameState::update(++tick);
+    hits = 0;
+    damageDealt = 0;
+
+    double tickTime = 0;
+    unsigned long allocations = 0;
+    for (int i = 0; i < ticks; ++i)
+    {
+        const unsigned long allocationsBefore = getAllocationCount();
+        const Stopwatch stopwatch;
+        GameState::update(++tick);
+        tickTime += stopwatch.elapsed();
+        allocations += getAllocationCount() - allocationsBefore;
+    }
+
+    printf("%u maps, %u characters, %u monsters, %d ticks\n",
+           (unsigned) maps.size(), (unsigned) characters.size(),
+           (unsigned) characters.size() * MONSTERS_PER_CHARACTER, ticks);
+    printf("%10.3f ms/tick %10.1f hits/tick %10.1f damage/tick "
+           "%10.1f allocations/tick\n",
+           tickTime / ticks, (double) hits / ticks,
+           (double) damageDealt / ticks, (double) allocations / ticks);
+    printf("Sizes in bytes: Entity %u, ActorComponent %u, BeingComponent %u, "
+           "CombatComponent %u, CharacterComponent %u, MonsterComponent %u\n",
+           (unsigned) sizeof(Entity), (unsigned) sizeof(ActorComponent),
+           (unsigned) sizeof(BeingComponent),
+           (unsigned) sizeof(CombatComponent),
+           (unsigned) sizeof(CharacterComponent),
+           (unsigned) sizeof(MonsterComponent));
+    return EXIT_NORMAL;
+}
@@ -0,0 +1,95 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench/benchmark.h"
+
+#include "common/configuration.h"
+#include "common/defines.h"
+#include "game-server/mapcomposite.h"
+#include "game-server/state.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+static const int DEFAULT_MONSTER_COUNT = 5000;
+static const int DEFAULT_CHARACTER_COUNT = 200;
+static const int DEFAULT_TICK_COUNT = 200;
+
+/**
+ * Both ways of updating take turns every so many ticks, so that the world
+ * changing over time does not favor one of them.
+ */
+static const int TURN_TICKS = 10;
+
+int runComponentBenchmark(const BenchmarkOptions &options)
+{
+    const int monsterCount = options.count ? options.count
+                                           : DEFAULT_MONSTER_COUNT;
+    const int characterCount = options.characters >= 0 ?
+            options.characters : DEFAULT_CHARACTER_COUNT;
+    const int ticks = options.ticks ? options.ticks : DEFAULT_TICK_COUNT;
+
+    // Keep every map awake and every monster thinking, on this thread
+    Configuration::setValue("game_hibernationRate", "1");
+    Configuration::setValue("game_pathSearchTime", "0");
+    Configuration::setValue("game_updateThreads", "1");
+    Configuration::setValue("game_aiSleepRange", "0");
+
+    std::vector<MapComposite *> maps;
+    std::vector<Entity *> characters;
+    int tick = 0;
+    if (int result = populateWorld(monsterCount, characterCount, maps,
+                                   characters, tick))
+        return result;
+
+    printf("%u maps, %d monsters, %u characters, %d ticks per setting\n",
+           (unsigned) maps.size(), monsterCount, (unsigned) characters.size(),
+           ticks);
+
+    // Entity by entity, then type by type
+    double times[2] = { 0, 0 };
+    double maxTimes[2] = { 0, 0 };
+    for (int turn = 0; turn < 2 * ticks / TURN_TICKS; ++turn)
+    {
+        const int batched = turn % 2;
+        Configuration::setValue("game_batchComponentUpdates",
+                                batched ? "true" : "false");
+
+        for (int i = 0; i < TURN_TICKS; ++i)
+        {
+            walkCharacters(characters);
+
+            const Stopwatch stopwatch;
+            GameState::update(++tick);
+            const double time = stopwatch.elapsed();
+
+            times[batched] += time;
+            maxTimes[batched] = std::max(maxTimes[batched], time);
+        }
+    }
+
+    const int measuredTicks = ticks / TURN_TICKS * TURN_TICKS;
+    printf("%-20s %10.3f ms/tick %10.3f ms max\n", "Entity by entity",
+           times[0] / measuredTicks, maxTimes[0]);
+    printf("%-20s %10.3f ms/tick %10.3f ms max %8.2fx\n", "Type by type",
+           times[1] / measuredTicks, maxTimes[1], times[0] / times[1]);
+    return EXIT_NORMAL;
+}
@@ -0,0 +1,326 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench/benchmark.h"
+
+#include "common/configuration.h"
+#include "common/defines.h"
+#include "common/permissionmanager.h"
+#include "common/resourcemanager.h"
+#include "game-server/accountconnection.h"
+#include "game-server/attributemanager.h"
+#include "game-server/gamehandler.h"
+#include "game-server/emotemanager.h"
+#include "game-server/itemmanager.h"
+#include "game-server/map.h"
+#include "game-server/mapreader.h"
+#include "game-server/monstermanager.h"
+#include "game-server/skillmanager.h"
+#include "game-server/specialmanager.h"
+#include "game-server/postman.h"
+#include "game-server/settingsmanager.h"
+#include "net/bandwidth.h"
+#include "scripting/scriptmanager.h"
+#include "utils/logger.h"
+#include "utils/mathutils.h"
+#include "utils/processorutils.h"
+#include "utils/stringfilter.h"
+#include "utils/xml.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <iostream>
+#include <physfs.h>
+#include <random>
+
+using utils::Logger;
+
+#define DEFAULT_MAIN_SCRIPT_FILE            "scripts/main.lua"
+
+// The game server code expects the globals of main-game.cpp.
+
+utils::StringFilter *stringFilter;
+
+AttributeManager *attributeManager = new AttributeManager();
+ItemManager *itemManager = new ItemManager();
+MonsterManager *monsterManager = new MonsterManager();
+SkillManager *skillManager = new SkillManager();
+SpecialManager *specialManager = new SpecialManager();
+EmoteManager *emoteManager = new EmoteManager();
+
+SettingsManager *settingsManager = new SettingsManager(DEFAULT_SETTINGS_FILE);
+
+GameHandler *gameHandler;
+AccountConnection *accountHandler;
+PostMan *postMan;
+BandwidthMonitor *gBandwidth;
+
+typedef int (*BenchmarkFunction)(const BenchmarkOptions &options);
+
+struct Benchmark
+{
+    const char *name;
+    BenchmarkFunction run;
+    bool needsWorld;            /**< Whether it needs the game data. */
+    const char *description;
+};
+
+static const Benchmark benchmarks[] =
+{
+    { "paths", runPathBenchmark, false,
+      "Replays path searches with A*, jump point search and the cluster "
+      "graph" },
+    { "chase", runChaseBenchmark, false,
+      "Lets packs of beings chase targets, with and without flow fields" },
+    { "attributes", runAttributeBenchmark, true,
+      "Reads and modifies the attributes of beings like combat does" },
+    { "world", runWorldBenchmark, true,
+      "Updates the world with monsters and characters, comparing the "
+      "amounts of update threads" },
+    { "zones", runZoneBenchmark, true,
+      "Counts the allocations and the time of ticks and zone queries" },
+    { "combat", runCombatBenchmark, true,
+      "Lets monsters attack characters and measures the ticks" },
+    { "components", runComponentBenchmark, true,
+      "Updates the components of a crowded world entity by entity and "
+      "type by type" },
+    { nullptr, nullptr, false, nullptr }
+};
+
+Map *loadBenchmarkMap(const BenchmarkOptions &options)
+{
+    if (!options.mapFile.empty())
+    {
+        // Read the file directly, the map does not have to be in the data
+        XML::Document doc(options.mapFile, false);
+        xmlNodePtr rootNode = doc.rootNode();
+        if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "map"))
+        {
+            LOG_ERROR("Not a map file: " << options.mapFile);
+            return nullptr;
+        }
+        return MapReader::readMap(rootNode);
+    }
+
+    // The same seed gives the same map on every platform
+    std::mt19937 random(options.seed);
+    Map *map = new Map(options.mapWidth, options.mapHeight,
+                       DEFAULT_TILE_LENGTH, DEFAULT_TILE_LENGTH);
+    for (int y = 0; y < options.mapHeight; ++y)
+        for (int x = 0; x < options.mapWidth; ++x)
+            if ((int) (random() % 100) < options.wallPercent)
+                map->blockTile(x, y, BLOCKTYPE_WALL);
+    map->buildClusterGraph();
+    return map;
+}
+
+void initializeWorld(const BenchmarkOptions &options)
+{
+    PHYSFS_init("");
+
+    stringFilter = new utils::StringFilter;
+
+    ResourceManager::initialize();
+    ScriptManager::initialize();   // Depends on ResourceManager
+
+    settingsManager->initialize();
+
+    PermissionManager::initialize(DEFAULT_PERMISSION_FILE);
+
+    std::string mainScript = Configuration::getValue("script_mainFile",
+                                                     DEFAULT_MAIN_SCRIPT_FILE);
+    ScriptManager::loadMainScript(mainScript);
+
+    // Nothing is sent, but the world expects the handlers to exist
+    gameHandler = new GameHandler;
+    accountHandler = new AccountConnection;
+    postMan = new PostMan;
+    gBandwidth = new BandwidthMonitor;
+
+    utils::math::init();
+    utils::processor::init();
+
+    std::srand(options.seed);
+}
+
+static void printHelp()
+{
+    std::cout << "manaserv-bench <benchmark> [options]" << std::endl
+              << std::endl << "Benchmarks:" << std::endl;
+    for (const Benchmark *b = benchmarks; b->name; ++b)
+    {
+        std::cout << "  " << b->name << std::string(12 - strlen(b->name), ' ')
+                  << ": " << b->description
+                  << (b->needsWorld ? " (needs --config)" : "") << std::endl;
+    }
+    std::cout << std::endl
+              << "Options: " << std::endl
+              << "  -h --help          : Display this help" << std::endl
+              << "     --config <path> : Set the config path to use."
+              << " (Default: ./manaserv.xml)" << std::endl
+              << "     --verbosity <n> : Set the verbosity level" << std::endl
+              << "     --map <file>    : TMX map to use. (Default: a"
+              << " generated map)" << std::endl
+              << "     --size <w>x<h>  : Size of the generated map."
+              << " (Default: 300x250)" << std::endl
+              << "     --walls <n>     : Percentage of walls on the"
+              << " generated map. (Default: 15)" << std::endl
+              << "     --seed <n>      : Seed of the random choices."
+              << " (Default: 1)" << std::endl
+              << "     --pairs <file>  : Start/destination pairs to replay,"
+              << " one \"x1 y1 x2 y2\" per line" << std::endl
+              << "     --record <file> : Save the pairs used" << std::endl
+              << "     --count <n>     : Amount of pairs, beings or monsters"
+              << std::endl
+              << "     --characters <n>: Amount of characters. (Default: 200)"
+              << std::endl
+              << "     --threads <list>: Update threads to compare, like"
+              << " \"1,2,4\". (Default: up to the amount of cores)"
+              << std::endl
+              << "     --ticks <n>     : Amount of ticks to run, or of targets"
+              << " to chase" << std::endl
+              << "     --range <n>     : Distance of the chasers to their"
+              << " target, in tiles. (Default: 32)" << std::endl;
+    exit(EXIT_NORMAL);
+}
+
+/**
+ * Parse the command line arguments
+ */
+static void parseOptions(int argc, char *argv[], BenchmarkOptions &options,
+                         Logger::Level &verbosity)
+{
+    const char *optString = "h";
+
+    const struct option longOptions[] =
+    {
+        { "help",       no_argument,       0, 'h' },
+        { "config",     required_argument, 0, 'c' },
+        { "verbosity",  required_argument, 0, 'v' },
+        { "map",        required_argument, 0, 'm' },
+        { "size",       required_argument, 0, 'z' },
+        { "walls",      required_argument, 0, 'w' },
+        { "seed",       required_argument, 0, 's' },
+        { "pairs",      required_argument, 0, 'p' },
+        { "record",     required_argument, 0, 'r' },
+        { "count",      required_argument, 0, 'n' },
+        { "ticks",      required_argument, 0, 't' },
+        { "range",      required_argument, 0, 'g' },
+        { "characters", required_argument, 0, 'a' },
+        { "threads",    required_argument, 0, 'j' },
+        { 0, 0, 0, 0 }
+    };
+
+    // Keep asking until getopt is done, as it only moves the name of the
+    // benchmark after the options once it returns -1.
+    int result;
+    while ((result = getopt_long(argc, argv, optString, longOptions,
+                                 nullptr)) != -1)
+    {
+        switch (result)
+        {
+            default: // Unknown option.
+            case 'h':
+                printHelp();
+                break;
+            case 'c':
+                options.configPath = optarg;
+                break;
+            case 'v':
+                verbosity = static_cast<Logger::Level>(atoi(optarg));
+                break;
+            case 'm':
+                options.mapFile = optarg;
+                break;
+            case 'z':
+                if (sscanf(optarg, "%dx%d", &options.mapWidth,
+                           &options.mapHeight) != 2)
+                    printHelp();
+                break;
+            case 'w':
+                options.wallPercent = atoi(optarg);
+                break;
+            case 's':
+                options.seed = atoi(optarg);
+                break;
+            case 'p':
+                options.pairsFile = optarg;
+                break;
+            case 'r':
+                options.recordFile = optarg;
+                break;
+            case 'n':
+                options.count = atoi(optarg);
+                break;
+            case 't':
+                options.ticks = atoi(optarg);
+                break;
+            case 'g':
+                options.range = atoi(optarg);
+                break;
+            case 'a':
+                options.characters = atoi(optarg);
+                break;
+            case 'j':
+                options.threads = optarg;
+                break;
+        }
+    }
+}
+
+/**
+ * Runs one of the benchmarks of the game server.
+ */
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    Logger::Level verbosity = Logger::Warn;
+    parseOptions(argc, argv, options, verbosity);
+    Logger::setVerbosity(verbosity);
+
+    if (optind >= argc)
+        printHelp();
+
+    const Benchmark *benchmark = benchmarks;
+    while (benchmark->name && strcmp(benchmark->name, argv[optind]) != 0)
+        ++benchmark;
+
+    if (!benchmark->name)
+    {
+        std::cerr << "Unknown benchmark: " << argv[optind] << std::endl;
+        return EXIT_BAD_CONFIG_PARAMETER;
+    }
+
+    // The options matter even without the game data, the defaults are used
+    // when there is no configuration file.
+    if (!Configuration::initialize(options.configPath) &&
+            (benchmark->needsWorld || !options.configPath.empty()))
+    {
+        LOG_FATAL("Refusing to run without configuration!");
+        return EXIT_CONFIG_NOT_FOUND;
+    }
+
+    if (benchmark->needsWorld)
+        initializeWorld(options);
+
+    return benchmark->run(options);
+}
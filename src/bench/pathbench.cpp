@@ -0,0 +1,278 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench/benchmark.h"
+
+#include "common/configuration.h"
+#include "common/defines.h"
+#include "game-server/map.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+struct PathPair
+{
+    Point start;
+    Point dest;
+};
+
+/**
+ * Outcome of replaying all the pairs with one of the pathfinders.
+ */
+struct PathResults
+{
+    PathResults():
+        time(0),
+        pushes(0)
+    {}
+
+    double time;                /**< In milliseconds. */
+    unsigned long pushes;       /**< Tiles put on the open lists. */
+    std::vector<int> costs;     /**< Cost of each path, -1 when not found. */
+};
+
+static const int DEFAULT_PAIR_COUNT = 2000;
+
+static bool readPairs(const std::string &fileName,
+                      std::vector<PathPair> &pairs)
+{
+    std::ifstream file(fileName.c_str());
+    if (!file)
+        return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        PathPair pair;
+        if (fields >> pair.start.x >> pair.start.y
+                   >> pair.dest.x >> pair.dest.y)
+            pairs.push_back(pair);
+    }
+    return true;
+}
+
+static void writePairs(const std::string &fileName,
+                       const std::vector<PathPair> &pairs)
+{
+    std::ofstream file(fileName.c_str());
+    for (std::vector<PathPair>::const_iterator it = pairs.begin(),
+         it_end = pairs.end(); it != it_end; ++it)
+    {
+        file << it->start.x << ' ' << it->start.y << ' '
+             << it->dest.x << ' ' << it->dest.y << '\n';
+    }
+}
+
+/**
+ * Picks pairs of walkable tiles anywhere on the map.
+ */
+static void generatePairs(const Map *map, const BenchmarkOptions &options,
+                          std::vector<PathPair> &pairs)
+{
+    const int count = options.count ? options.count : DEFAULT_PAIR_COUNT;
+    std::mt19937 random(options.seed);
+
+    while ((int) pairs.size() < count)
+    {
+        PathPair pair;
+        pair.start.x = random() % map->getWidth();
+        pair.start.y = random() % map->getHeight();
+        pair.dest.x = random() % map->getWidth();
+        pair.dest.y = random() % map->getHeight();
+        if (map->getWalk(pair.start.x, pair.start.y) &&
+                map->getWalk(pair.dest.x, pair.dest.y))
+            pairs.push_back(pair);
+    }
+}
+
+/**
+ * Cost of a path with the costs of the tile pathfinder, without its tie
+ * breaking defects.
+ */
+static int getPathCost(const Point &start, const Path &path)
+{
+    int cost = 0;
+    Point previous = start;
+    for (Path::const_iterator it = path.begin(), it_end = path.end();
+         it != it_end; ++it)
+    {
+        const bool diagonal = it->x != previous.x && it->y != previous.y;
+        cost += diagonal ? 362 : 256;
+        previous = *it;
+    }
+    return cost * 100 / 256;
+}
+
+template <typename Search>
+static PathResults replay(const std::vector<PathPair> &pairs, Search search)
+{
+    PathResults results;
+    results.costs.reserve(pairs.size());
+
+    const unsigned long pushes = Map::getOpenListPushes();
+    const Stopwatch stopwatch;
+    for (std::vector<PathPair>::const_iterator it = pairs.begin(),
+         it_end = pairs.end(); it != it_end; ++it)
+    {
+        const Path path = search(*it);
+        results.costs.push_back(path.empty() ? -1
+                                             : getPathCost(it->start, path));
+    }
+    results.time = stopwatch.elapsed();
+    results.pushes = Map::getOpenListPushes() - pushes;
+    return results;
+}
+
+static void printResults(const char *name, const PathResults &results)
+{
+    int found = 0;
+    for (unsigned i = 0; i < results.costs.size(); ++i)
+        if (results.costs[i] >= 0)
+            ++found;
+
+    printf("%-20s %10.1f ms %10.1f us/search %8d found\n", name,
+           results.time, results.time * 1000 / results.costs.size(), found);
+}
+
+/**
+ * Prints the tiles put on the open list per search, only meaningful for the
+ * tile searches.
+ */
+static void printPushes(const PathResults &results)
+{
+    printf("%20s %.1f open list pushes/search\n", "",
+           (double) results.pushes / results.costs.size());
+}
+
+/**
+ * Compares the costs of the paths found by a pathfinder with those of the
+ * reference search.
+ * @returns whether all the costs are the same.
+ */
+static bool printComparison(const PathResults &results,
+                            const PathResults &reference)
+{
+    int same = 0, longer = 0, missed = 0, compared = 0;
+    double ratio = 0;
+    for (unsigned i = 0; i < results.costs.size(); ++i)
+    {
+        const int cost = results.costs[i];
+        const int best = reference.costs[i];
+        if (cost == best)
+            ++same;
+        else if (cost < 0)
+            ++missed;
+        if (cost > 0 && best > 0)
+        {
+            ratio += (double) cost / best;
+            ++compared;
+            if (cost > best)
+                ++longer;
+        }
+    }
+
+    printf("%20s same cost %d, longer %d, not found %d, "
+           "%.1f%% longer on average\n", "", same, longer, missed,
+           compared ? (ratio / compared - 1) * 100 : 0.0);
+    return same == (int) results.costs.size();
+}
+
+int runPathBenchmark(const BenchmarkOptions &options)
+{
+    Map *map = loadBenchmarkMap(options);
+    if (!map)
+        return EXIT_MAP_FILE_NOT_FOUND;
+
+    std::vector<PathPair> pairs;
+    if (!options.pairsFile.empty())
+    {
+        if (!readPairs(options.pairsFile, pairs))
+        {
+            std::cerr << "Cannot read " << options.pairsFile << std::endl;
+            return EXIT_BAD_CONFIG_PARAMETER;
+        }
+    }
+    else
+    {
+        generatePairs(map, options, pairs);
+    }
+
+    if (!options.recordFile.empty())
+        writePairs(options.recordFile, pairs);
+
+    printf("Map of %dx%d tiles, %u pairs\n",
+           map->getWidth(), map->getHeight(), (unsigned) pairs.size());
+
+    // Let the tile pathfinder go as far as needed
+    const int maxCost = map->getWidth() * map->getHeight();
+
+    Configuration::setValue("game_jumpPointSearch", "0");
+    const PathResults aStar = replay(pairs, [=](const PathPair &pair) {
+        return map->findPath(pair.start.x, pair.start.y,
+                             pair.dest.x, pair.dest.y,
+                             Map::BLOCKMASK_WALL, maxCost);
+    });
+    printResults("A*", aStar);
+    printPushes(aStar);
+
+    Configuration::setValue("game_jumpPointSearch", "1");
+    const PathResults jumpPoints = replay(pairs, [=](const PathPair &pair) {
+        return map->findPath(pair.start.x, pair.start.y,
+                             pair.dest.x, pair.dest.y,
+                             Map::BLOCKMASK_WALL, maxCost);
+    });
+    printResults("Jump point search", jumpPoints);
+    printPushes(jumpPoints);
+
+    // Jump point search has to find paths as short as those of A*
+    const bool sameCosts = printComparison(jumpPoints, aStar);
+
+    // The cluster graph refines its routes with the default tile search
+    Configuration::setValue("game_jumpPointSearch", "0");
+    const Stopwatch buildTime;
+    map->buildClusterGraph();
+    printf("%-20s %10.1f ms\n", "Cluster graph build", buildTime.elapsed());
+
+    const PathResults clusters = replay(pairs, [=](const PathPair &pair) {
+        return map->findLongPath(pair.start.x, pair.start.y,
+                                 pair.dest.x, pair.dest.y,
+                                 Map::BLOCKMASK_WALL);
+    });
+    printResults("Cluster graph", clusters);
+    printComparison(clusters, aStar);
+
+    delete map;
+
+    if (!sameCosts)
+    {
+        std::cerr << "Jump point search and A* found paths of different "
+                     "costs" << std::endl;
+        return EXIT_OTHER_EXCEPTION;
+    }
+    return EXIT_NORMAL;
+}
@@ -0,0 +1,342 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench/benchmark.h"
+
+#include "common/configuration.h"
+#include "common/defines.h"
+#include "common/manaserv_protocol.h"
+#include "game-server/being.h"
+#include "game-server/character.h"
+#include "game-server/gamehandler.h"
+#include "game-server/map.h"
+#include "game-server/mapcomposite.h"
+#include "game-server/mapmanager.h"
+#include "game-server/monster.h"
+#include "game-server/monstermanager.h"
+#include "game-server/state.h"
+#include "net/messagein.h"
+#include "net/messageout.h"
+#include "utils/string.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace ManaServ;
+
+static const int DEFAULT_MONSTER_COUNT = 5000;
+static const int DEFAULT_CHARACTER_COUNT = 200;
+static const int DEFAULT_TICK_COUNT = 200;
+
+/** Ticks letting the inserted beings settle before measuring. */
+static const int WARM_UP_TICKS = 50;
+
+/**
+ * The settings take turns every so many ticks, so that the world changing
+ * over time does not favor one of them. The first tick of each turn is not
+ * measured, as it may start or stop threads.
+ */
+static const int TURN_TICKS = 10;
+
+/** Distance in tiles of the places the characters walk to. */
+static const int WALK_RANGE = 10;
+
+/**
+ * The peer of the clients of the characters. It never connected, so enet
+ * refuses to send anything to it.
+ */
+static ENetPeer disconnectedPeer;
+
+/**
+ * Amount of update threads, and whether they also update the maps or only
+ * inform the characters.
+ */
+struct UpdateSetting
+{
+    int threads;
+    bool parallelMaps;
+};
+
+/**
+ * Outcome of the ticks run with one setting.
+ */
+struct TickTimes
+{
+    TickTimes():
+        total(0),
+        max(0),
+        ticks(0)
+    {}
+
+    double total;               /**< In milliseconds. */
+    double max;
+    int ticks;
+};
+
+static bool findWalkablePosition(MapComposite *map, Point &position)
+{
+    const Map *realMap = map->getMap();
+    for (int attempt = 0; attempt < 100; ++attempt)
+    {
+        const int x = rand() % realMap->getWidth();
+        const int y = rand() % realMap->getHeight();
+        if (realMap->getWalk(x, y))
+        {
+            position.x = x * realMap->getTileWidth()
+                         + realMap->getTileWidth() / 2;
+            position.y = y * realMap->getTileHeight()
+                         + realMap->getTileHeight() / 2;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void createMonster(MonsterClass *specy, MapComposite *map)
+{
+    Point position;
+    if (!findWalkablePosition(map, position))
+        return;
+
+    Entity *monster = new Entity(OBJECT_MONSTER);
+    auto *actorComponent = new ActorComponent(*monster);
+    monster->addComponent(actorComponent);
+    monster->addComponent(new BeingComponent(*monster));
+    monster->addComponent(new MonsterComponent(*monster, specy));
+    monster->setMap(map);
+    actorComponent->setPosition(*monster, position);
+    GameState::enqueueInsert(monster);
+}
+
+/**
+ * Connects a character the way the account server and a client would, with
+ * the data of a new character.
+ */
+static Entity *createCharacter(int id, MapComposite *map)
+{
+    Point position;
+    if (!findWalkablePosition(map, position))
+        return nullptr;
+
+    MessageOut data(AGMSG_PLAYER_ENTER);
+    data.writeInt32(id);
+    data.writeString("Bench" + utils::toString(id));
+    data.writeInt8(0);              // Account level
+    data.writeInt8(GENDER_UNSPECIFIED);
+    data.writeInt8(0);              // Hair style
+    data.writeInt8(0);              // Hair color
+    data.writeInt16(1);             // Level
+    data.writeInt16(0);             // Character points
+    data.writeInt16(0);             // Correction points
+    data.writeInt16(0);             // Attributes
+    data.writeInt16(0);             // Skills
+    data.writeInt16(0);             // Status effects
+    data.writeInt16(map->getID());
+    data.writeInt16(position.x);
+    data.writeInt16(position.y);
+    data.writeInt16(0);             // Kill counts
+    data.writeInt16(0);             // Specials
+    data.writeInt16(0);             // Equipment
+
+    MessageIn msg(data.getData(), data.getLength());
+    Entity *character = new Entity(OBJECT_CHARACTER);
+    character->addComponent(new ActorComponent(*character));
+    character->addComponent(new BeingComponent(*character));
+    character->addComponent(new CharacterComponent(*character, msg));
+
+    // A new character gets its hitpoints from the account server, which
+    // stores them when the character is created
+    character->getComponent<BeingComponent>()->heal(*character);
+
+    gameHandler->tokenMatched(new GameClient(&disconnectedPeer), character);
+    return character;
+}
+
+/**
+ * Lets the characters that stand still walk somewhere close, like players
+ * exploring the map.
+ */
+void walkCharacters(const std::vector<Entity *> &characters)
+{
+    for (std::vector<Entity *>::const_iterator it = characters.begin(),
+         it_end = characters.end(); it != it_end; ++it)
+    {
+        Entity *character = *it;
+        auto *beingComponent = character->getComponent<BeingComponent>();
+        const Point &position =
+                character->getComponent<ActorComponent>()->getPosition();
+        if (position != beingComponent->getDestination() || rand() % 10)
+            continue;
+
+        const int range = WALK_RANGE * DEFAULT_TILE_LENGTH;
+        const Point destination(
+                position.x + rand() % (2 * range + 1) - range,
+                position.y + rand() % (2 * range + 1) - range);
+        if (destination.x >= 0 && destination.y >= 0)
+            beingComponent->setDestination(*character, destination);
+    }
+}
+
+static void parseThreadCounts(const std::string &list,
+                              std::vector<int> &threadCounts)
+{
+    std::istringstream counts(list);
+    std::string count;
+    while (std::getline(counts, count, ','))
+        if (int threads = utils::stringToInt(count))
+            threadCounts.push_back(threads);
+
+    if (!threadCounts.empty())
+        return;
+
+    // Powers of two up to the amount of cores
+    const int cores = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads < cores; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+}
+
+int populateWorld(int monsterCount, int characterCount,
+                  std::vector<MapComposite *> &maps,
+                  std::vector<Entity *> &characters, int &tick)
+{
+    const MapManager::Maps &allMaps = MapManager::getMaps();
+    for (MapManager::Maps::const_iterator it = allMaps.begin(),
+         it_end = allMaps.end(); it != it_end; ++it)
+    {
+        if (MapManager::activateMap(it->first))
+            maps.push_back(it->second);
+    }
+    if (maps.empty())
+    {
+        std::cerr << "No map could be activated" << std::endl;
+        return EXIT_MAP_FILE_NOT_FOUND;
+    }
+
+    // The monster classes are numbered from 1 in the example data
+    std::vector<MonsterClass *> species;
+    for (int id = 1; MonsterClass *specy = monsterManager->getMonster(id); ++id)
+        species.push_back(specy);
+    if (species.empty())
+    {
+        std::cerr << "No monster class found" << std::endl;
+        return EXIT_BAD_CONFIG_PARAMETER;
+    }
+
+    for (int i = 0; i < monsterCount; ++i)
+        createMonster(species[i % species.size()], maps[i % maps.size()]);
+
+    for (int i = 0; i < characterCount; ++i)
+        if (Entity *character = createCharacter(i + 1, maps[i % maps.size()]))
+            characters.push_back(character);
+
+    for (int i = 0; i < WARM_UP_TICKS; ++i)
+    {
+        walkCharacters(characters);
+        GameState::update(++tick);
+    }
+    return EXIT_NORMAL;
+}
+
+int runWorldBenchmark(const BenchmarkOptions &options)
+{
+    const int monsterCount = options.count ? options.count
+                                           : DEFAULT_MONSTER_COUNT;
+    const int characterCount = options.characters >= 0 ?
+            options.characters : DEFAULT_CHARACTER_COUNT;
+    const int ticks = options.ticks ? options.ticks : DEFAULT_TICK_COUNT;
+
+    std::vector<int> threadCounts;
+    parseThreadCounts(options.threads, threadCounts);
+
+    std::vector<UpdateSetting> settings;
+    for (unsigned i = 0; i < threadCounts.size(); ++i)
+    {
+        UpdateSetting setting = { threadCounts[i], false };
+        settings.push_back(setting);
+        if (threadCounts[i] > 1)
+        {
+            setting.parallelMaps = true;
+            settings.push_back(setting);
+        }
+    }
+
+    // Keep every map awake and the searches in the ticks that need them
+    Configuration::setValue("game_hibernationRate", "1");
+    Configuration::setValue("game_pathSearchTime", "0");
+
+    std::vector<MapComposite *> maps;
+    std::vector<Entity *> characters;
+    int tick = 0;
+    if (int result = populateWorld(monsterCount, characterCount, maps,
+                                   characters, tick))
+        return result;
+
+    printf("%u maps, %d monsters, %u characters, %d ticks per setting\n",
+           (unsigned) maps.size(), monsterCount, (unsigned) characters.size(),
+           ticks);
+    if (maps.size() < 2)
+        printf("The maps are only updated in parallel when there are "
+               "several of them\n");
+
+    std::vector<TickTimes> times(settings.size());
+    for (int turn = 0; times.back().ticks < ticks; ++turn)
+    {
+        const unsigned setting = turn % settings.size();
+        Configuration::setValue("game_updateThreads",
+                                utils::toString(settings[setting].threads));
+        Configuration::setValue("game_parallelMapUpdates",
+                                settings[setting].parallelMaps ? "true"
+                                                               : "false");
+
+        for (int i = 0; i < TURN_TICKS; ++i)
+        {
+            walkCharacters(characters);
+
+            const Stopwatch stopwatch;
+            GameState::update(++tick);
+            const double time = stopwatch.elapsed();
+
+            TickTimes &settingTimes = times[setting];
+            if (i == 0 || settingTimes.ticks == ticks)
+                continue;
+            settingTimes.total += time;
+            settingTimes.max = std::max(settingTimes.max, time);
+            ++settingTimes.ticks;
+        }
+    }
+
+    const double serialTime = times.front().total;
+    for (unsigned i = 0; i < settings.size(); ++i)
+    {
+        const TickTimes &settingTimes = times[i];
+        printf("%2d threads %-12s %10.3f ms/tick %10.3f ms max %8.2fx\n",
+               settings[i].threads,
+               settings[i].parallelMaps ? "maps too" : "inform only",
+               settingTimes.total / settingTimes.ticks,
+               settingTimes.max, serialTime / settingTimes.total);
+    }
+    return EXIT_NORMAL;
+}
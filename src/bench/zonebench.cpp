@@ -0,0 +1,135 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench/benchmark.h"
+
+#include "common/configuration.h"
+#include "common/defines.h"
+#include "game-server/mapcomposite.h"
+#include "game-server/state.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+static const int DEFAULT_MONSTER_COUNT = 5000;
+static const int DEFAULT_CHARACTER_COUNT = 200;
+static const int DEFAULT_TICK_COUNT = 200;
+
+static std::atomic<unsigned long> allocationCount(0);
+
+/*
+ * The allocations of the whole program are counted, including the ones of
+ * the standard containers, by replacing the global operator new. The array
+ * and sized forms end up in these ones.
+ */
+void *operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+unsigned long getAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+int runZoneBenchmark(const BenchmarkOptions &options)
+{
+    const int monsterCount = options.count ? options.count
+                                           : DEFAULT_MONSTER_COUNT;
+    const int characterCount = options.characters >= 0 ?
+            options.characters : DEFAULT_CHARACTER_COUNT;
+    const int ticks = options.ticks ? options.ticks : DEFAULT_TICK_COUNT;
+
+    // Keep every map awake, and every allocation in the tick that needs it
+    Configuration::setValue("game_hibernationRate", "1");
+    Configuration::setValue("game_pathSearchTime", "0");
+    Configuration::setValue("game_updateThreads", "1");
+
+    std::vector<MapComposite *> maps;
+    std::vector<Entity *> characters;
+    int tick = 0;
+    if (int result = populateWorld(monsterCount, characterCount, maps,
+                                   characters, tick))
+        return result;
+
+    // The queries look as far as the characters see
+    const int radius = Configuration::getSettings().visualRange;
+
+    double tickTime = 0, queryTime = 0;
+    unsigned long tickAllocations = 0, queryAllocations = 0;
+    unsigned long queries = 0, found = 0, zoneChanges = 0;
+    for (int i = 0; i < ticks; ++i)
+    {
+        walkCharacters(characters);
+
+        unsigned long allocations = getAllocationCount();
+        const Stopwatch tickStopwatch;
+        GameState::update(++tick);
+        tickTime += tickStopwatch.elapsed();
+        tickAllocations += getAllocationCount() - allocations;
+
+        for (std::vector<MapComposite *>::const_iterator it = maps.begin(),
+             it_end = maps.end(); it != it_end; ++it)
+            zoneChanges += (*it)->takeZoneChanges();
+
+        allocations = getAllocationCount();
+        const Stopwatch queryStopwatch;
+        for (std::vector<MapComposite *>::const_iterator it = maps.begin(),
+             it_end = maps.end(); it != it_end; ++it)
+        {
+            MapComposite *map = *it;
+            for (BeingIterator b(map->getWholeMapIterator()); b; ++b)
+            {
+                for (ActorIterator a(map->getAroundBeingIterator(*b, radius));
+                     a; ++a)
+                    ++found;
+                for (ActorIterator a(map->getAroundActorIterator(*b, radius));
+                     a; ++a)
+                    ++found;
+                queries += 2;
+            }
+        }
+        queryTime += queryStopwatch.elapsed();
+        queryAllocations += getAllocationCount() - allocations;
+    }
+
+    printf("%u maps, %d monsters, %u characters, %d ticks\n",
+           (unsigned) maps.size(), monsterCount, (unsigned) characters.size(),
+           ticks);
+    printf("%-8s %10.3f ms/tick  %12.1f allocations/tick\n", "Ticks",
+           tickTime / ticks, (double) tickAllocations / ticks);
+    printf("%-8s %10.3f us/query %12.3f allocations/query\n", "Queries",
+           queryTime * 1000 / queries, (double) queryAllocations / queries);
+    printf("%-8s %10.1f changes/tick\n", "Zones",
+           (double) zoneChanges / ticks);
+    printf("(%lu actors found)\n", found);
+    return EXIT_NORMAL;
+}
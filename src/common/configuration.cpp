@@ -19,9 +19,11 @@
  *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cmath>
 #include <map>
 #include <set>
+#include <vector>
 #include <libxml/xmlreader.h>
 
 #include "common/configuration.h"
@@ -37,6 +39,10 @@ static std::map< std::string, std::string > options;
 /**< Location of config file. */
 static std::string configPath;
 static std::set<std::string> processedFiles;
+/**< Options parsed in advance. */
+static Configuration::Settings settings;
+/**< Functions to call after a reload. */
+static std::vector<Configuration::ReloadListener> reloadListeners;
 
 static bool readFile(const std::string &fileName)
 {
@@ -84,6 +90,45 @@ static bool readFile(const std::string &fileName)
     return true;
 }
 
+static void parseSettings()
+{
+    settings.visualRange =
+            Configuration::getValue("game_visualRange", 448);
+    settings.floorItemDecayTime =
+            Configuration::getValue("game_floorItemDecayTime", 0);
+    settings.updateThreads =
+            std::max(1, Configuration::getValue("game_updateThreads", 1));
+    settings.informChunkSize =
+            std::max(0, Configuration::getValue("game_informChunkSize", 0));
+    settings.parallelMapUpdates =
+            Configuration::getBoolValue("game_parallelMapUpdates", false);
+    settings.batchComponentUpdates =
+            Configuration::getBoolValue("game_batchComponentUpdates", false);
+    settings.aiSleepRange =
+            Configuration::getValue("game_aiSleepRange",
+                                    settings.visualRange * 2);
+    settings.aiReducedRate =
+            std::max(1, Configuration::getValue("game_aiReducedRate", 5));
+    settings.aiRescanInterval =
+            std::max(1, Configuration::getValue("game_aiRescanInterval", 10));
+    settings.hibernationDelay =
+            std::max(0, Configuration::getValue("game_hibernationDelay", 600));
+    settings.hibernationRate =
+            std::max(1, Configuration::getValue("game_hibernationRate", 20));
+    settings.jumpPointSearch =
+            Configuration::getBoolValue("game_jumpPointSearch", false);
+    settings.flowFields =
+            Configuration::getBoolValue("game_flowFields", false);
+    settings.pathSearchTime =
+            std::max(0, Configuration::getValue("game_pathSearchTime", 0));
+    settings.syncPathSearches =
+            std::max(0, Configuration::getValue("game_syncPathSearches", 8));
+    settings.characterPathCost =
+            std::max(0, Configuration::getValue("game_characterPathCost", 20));
+    settings.pathCost =
+            std::max(0, Configuration::getValue("game_pathCost", 0));
+}
+
 bool Configuration::initialize(const std::string &fileName)
 {
     if (fileName.empty())
@@ -92,6 +137,7 @@ bool Configuration::initialize(const std::string &fileName)
         configPath = fileName;
 
     const bool success = readFile(configPath);
+    parseSettings();
 
     LOG_INFO("Using config file: " << configPath);
 
@@ -101,6 +147,43 @@ bool Configuration::initialize(const std::string &fileName)
 void Configuration::deinitialize()
 {
     processedFiles.clear();
+    reloadListeners.clear();
+}
+
+bool Configuration::reload()
+{
+    std::map< std::string, std::string > previousOptions;
+    previousOptions.swap(options);
+    processedFiles.clear();
+
+    if (!readFile(configPath))
+    {
+        LOG_WARN("Could not reload config file: " << configPath
+                 << ", keeping the current options.");
+        options.swap(previousOptions);
+        return false;
+    }
+
+    parseSettings();
+    LOG_INFO("Reloaded config file: " << configPath);
+
+    for (std::vector<ReloadListener>::const_iterator
+         it = reloadListeners.begin(), it_end = reloadListeners.end();
+         it != it_end; ++it)
+    {
+        (*it)();
+    }
+    return true;
+}
+
+const Configuration::Settings &Configuration::getSettings()
+{
+    return settings;
+}
+
+void Configuration::addReloadListener(ReloadListener listener)
+{
+    reloadListeners.push_back(listener);
 }
 
 std::string Configuration::getValue(const std::string &key,
@@ -127,3 +210,9 @@ bool Configuration::getBoolValue(const std::string &key, bool deflt)
         return deflt;
     return utils::stringToBool(iter->second.c_str(), deflt);
 }
+
+void Configuration::setValue(const std::string &key, const std::string &value)
+{
+    options[key] = value;
+    parseSettings();
+}
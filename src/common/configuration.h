@@ -22,6 +22,7 @@
 #ifndef CONFIGURATION_H
 #define CONFIGURATION_H
 
+#include <functional>
 #include <string>
 
 namespace Configuration
@@ -57,6 +58,61 @@ namespace Configuration
      * @param deflt default value.
      */
     bool getBoolValue(const std::string &key, bool deflt);
+
+    /**
+     * Sets an option until the configuration is reloaded, and updates the
+     * settings. Used by the benchmarks to compare settings.
+     * @param key option identifier.
+     * @param value new value.
+     */
+    void setValue(const std::string &key, const std::string &value);
+
+    /**
+     * Options that are read very often by the game server. They are parsed
+     * once whenever the configuration is loaded.
+     */
+    struct Settings
+    {
+        int visualRange;            /**< game_visualRange, in pixels. */
+        int floorItemDecayTime;     /**< game_floorItemDecayTime, in seconds. */
+        int updateThreads;          /**< game_updateThreads */
+        int informChunkSize;        /**< game_informChunkSize */
+        bool parallelMapUpdates;    /**< game_parallelMapUpdates */
+        bool batchComponentUpdates; /**< game_batchComponentUpdates */
+        int aiSleepRange;           /**< game_aiSleepRange, in pixels. */
+        int aiReducedRate;          /**< game_aiReducedRate, in ticks. */
+        int aiRescanInterval;       /**< game_aiRescanInterval, in ticks. */
+        int hibernationDelay;       /**< game_hibernationDelay, in ticks. */
+        int hibernationRate;        /**< game_hibernationRate, in ticks. */
+        bool jumpPointSearch;       /**< game_jumpPointSearch */
+        bool flowFields;            /**< game_flowFields */
+        int pathSearchTime;         /**< game_pathSearchTime, in usec. */
+        int syncPathSearches;       /**< game_syncPathSearches, per tick. */
+        int characterPathCost;      /**< game_characterPathCost, in tiles. */
+        int pathCost;               /**< game_pathCost, in tiles. */
+    };
+
+    /**
+     * Gets the settings parsed from the current configuration.
+     */
+    const Settings &getSettings();
+
+    typedef std::function<void()> ReloadListener;
+
+    /**
+     * Registers a function that is called after the configuration has been
+     * reloaded.
+     */
+    void addReloadListener(ReloadListener listener);
+
+    /**
+     * Reads the configuration file again, updates the settings and calls
+     * the reload listeners. The current options are kept when the file
+     * cannot be read.
+     *
+     * @return whether the configuration file could be read
+     */
+    bool reload();
 }
 
 #ifndef DEFAULT_SERVER_PORT
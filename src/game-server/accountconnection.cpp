@@ -44,7 +44,7 @@ const unsigned SYNC_BUFFER_SIZE = 1024;
 const int SYNC_BUFFER_LIMIT = 20;
 
 AccountConnection::AccountConnection():
-    mSyncBuffer(0),
+    mSyncBuffer(new MessageOut(GAMSG_PLAYER_SYNC)),
     mSyncMessages(0)
 {
 }
@@ -95,15 +95,26 @@ bool AccountConnection::start(int gameServerPort)
     msg.writeInt32(itemManager->getDatabaseVersion());
     send(msg);
 
-    // initialize sync buffer
-    if (!mSyncBuffer)
-        mSyncBuffer = new MessageOut(GAMSG_PLAYER_SYNC);
-
     return true;
 }
 
+void AccountConnection::send(const MessageOut &msg, bool reliable,
+                             unsigned channel)
+{
+    if (GameState::SideEffects *sideEffects = GameState::getSideEffects())
+    {
+        sideEffects->push_back([=] { send(msg, reliable, channel); });
+        return;
+    }
+
+    Connection::send(msg, reliable, channel);
+}
+
 void AccountConnection::sendCharacterData(Entity *p)
 {
+    // Save the attributes derived from the latest changes
+    p->getComponent<BeingComponent>()->flushChangedAttributes(*p);
+
     MessageOut msg(GAMSG_PLAYER_DATA);
     auto *characterComponent = p->getComponent<CharacterComponent>();
     msg.writeInt32(characterComponent->getDatabaseID());
@@ -456,6 +467,12 @@ void AccountConnection::syncChanges(bool force)
 void AccountConnection::updateCharacterPoints(int charId, int charPoints,
                                               int corrPoints)
 {
+    if (GameState::SideEffects *sideEffects = GameState::getSideEffects())
+    {
+        sideEffects->push_back([=] { updateCharacterPoints(charId, charPoints, corrPoints); });
+        return;
+    }
+
     ++mSyncMessages;
     mSyncBuffer->writeInt8(SYNC_CHARACTER_POINTS);
     mSyncBuffer->writeInt32(charId);
@@ -467,6 +484,12 @@ void AccountConnection::updateCharacterPoints(int charId, int charPoints,
 void AccountConnection::updateAttributes(int charId, int attrId, double base,
                               double mod)
 {
+    if (GameState::SideEffects *sideEffects = GameState::getSideEffects())
+    {
+        sideEffects->push_back([=] { updateAttributes(charId, attrId, base, mod); });
+        return;
+    }
+
     ++mSyncMessages;
     mSyncBuffer->writeInt8(SYNC_CHARACTER_ATTRIBUTE);
     mSyncBuffer->writeInt32(charId);
@@ -479,6 +502,12 @@ void AccountConnection::updateAttributes(int charId, int attrId, double base,
 void AccountConnection::updateExperience(int charId, int skillId,
                                          int skillValue)
 {
+    if (GameState::SideEffects *sideEffects = GameState::getSideEffects())
+    {
+        sideEffects->push_back([=] { updateExperience(charId, skillId, skillValue); });
+        return;
+    }
+
     ++mSyncMessages;
     mSyncBuffer->writeInt8(SYNC_CHARACTER_SKILL);
     mSyncBuffer->writeInt32(charId);
@@ -489,6 +518,12 @@ void AccountConnection::updateExperience(int charId, int skillId,
 
 void AccountConnection::updateOnlineStatus(int charId, bool online)
 {
+    if (GameState::SideEffects *sideEffects = GameState::getSideEffects())
+    {
+        sideEffects->push_back([=] { updateOnlineStatus(charId, online); });
+        return;
+    }
+
     ++mSyncMessages;
     mSyncBuffer->writeInt8(SYNC_ONLINE_STATUS);
     mSyncBuffer->writeInt32(charId);
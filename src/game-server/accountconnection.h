@@ -42,6 +42,13 @@ class AccountConnection : public Connection
          */
         bool start(int gameServerPort);
 
+        /**
+         * Sends a message to the account server. When the maps are updated
+         * by several threads, the message is sent once they are updated.
+         */
+        void send(const MessageOut &msg, bool reliable = true,
+                  unsigned channel = 0);
+
         /**
          * Sends data of a given character.
          */
@@ -31,12 +31,14 @@ ActorComponent::ActorComponent(Entity &entity):
     mPublicID(65535),
     mSize(0),
     mWalkMask(0),
-    mBlockType(BLOCKTYPE_NONE)
+    mBlockType(BLOCKTYPE_NONE),
+    mZone(0),
+    mZoneSlot(0)
 {
-    entity.signal_removed.connect(
-            sigc::mem_fun(this, &ActorComponent::removed));
-    entity.signal_map_changed.connect(
-            sigc::mem_fun(this, &ActorComponent::mapChanged));
+    mRemovedListener.connect<ActorComponent, &ActorComponent::removed>(
+            entity.signal_removed, this);
+    mMapChangedListener.connect<ActorComponent, &ActorComponent::mapChanged>(
+            entity.signal_map_changed, this);
 }
 
 void ActorComponent::removed(Entity *entity)
@@ -25,6 +25,8 @@
 #include "game-server/entity.h"
 #include "utils/point.h"
 
+#include <set>
+
 /**
  * Flags that are raised as necessary. They trigger messages that are sent to
  * the clients.
@@ -137,6 +139,37 @@ class ActorComponent : public Component
          */
         virtual void mapChanged(Entity *entity);
 
+        /**
+         * Gets the index of the map zone the actor is stored in. Since zones
+         * overlap, it cannot be deduced from the position.
+         */
+        unsigned getZone() const
+        { return mZone; }
+
+        void setZone(unsigned zone)
+        { mZone = zone; }
+
+        /**
+         * Gets the position of the actor in the objects of its zone.
+         */
+        unsigned getZoneSlot() const
+        { return mZoneSlot; }
+
+        void setZoneSlot(unsigned slot)
+        { mZoneSlot = slot; }
+
+        /**
+         * Gets the characters this actor is visible to.
+         */
+        const std::set<Entity *> &getObservers() const
+        { return mObservers; }
+
+        void addObserver(Entity *character)
+        { mObservers.insert(character); }
+
+        void removeObserver(Entity *character)
+        { mObservers.erase(character); }
+
     protected:
 
         /** Delay until move to next tile in miliseconds. */
@@ -153,6 +186,13 @@ class ActorComponent : public Component
 
         unsigned char mWalkMask;
         BlockType mBlockType;
+
+        unsigned mZone;             /**< Zone of the map containing the actor. */
+        unsigned mZoneSlot;         /**< Position in the objects of the zone. */
+        std::set<Entity *> mObservers; /**< Characters seeing the actor. */
+
+        utils::EventListener<Entity *> mRemovedListener;
+        utils::EventListener<Entity *> mMapChangedListener;
 };
 
 #endif // ACTOR_H
@@ -25,13 +25,12 @@
 #include <cstddef>
 #include <list>
 
-#include <sigc++/signal.h>
-#include <sigc++/trackable.h>
-
 #include "common/defines.h"
 
 #include "scripting/script.h"
 
+#include "utils/event.h"
+
 #include "utils/xml.h"
 
 #include "game-server/timeout.h"
@@ -174,7 +173,7 @@ class Attack
 /**
  * Helper class for storing multiple auto-attacks.
  */
-class Attacks : public sigc::trackable
+class Attacks
 {
     public:
         Attacks():
@@ -194,8 +193,8 @@ class Attacks : public sigc::trackable
         unsigned getNumber()
         { return mAttacks.size(); }
 
-        sigc::signal<void, CombatComponent *, Attack &> attack_added;
-        sigc::signal<void, CombatComponent *, Attack &> attack_removed;
+        utils::Event<CombatComponent *, Attack &> attack_added;
+        utils::Event<CombatComponent *, Attack &> attack_removed;
 
     private:
         std::vector<Attack> mAttacks;
@@ -22,6 +22,7 @@
 #include "game-server/being.h"
 #include "utils/logger.h"
 #include <cassert>
+#include <stdexcept>
 
 AttributeModifiersEffect::AttributeModifiersEffect(StackableType stackableType,
                                                    ModifierEffectType effectType) :
@@ -40,14 +41,7 @@ AttributeModifiersEffect::AttributeModifiersEffect(StackableType stackableType,
               << " and stackableType " << stackableType << ".");
 }
 
-AttributeModifiersEffect::~AttributeModifiersEffect()
-{
-    // ?
-    /*mStates.clear();*/
-    LOG_WARN("DELETION of attribute effect!");
-}
-
-bool AttributeModifiersEffect::add(unsigned short duration,
+bool AttributeModifiersEffect::add(int expireTick,
                                    double value,
                                    double prevLayerValue,
                                    int level)
@@ -56,7 +50,7 @@ bool AttributeModifiersEffect::add(unsigned short duration,
               " with a previous layer value of " << prevLayerValue << ". "
               "Current mod at this layer: " << mMod << ".");
     bool ret = false;
-    mStates.push_back(new AttributeModifierState(duration, value, level));
+    mStates.push_back(AttributeModifierState(expireTick, value, level));
     switch (mStackableType) {
     case Stackable:
         switch (mEffectType) {
@@ -127,33 +121,25 @@ bool AttributeModifiersEffect::add(unsigned short duration,
     return ret;
 }
 
-bool durationCompare(const AttributeModifierState *lhs,
-                     const AttributeModifierState *rhs)
-{
-    return lhs->mDuration < rhs->mDuration;
-}
-
 bool AttributeModifiersEffect::remove(double value, unsigned id,
                                       bool fullCheck)
 {
     /* We need to find and check this entry exists, and erase the entry
        from the list too. */
-    if (!fullCheck)
-        mStates.sort(durationCompare); /* Search only through those with a duration of 0. */
     bool ret = false;
 
-    for (std::list< AttributeModifierState * >::iterator it = mStates.begin();
-         it != mStates.end() && (fullCheck || !(*it)->mDuration);)
+    for (std::vector<AttributeModifierState>::iterator it = mStates.begin();
+         it != mStates.end();)
     {
-        /* Check for a match */
-        if ((*it)->mValue != value || (*it)->mId != id)
+        /* Check for a match, only among the permanent ones unless asked */
+        if (it->mValue != value || it->mId != id ||
+            (!fullCheck && !it->isPermanent()))
         {
             ++it;
             continue;
         }
 
-        delete *it;
-        mStates.erase(it++);
+        it = mStates.erase(it);
 
         /* If this is stackable, we need to update for every modifier affected */
         if (mStackableType == Stackable)
@@ -188,12 +174,12 @@ void AttributeModifiersEffect::updateMod(double value)
             else
             {
                 mMod = 1;
-                for (std::list< AttributeModifierState * >::const_iterator
+                for (std::vector<AttributeModifierState>::const_iterator
                      it = mStates.begin(),
                      it_end = mStates.end();
                     it != it_end;
                     ++it)
-                    mMod *= (*it)->mValue;
+                    mMod *= it->mValue;
             }
         }
         else LOG_ERROR("Attribute modifiers effect: unhandled type '"
@@ -204,13 +190,13 @@ void AttributeModifiersEffect::updateMod(double value)
         if (mMod == value)
         {
             mMod = 0;
-            for (std::list< AttributeModifierState * >::const_iterator
+            for (std::vector<AttributeModifierState>::const_iterator
                  it = mStates.begin(),
                  it_end = mStates.end();
                 it != it_end;
                 ++it)
-                if ((*it)->mValue > mMod)
-                    mMod = (*it)->mValue;
+                if (it->mValue > mMod)
+                    mMod = it->mValue;
         }
     }
     else
@@ -248,28 +234,30 @@ bool AttributeModifiersEffect::recalculateModifiedValue(double newPrevLayerValue
 }
 
 
-bool Attribute::add(unsigned short duration, double value,
+bool Attribute::add(int expireTick, double value,
                     unsigned layer, int id)
 {
     assert(mMods.size() > layer);
-    LOG_DEBUG("Adding modifier to attribute with duration " << duration
+    LOG_DEBUG("Adding modifier to attribute expiring at " << expireTick
               << ", value " << value
               << ", at layer " << layer
               << " with id " << id);
-    if (mMods.at(layer)->add(duration, value,
-                            (layer ? mMods.at(layer - 1)->getCachedModifiedValue()
+    if (mMods.at(layer).add(expireTick, value,
+                            (layer ? mMods.at(layer - 1).getCachedModifiedValue()
                                    : mBase)
                             , id))
     {
         while (++layer < mMods.size())
         {
-            if (!mMods.at(layer)->recalculateModifiedValue(
-                       mMods.at(layer - 1)->getCachedModifiedValue()))
+            if (!mMods.at(layer).recalculateModifiedValue(
+                       mMods.at(layer - 1).getCachedModifiedValue()))
             {
                 LOG_DEBUG("Modifier added, but modified value not changed.");
+                updateModifiedValue();
                 return false;
             }
         }
+        updateModifiedValue();
         LOG_DEBUG("Modifier added. Base value: " << mBase << ", new modified "
                   "value: " << getModifiedAttribute() << ".");
         return true;
@@ -282,34 +270,40 @@ bool Attribute::remove(double value, unsigned layer,
                        int lvl, bool fullcheck)
 {
     assert(mMods.size() > layer);
-    if (mMods.at(layer)->remove(value, lvl, fullcheck))
+    if (mMods.at(layer).remove(value, lvl, fullcheck))
     {
         for (; layer < mMods.size(); ++layer)
-            if (!mMods.at(layer)->recalculateModifiedValue(
-                        layer ? mMods.at(layer - 1)->getCachedModifiedValue()
+        {
+            if (!mMods.at(layer).recalculateModifiedValue(
+                        layer ? mMods.at(layer - 1).getCachedModifiedValue()
                               : mBase))
-               return false;
-        return true;
+                break;
+        }
+        const double oldValue = mModifiedValue;
+        updateModifiedValue();
+        return oldValue != mModifiedValue;
     }
     return false;
 }
 
-bool AttributeModifiersEffect::tick()
+bool AttributeModifiersEffect::expire(int tick)
 {
     bool ret = false;
-    std::list<AttributeModifierState *>::iterator it = mStates.begin();
+    std::vector<AttributeModifierState>::iterator it = mStates.begin();
     while (it != mStates.end())
     {
-        if ((*it)->tick())
+        if (it->hasExpired(tick))
         {
-            double value = (*it)->mValue;
+            double value = it->mValue;
             LOG_DEBUG("Modifier of value " << value << " expiring!");
-            delete *it;
-            mStates.erase(it++);
+            it = mStates.erase(it);
             updateMod(value);
             ret = true;
         }
-        ++it;
+        else
+        {
+            ++it;
+        }
     }
     return ret;
 }
@@ -317,58 +311,55 @@ bool AttributeModifiersEffect::tick()
 Attribute::Attribute(const AttributeManager::AttributeInfo &info):
     mBase(0),
     mMinValue(info.minimum),
-    mMaxValue(info.maximum)
+    mMaxValue(info.maximum),
+    mModifiedValue(0)
 {
     const std::vector<AttributeModifier> &modifiers = info.modifiers;
     LOG_DEBUG("Construction of new attribute with '" << modifiers.size()
         << "' layers.");
+    mMods.reserve(modifiers.size());
     for (unsigned i = 0; i < modifiers.size(); ++i)
     {
         LOG_DEBUG("Adding layer with stackable type "
                   << modifiers[i].stackableType
                   << " and effect type " << modifiers[i].effectType << ".");
-        mMods.push_back(new AttributeModifiersEffect(modifiers[i].stackableType,
-                                                     modifiers[i].effectType));
+        mMods.push_back(AttributeModifiersEffect(modifiers[i].stackableType,
+                                                 modifiers[i].effectType));
         LOG_DEBUG("Layer added.");
     }
     mBase = checkBounds(mBase);
+    updateModifiedValue();
 }
 
-Attribute::~Attribute()
+bool Attribute::expire(int tick)
 {
-//    for (std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin(),
-//         it_end = mMods.end(); it != it_end; ++it)
-//    {
-        // ?
-        //delete *it;
-//    }
-}
-
-bool Attribute::tick()
-{
-    bool ret = false;
+    bool changed = false;
     double prev = mBase;
-    for (std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin(),
+    for (std::vector<AttributeModifiersEffect>::iterator it = mMods.begin(),
         it_end = mMods.end(); it != it_end; ++it)
     {
-        if ((*it)->tick())
+        if (it->expire(tick))
         {
-            LOG_DEBUG("Attribute layer " << mMods.begin() - it
+            LOG_DEBUG("Attribute layer " << it - mMods.begin()
                       << " has expiring modifiers.");
-            ret = true;
+            changed = true;
         }
-        if (ret)
-            if (!(*it)->recalculateModifiedValue(prev)) ret = false;
-        prev = (*it)->getCachedModifiedValue();
+        if (changed)
+            it->recalculateModifiedValue(prev);
+        prev = it->getCachedModifiedValue();
     }
-    return ret;
+
+    const double oldValue = mModifiedValue;
+    updateModifiedValue();
+    return oldValue != mModifiedValue;
 }
 
 void Attribute::clearMods()
 {
-    for (std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin(),
+    for (std::vector<AttributeModifiersEffect>::iterator it = mMods.begin(),
          it_end = mMods.end(); it != it_end; ++it)
-        (*it)->clearMods(mBase);
+        it->clearMods(mBase);
+    updateModifiedValue();
 }
 
 void Attribute::setBase(double base)
@@ -377,14 +368,15 @@ void Attribute::setBase(double base)
     LOG_DEBUG("Setting base attribute from " << mBase << " to " << base << ".");
     double prev = mBase = base;
 
-    std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin();
+    std::vector<AttributeModifiersEffect>::iterator it = mMods.begin();
     while (it != mMods.end())
     {
-        if ((*it)->recalculateModifiedValue(prev))
-            prev = (*it++)->getCachedModifiedValue();
+        if (it->recalculateModifiedValue(prev))
+            prev = (it++)->getCachedModifiedValue();
         else
             break;
     }
+    updateModifiedValue();
 }
 
 void AttributeModifiersEffect::clearMods(double baseValue)
@@ -403,3 +395,47 @@ double Attribute::checkBounds(double baseValue) const
         baseValue = mMinValue;
     return baseValue;
 }
+
+void Attribute::updateModifiedValue()
+{
+    mModifiedValue = mMods.empty() ? mBase
+                                   : mMods.back().getCachedModifiedValue();
+}
+
+bool AttributeMap::insert(unsigned id,
+                          const AttributeManager::AttributeInfo &info)
+{
+    const int index = attributeManager->getAttributeIndex(id);
+    if (index < 0)
+    {
+        LOG_ERROR("AttributeMap: Attempt to create unknown attribute '"
+                  << id << "'!");
+        return false;
+    }
+
+    if (count(id))
+        return false;
+
+    // Keep the attributes in id order
+    std::vector<value_type>::iterator it = mAttributes.begin();
+    while (it != mAttributes.end() && it->first < id)
+        ++it;
+    mAttributes.insert(it, value_type(id, Attribute(info)));
+
+    mSlots.assign(attributeManager->getAttributeCount(), -1);
+    for (unsigned slot = 0; slot < mAttributes.size(); ++slot)
+    {
+        const int attributeIndex =
+                attributeManager->getAttributeIndex(mAttributes[slot].first);
+        mSlots[attributeIndex] = slot;
+    }
+    return true;
+}
+
+Attribute &AttributeMap::at(unsigned id)
+{
+    Attribute *attribute = find(id);
+    if (!attribute)
+        throw std::out_of_range("AttributeMap::at");
+    return *attribute;
+}
@@ -23,34 +23,35 @@
 
 #include "common/defines.h"
 #include "attributemanager.h"
+#include <utility>
 #include <vector>
-#include <list>
 
 class AttributeModifierState
 {
     public:
-        AttributeModifierState(unsigned short duration,
+        AttributeModifierState(int expireTick,
                                double value,
                                unsigned id)
-            : mDuration(duration)
+            : mExpireTick(expireTick)
             , mValue(value)
             , mId(id)
         {}
 
-        bool tick() { return mDuration ? !--mDuration : false; }
+        bool isPermanent() const { return !mExpireTick; }
+
+        bool hasExpired(int tick) const
+        { return mExpireTick && mExpireTick <= tick; }
 
     private:
-        /** Number of ticks (0 means permanent, e.g. equipment). */
-        unsigned short mDuration;
-        const double mValue;   /**< Positive or negative amount. */
+        /** Tick at which it expires (0 means permanent, e.g. equipment). */
+        int mExpireTick;
+        double mValue;          /**< Positive or negative amount. */
         /**
          * Special purpose variable used to identify this effect to
          * dispells or similar. Exact usage depends on the effect,
          * origin, etc.
          */
-        const unsigned mId;
-        friend bool durationCompare(const AttributeModifierState*,
-                                    const AttributeModifierState*);
+        unsigned mId;
         friend class AttributeModifiersEffect;
 };
 
@@ -59,7 +60,6 @@ class AttributeModifiersEffect
     public:
         AttributeModifiersEffect(StackableType stackableType,
                                  ModifierEffectType effectType);
-        ~AttributeModifiersEffect();
 
         /**
          * Recalculates the value for this level.
@@ -69,7 +69,7 @@ class AttributeModifiersEffect
          * If this returns true, the cached values for *all* modifiers of a
          *     higher level must be recalculated, as well as the final
          */
-        bool add(unsigned short duration, double value,
+        bool add(int expireTick, double value,
                  double prevLayerValue, int level);
 
         /**
@@ -98,7 +98,11 @@ class AttributeModifiersEffect
 
         double getCachedModifiedValue() const { return mCacheVal; }
 
-        bool tick();
+        /**
+         * Removes the modifiers that expired at the given tick.
+         * @returns Whether any modifier was removed.
+         */
+        bool expire(int tick);
 
         /**
          * clearMods() - removes all modifications present in this layer.
@@ -110,7 +114,7 @@ class AttributeModifiersEffect
 
     private:
         /** List of all modifications present at this level */
-        std::list<AttributeModifierState *> mStates;
+        std::vector<AttributeModifierState> mStates;
         /**
          * Stores the value that results from mStates. This takes into
          * account all previous layers.
@@ -121,8 +125,8 @@ class AttributeModifiersEffect
          * 0 for additive modifiers and 1 for multiplicative modifiers.
          */
         double mMod;
-        const StackableType mStackableType;
-        const ModifierEffectType mEffectType;
+        StackableType mStackableType;
+        ModifierEffectType mEffectType;
 };
 
 /**
@@ -136,18 +140,16 @@ class Attribute
             : mBase(0)
             , mMinValue(0)
             , mMaxValue(0)
+            , mModifiedValue(0)
         {throw;} // DEBUG; Find improper constructions
 
         Attribute(const AttributeManager::AttributeInfo &info);
 
-        ~Attribute();
-
         void setBase(double base);
         double getBase() const { return mBase; }
 
         double getModifiedAttribute() const
-        { return mMods.empty() ? mBase :
-                                 (*mMods.rbegin())->getCachedModifiedValue(); }
+        { return mModifiedValue; }
 
         /*
          * add() and remove() are the standard functions used to add and
@@ -155,8 +157,8 @@ class Attribute
          */
 
         /**
-         * @param duration The amount of time before the modifier expires
-         *        naturally.
+         * @param expireTick The tick at which the modifier expires
+         *        naturally, see expire().
          *        When set to 0, the effect does not expire.
          * @param value The value to be applied as the modifier.
          * @param layer The id of the layer with which this modifier is to be
@@ -164,7 +166,7 @@ class Attribute
          * @param id Used to identify this effect.
          * @return Whether the modified attribute value was changed.
          */
-        bool add(unsigned short duration, double value, unsigned layer, int id = 0);
+        bool add(int expireTick, double value, unsigned layer, int id = 0);
 
         /**
          * @param value The value of the modifier to be removed.
@@ -186,9 +188,11 @@ class Attribute
         void clearMods();
 
         /**
-         * tick() processes all timers associated with modifiers for this attribute.
+         * expire() removes the modifiers of this attribute that expired at
+         * the given tick.
+         * @returns Whether the modified attribute value was changed.
          */
-        bool tick();
+        bool expire(int tick);
 
     private:
         /**
@@ -197,10 +201,81 @@ class Attribute
          */
         double checkBounds(double baseValue) const;
 
+        /**
+         * Caches the value of the last layer, or the base value when there
+         * are no layers.
+         */
+        void updateModifiedValue();
+
         double mBase; // The attribute base value
         double mMinValue; // The min authorized base and derived attribute value
         double mMaxValue; // The max authorized base and derived attribute value
-        std::vector<AttributeModifiersEffect *> mMods;
+        double mModifiedValue; // The value after applying all the layers
+        std::vector<AttributeModifiersEffect> mMods;
+};
+
+/**
+ * The attributes of a being, stored next to each other in id order. They are
+ * found through the dense index given to each attribute by the attribute
+ * manager rather than through a tree lookup on their id.
+ */
+class AttributeMap
+{
+    public:
+        typedef std::pair<unsigned, Attribute> value_type;
+        typedef std::vector<value_type>::iterator iterator;
+        typedef std::vector<value_type>::const_iterator const_iterator;
+
+        /**
+         * Creates an attribute.
+         * @returns false when it already exists or is not known by the
+         *          attribute manager.
+         */
+        bool insert(unsigned id, const AttributeManager::AttributeInfo &info);
+
+        /**
+         * Gets an attribute or 0 if not existing.
+         */
+        Attribute *find(unsigned id)
+        {
+            const int slot = getSlot(id);
+            return slot < 0 ? 0 : &mAttributes[slot].second;
+        }
+
+        const Attribute *find(unsigned id) const
+        {
+            const int slot = getSlot(id);
+            return slot < 0 ? 0 : &mAttributes[slot].second;
+        }
+
+        /**
+         * Gets an attribute, throws std::out_of_range if not existing.
+         */
+        Attribute &at(unsigned id);
+
+        bool count(unsigned id) const
+        { return getSlot(id) >= 0; }
+
+        size_t size() const
+        { return mAttributes.size(); }
+
+        iterator begin() { return mAttributes.begin(); }
+        iterator end() { return mAttributes.end(); }
+        const_iterator begin() const { return mAttributes.begin(); }
+        const_iterator end() const { return mAttributes.end(); }
+
+    private:
+        int getSlot(unsigned id) const
+        {
+            const int index = attributeManager->getAttributeIndex(id);
+            return index >= 0 && index < (int) mSlots.size() ? mSlots[index]
+                                                             : -1;
+        }
+
+        std::vector<value_type> mAttributes;
+
+        /** Position in mAttributes for each attribute index, -1 if none. */
+        std::vector<short> mSlots;
 };
 
 #endif // ATTRIBUTE_H
@@ -0,0 +1,352 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/attributeformula.h"
+
+#include "game-server/being.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * Engine constants that formulas may use by name, so that they follow the
+ * values the server is built with.
+ */
+static const struct
+{
+    const char *name;
+    double value;
+} namedConstants[] = {
+    { "TICKS_PER_HP_REGENERATION", BeingComponent::TICKS_PER_HP_REGENERATION },
+};
+
+/**
+ * Recursive descent parser emitting the instructions of a formula in
+ * postfix order.
+ */
+class AttributeFormula::Parser
+{
+    public:
+        Parser(const std::string &expression,
+               std::vector<Instruction> &code,
+               std::vector<int> &dependencies):
+            mText(expression.c_str()),
+            mCode(code),
+            mDependencies(dependencies),
+            mDepth(0),
+            mNesting(0),
+            mValid(true)
+        {}
+
+        bool parse()
+        {
+            expression();
+            skipSpaces();
+            return mValid && !*mText;
+        }
+
+    private:
+        void skipSpaces()
+        {
+            while (isspace(*mText))
+                ++mText;
+        }
+
+        bool accept(char c)
+        {
+            skipSpaces();
+            if (*mText != c)
+                return false;
+            ++mText;
+            return true;
+        }
+
+        void expect(char c)
+        {
+            if (!accept(c))
+                mValid = false;
+        }
+
+        bool acceptWord(const char *word)
+        {
+            skipSpaces();
+            const size_t length = strlen(word);
+            if (strncmp(mText, word, length) != 0)
+                return false;
+            mText += length;
+            return true;
+        }
+
+        /**
+         * Enters a nested part of the formula, unless it is nested too deeply
+         * to be parsed without risking the call stack.
+         */
+        bool enter()
+        {
+            if (++mNesting > MAX_NESTING)
+                mValid = false;
+            return mValid;
+        }
+
+        void leave()
+        {
+            --mNesting;
+        }
+
+        /**
+         * Emits an instruction, given how much it changes the stack size.
+         */
+        void emit(OpCode op, int stackChange, double value = 0)
+        {
+            const Instruction instruction = { op, value };
+            mCode.push_back(instruction);
+
+            mDepth += stackChange;
+            if (mDepth > MAX_STACK)
+                mValid = false;
+        }
+
+        void expression()
+        {
+            term();
+            while (mValid)
+            {
+                if (accept('+'))
+                {
+                    term();
+                    emit(OP_ADD, -1);
+                }
+                else if (accept('-'))
+                {
+                    term();
+                    emit(OP_SUBTRACT, -1);
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+
+        void term()
+        {
+            unary();
+            while (mValid)
+            {
+                if (accept('*'))
+                {
+                    unary();
+                    emit(OP_MULTIPLY, -1);
+                }
+                else if (accept('/'))
+                {
+                    unary();
+                    emit(OP_DIVIDE, -1);
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+
+        void unary()
+        {
+            if (accept('-'))
+            {
+                if (enter())
+                {
+                    unary();
+                    emit(OP_NEGATE, 0);
+                }
+                leave();
+            }
+            else
+            {
+                primary();
+            }
+        }
+
+        void primary()
+        {
+            skipSpaces();
+
+            if (accept('('))
+            {
+                if (enter())
+                {
+                    expression();
+                    expect(')');
+                }
+                leave();
+            }
+            else if (accept('['))
+            {
+                char *end;
+                const long id = strtol(mText, &end, 10);
+                if (end == mText || id <= 0)
+                {
+                    mValid = false;
+                    return;
+                }
+                mText = end;
+                expect(']');
+
+                emit(OP_ATTRIBUTE, 1, id);
+                if (std::find(mDependencies.begin(), mDependencies.end(),
+                              id) == mDependencies.end())
+                {
+                    mDependencies.push_back(id);
+                }
+            }
+            else if (acceptWord("min"))
+            {
+                function(OP_MIN);
+            }
+            else if (acceptWord("max"))
+            {
+                function(OP_MAX);
+            }
+            else if (isalpha(*mText))
+            {
+                constant();
+            }
+            else
+            {
+                char *end;
+                const double value = strtod(mText, &end);
+                if (end == mText)
+                {
+                    mValid = false;
+                    return;
+                }
+                mText = end;
+                emit(OP_CONSTANT, 1, value);
+            }
+        }
+
+        void function(OpCode op)
+        {
+            if (enter())
+            {
+                expect('(');
+                expression();
+                expect(',');
+                expression();
+                expect(')');
+                emit(op, -1);
+            }
+            leave();
+        }
+
+        void constant()
+        {
+            const char *end = mText;
+            while (isalnum(*end) || *end == '_')
+                ++end;
+            const std::string name(mText, end);
+
+            for (size_t i = 0;
+                 i < sizeof(namedConstants) / sizeof(namedConstants[0]); ++i)
+            {
+                if (name == namedConstants[i].name)
+                {
+                    mText = end;
+                    emit(OP_CONSTANT, 1, namedConstants[i].value);
+                    return;
+                }
+            }
+            mValid = false;
+        }
+
+        const char *mText;
+        std::vector<Instruction> &mCode;
+        std::vector<int> &mDependencies;
+        int mDepth;                 /**< Stack size after the last emit. */
+        int mNesting;               /**< Nested parts being parsed. */
+        bool mValid;
+};
+
+bool AttributeFormula::parse(const std::string &expression)
+{
+    mCode.clear();
+    mDependencies.clear();
+
+    Parser parser(expression, mCode, mDependencies);
+    if (parser.parse())
+        return true;
+
+    mCode.clear();
+    mDependencies.clear();
+    return false;
+}
+
+double AttributeFormula::evaluate(const BeingComponent &being) const
+{
+    double stack[MAX_STACK];
+    int size = 0;
+
+    for (std::vector<Instruction>::const_iterator it = mCode.begin(),
+         it_end = mCode.end(); it != it_end; ++it)
+    {
+        switch (it->op)
+        {
+            case OP_CONSTANT:
+                stack[size++] = it->value;
+                break;
+            case OP_ATTRIBUTE:
+                stack[size++] = being.getModifiedAttribute(
+                        (unsigned) it->value);
+                break;
+            case OP_ADD:
+                --size;
+                stack[size - 1] += stack[size];
+                break;
+            case OP_SUBTRACT:
+                --size;
+                stack[size - 1] -= stack[size];
+                break;
+            case OP_MULTIPLY:
+                --size;
+                stack[size - 1] *= stack[size];
+                break;
+            case OP_DIVIDE:
+                --size;
+                stack[size - 1] = stack[size] ? stack[size - 1] / stack[size]
+                                              : 0;
+                break;
+            case OP_NEGATE:
+                stack[size - 1] = -stack[size - 1];
+                break;
+            case OP_MIN:
+                --size;
+                stack[size - 1] = std::min(stack[size - 1], stack[size]);
+                break;
+            case OP_MAX:
+                --size;
+                stack[size - 1] = std::max(stack[size - 1], stack[size]);
+                break;
+        }
+    }
+
+    return size ? stack[size - 1] : 0;
+}
@@ -0,0 +1,101 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ATTRIBUTEFORMULA_H
+#define ATTRIBUTEFORMULA_H
+
+#include <string>
+#include <vector>
+
+class BeingComponent;
+
+/**
+ * Formula giving the base value of an attribute from the modified values of
+ * other attributes, declared in the attributes file. It is compiled once into
+ * a list of stack machine instructions, so that derived attributes can be
+ * recalculated without going through the scripting engine.
+ *
+ * The formula supports numbers, the operators + - * / and parentheses, the
+ * functions min(a, b) and max(a, b), a few named engine constants such as
+ * TICKS_PER_HP_REGENERATION, and references to the modified value of other
+ * attributes written as their id between square brackets:
+ *
+ *   ([3] + 3) * ([3] + 20) * 0.125
+ */
+class AttributeFormula
+{
+    public:
+        /**
+         * Compiles the given expression, replacing the previous formula.
+         * @returns false when the expression is not valid, in which case the
+         *          formula is left empty.
+         */
+        bool parse(const std::string &expression);
+
+        /**
+         * Tells whether a formula was compiled.
+         */
+        bool isValid() const
+        { return !mCode.empty(); }
+
+        /**
+         * Computes the value of the formula for the given being.
+         */
+        double evaluate(const BeingComponent &being) const;
+
+        /**
+         * Gets the ids of the attributes used by the formula.
+         */
+        const std::vector<int> &getDependencies() const
+        { return mDependencies; }
+
+    private:
+        enum OpCode
+        {
+            OP_CONSTANT,
+            OP_ATTRIBUTE,
+            OP_ADD,
+            OP_SUBTRACT,
+            OP_MULTIPLY,
+            OP_DIVIDE,
+            OP_NEGATE,
+            OP_MIN,
+            OP_MAX
+        };
+
+        struct Instruction
+        {
+            OpCode op;
+            double value;       /**< Constant, or id of the attribute. */
+        };
+
+        /** Maximum number of values on the stack while evaluating. */
+        static const int MAX_STACK = 16;
+
+        /** Maximum nesting of parentheses, functions and unary minus. */
+        static const int MAX_NESTING = 32;
+
+        class Parser;
+
+        std::vector<Instruction> mCode;
+        std::vector<int> mDependencies;
+};
+
+#endif // ATTRIBUTEFORMULA_H
@@ -20,6 +20,8 @@
 
 #include "game-server/attributemanager.h"
 
+#include <algorithm>
+
 #include "common/defines.h"
 #include "utils/string.h"
 #include "utils/logger.h"
@@ -33,6 +35,9 @@ void AttributeManager::reload()
 {
     mTagMap.clear();
     mAttributeMap.clear();
+    mIndices.clear();
+    mFormulaOrder.clear();
+    mDependants.clear();
     for (unsigned i = 0; i < MaxScope; ++i)
         mAttributeScopes[i].clear();
 }
@@ -58,6 +63,23 @@ bool AttributeManager::isAttributeDirectlyModifiable(int id) const
     return ret->second.modifiable;
 }
 
+const AttributeFormula *AttributeManager::getFormula(int id) const
+{
+    AttributeMap::const_iterator ret = mAttributeMap.find(id);
+    if (ret == mAttributeMap.end() || !ret->second.formula.isValid())
+        return 0;
+    return &ret->second.formula;
+}
+
+const std::vector<unsigned> *AttributeManager::getDependants(int id) const
+{
+    std::map<int, std::vector<unsigned> >::const_iterator ret =
+            mDependants.find(id);
+    if (ret == mDependants.end())
+        return 0;
+    return &ret->second;
+}
+
 ModifierLocation AttributeManager::getLocation(const std::string &tag) const
 {
     if (mTagMap.find(tag) != mTagMap.end())
@@ -90,6 +112,13 @@ void AttributeManager::readAttributeNode(xmlNodePtr attributeNode)
         return;
     }
 
+    if (mAttributeMap.find(id) == mAttributeMap.end())
+    {
+        if (id >= (int) mIndices.size())
+            mIndices.resize(id + 1, -1);
+        mIndices[id] = mAttributeMap.size();
+    }
+
     AttributeInfo &attribute = mAttributeMap[id];
 
     attribute.modifiers = std::vector<AttributeModifier>();
@@ -100,6 +129,19 @@ void AttributeManager::readAttributeNode(xmlNodePtr attributeNode)
     attribute.modifiable = XML::getBoolProperty(attributeNode, "modifiable",
                                                 false);
 
+    const std::string formula = XML::getProperty(attributeNode, "formula",
+                                                 std::string());
+    attribute.formula = AttributeFormula();
+    if (!formula.empty())
+    {
+        if (!attribute.formula.parse(formula))
+        {
+            LOG_WARN("Attribute manager: attribute '" << id
+                     << "' has an invalid formula '" << formula
+                     << "', leaving it to the scripts.");
+        }
+    }
+
     for_each_xml_child_node(subNode, attributeNode)
     {
         if (xmlStrEqual(subNode->name, BAD_CAST "modifier"))
@@ -147,6 +189,8 @@ void AttributeManager::readAttributeNode(xmlNodePtr attributeNode)
  */
 void AttributeManager::checkStatus()
 {
+    sortFormulas();
+
     LOG_DEBUG("attribute map:");
     LOG_DEBUG("Stackable is " << Stackable << ", NonStackable is " << NonStackable
               << ", NonStackableBonus is " << NonStackableBonus << ".");
@@ -183,6 +227,77 @@ void AttributeManager::checkStatus()
     LOG_INFO("Loaded '" << mTagMap.size() << "' modifier tags.");
 }
 
+void AttributeManager::sortFormulas()
+{
+    mFormulaOrder.clear();
+    mDependants.clear();
+
+    // Depth first, so that the dependencies of a formula are ordered before
+    // it. Visits: 1 while the dependencies are being visited, 2 once done.
+    std::map<int, int> visits;
+    std::vector<int> path;
+    std::set<int> cyclic;
+    for (AttributeMap::const_iterator i = mAttributeMap.begin(),
+         i_end = mAttributeMap.end(); i != i_end; ++i)
+    {
+        if (i->second.formula.isValid() && !visits[i->first])
+            visitFormula(i->first, visits, path, cyclic);
+    }
+
+    // Taking formulas out of the order keeps the others in order
+    for (std::set<int>::const_iterator i = cyclic.begin(),
+         i_end = cyclic.end(); i != i_end; ++i)
+    {
+        LOG_ERROR("Attribute manager: the formula of attribute '" << *i
+                  << "' depends on itself, leaving it to the scripts.");
+        mAttributeMap[*i].formula = AttributeFormula();
+        mFormulaOrder.erase(std::find(mFormulaOrder.begin(),
+                                      mFormulaOrder.end(), *i));
+    }
+
+    for (unsigned rank = 0; rank < mFormulaOrder.size(); ++rank)
+    {
+        const AttributeFormula &formula =
+                mAttributeMap[mFormulaOrder[rank]].formula;
+        for (int dependency : formula.getDependencies())
+        {
+            std::vector<unsigned> &dependants = mDependants[dependency];
+            if (dependants.empty() || dependants.back() != rank)
+                dependants.push_back(rank);
+        }
+    }
+}
+
+void AttributeManager::visitFormula(int id, std::map<int, int> &visits,
+                                    std::vector<int> &path,
+                                    std::set<int> &cyclic)
+{
+    visits[id] = 1;
+    path.push_back(id);
+
+    for (int dependency : mAttributeMap[id].formula.getDependencies())
+    {
+        AttributeMap::const_iterator it = mAttributeMap.find(dependency);
+        if (it == mAttributeMap.end() || !it->second.formula.isValid())
+            continue;
+
+        if (visits[dependency] == 1)
+        {
+            // Back on the path: everything from there on is a cycle
+            cyclic.insert(std::find(path.begin(), path.end(), dependency),
+                          path.end());
+        }
+        else if (!visits[dependency])
+        {
+            visitFormula(dependency, visits, path, cyclic);
+        }
+    }
+
+    path.pop_back();
+    visits[id] = 2;
+    mFormulaOrder.push_back(id);
+}
+
 void AttributeManager::readModifierNode(xmlNodePtr modifierNode,
                                         int attributeId)
 {
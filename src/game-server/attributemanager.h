@@ -22,10 +22,12 @@
 #define ATTRIBUTEMANAGER_H
 
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
 #include <limits>
 
+#include "game-server/attributeformula.h"
 #include "utils/xml.h"
 
 enum ScopeType
@@ -103,6 +105,8 @@ class AttributeManager
             bool modifiable;
             /** Effect modifier type: stackability and modification type. */
             std::vector<struct AttributeModifier> modifiers;
+            /** Native formula for the base value, if any. */
+            AttributeFormula formula;
         };
 
         AttributeManager()
@@ -127,6 +131,38 @@ class AttributeManager
 
         bool isAttributeDirectlyModifiable(int id) const;
 
+        /**
+         * Gets the dense index of an attribute, or -1 if it is not known.
+         * Used to store the attributes of a being in a flat table.
+         */
+        int getAttributeIndex(int id) const
+        {
+            return id >= 0 && id < (int) mIndices.size() ? mIndices[id] : -1;
+        }
+
+        unsigned getAttributeCount() const
+        { return mAttributeMap.size(); }
+
+        /**
+         * Gets the native formula of an attribute, or 0 if it has none and
+         * its base value is left to the scripts.
+         */
+        const AttributeFormula *getFormula(int id) const;
+
+        /**
+         * Gets the ids of the attributes with a native formula, ordered so
+         * that each one comes after the attributes its formula uses.
+         */
+        const std::vector<int> &getFormulaOrder() const
+        { return mFormulaOrder; }
+
+        /**
+         * Gets the positions in the formula order of the attributes whose
+         * formula uses the given attribute, in increasing order, or 0 if
+         * there are none.
+         */
+        const std::vector<unsigned> *getDependants(int id) const;
+
         ModifierLocation getLocation(const std::string &tag) const;
 
         const std::string *getTag(const ModifierLocation &location) const;
@@ -138,6 +174,16 @@ class AttributeManager
     private:
         void readModifierNode(xmlNodePtr modifierNode, int attributeId);
 
+        /**
+         * Orders the formulas by their dependencies and indexes their
+         * dependants. Formulas that depend on themselves, directly or not,
+         * are dropped and left to the scripts.
+         */
+        void sortFormulas();
+
+        void visitFormula(int id, std::map<int, int> &visits,
+                          std::vector<int> &path, std::set<int> &cyclic);
+
         // Attribute id -> { modifiable, min, max, { stackable type, effect type }[] }
         typedef std::map<int, AttributeInfo> AttributeMap;
 
@@ -146,6 +192,13 @@ class AttributeManager
 
         AttributeScope mAttributeScopes[MaxScope];
         AttributeMap mAttributeMap;
+        std::vector<int> mIndices;      /**< Attribute id -> dense index. */
+
+        /** Attributes with formulas, dependencies first. */
+        std::vector<int> mFormulaOrder;
+
+        /** Attribute id -> formula order of the formulas using it. */
+        std::map<int, std::vector<unsigned> > mDependants;
         TagMap mTagMap;
 };
 
@@ -18,7 +18,9 @@
  *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <functional>
 
 #include "game-server/being.h"
 
@@ -30,7 +32,9 @@
 #include "game-server/combatcomponent.h"
 #include "game-server/mapcomposite.h"
 #include "game-server/effect.h"
+#include "game-server/pathqueue.h"
 #include "game-server/skillmanager.h"
+#include "game-server/state.h"
 #include "game-server/statuseffect.h"
 #include "game-server/statusmanager.h"
 #include "utils/logger.h"
@@ -39,14 +43,18 @@
 
 
 Script::Ref BeingComponent::mRecalculateDerivedAttributesCallback;
+Script::Ref BeingComponent::mRecalculateDerivedAttributeCallback;
 Script::Ref BeingComponent::mRecalculateBaseAttributeCallback;
 
 BeingComponent::BeingComponent(Entity &entity):
     mMoveTime(0),
     mAction(STAND),
+    mFollowsFlowField(false),
     mGender(GENDER_UNSPECIFIED),
+    mPathSearch(PATH_SEARCH_NONE),
     mDirection(DOWN),
-    mEmoteId(0)
+    mEmoteId(0),
+    mLastUpdateTick(GameState::getCurrentTick())
 {
     const AttributeManager::AttributeScope &attr = attributeManager->getAttributeScope(BeingScope);
     LOG_DEBUG("Being creation: initialisation of " << attr.size() << " attributes.");
@@ -58,14 +66,15 @@ BeingComponent::BeingComponent(Entity &entity):
         if (mAttributes.count(it1->first))
             LOG_WARN("Redefinition of attribute '" << it1->first << "'!");
         LOG_DEBUG("Attempting to create attribute '" << it1->first << "'.");
-        mAttributes.insert(std::make_pair(it1->first,
-                                          Attribute(*it1->second)));
+        mAttributes.insert(it1->first, *it1->second);
     }
 
     clearDestination(entity);
 
-    entity.signal_inserted.connect(sigc::mem_fun(this,
-                                                 &BeingComponent::inserted));
+    mInsertedListener.connect<BeingComponent, &BeingComponent::inserted>(
+            entity.signal_inserted, this);
+    mRemovedListener.connect<BeingComponent, &BeingComponent::removed>(
+            entity.signal_removed, this);
 
     // TODO: Way to define default base values?
     // Should this be handled by the virtual modifiedAttribute?
@@ -131,10 +140,39 @@ void BeingComponent::died(Entity &entity)
 
 void BeingComponent::setDestination(Entity &entity, const Point &dst)
 {
+    // Monsters chasing a target set their destination again on every
+    // update. The path, or its queued search, holds as long as the
+    // destination stays on the same tile.
+    bool sameTile = false;
+    if (!mPath.empty() || mPathSearch == PATH_SEARCH_QUEUED)
+    {
+        const Map *map = entity.getMap()->getMap();
+        const int tileWidth = map->getTileWidth();
+        const int tileHeight = map->getTileHeight();
+        sameTile = dst.x / tileWidth == mDst.x / tileWidth &&
+                   dst.y / tileHeight == mDst.y / tileHeight;
+    }
+
     mDst = dst;
+    mFollowsFlowField = false;
     entity.getComponent<ActorComponent>()->raiseUpdateFlags(
             UPDATEFLAG_NEW_DESTINATION);
-    mPath.clear();
+
+    if (!sameTile)
+    {
+        if (mPathSearch == PATH_SEARCH_QUEUED)
+            PathQueue::cancel(entity);
+        mPathSearch = PATH_SEARCH_NONE;
+        mPath.clear();
+    }
+}
+
+void BeingComponent::setDestination(Entity &entity, const Point &dst,
+                                    const Point &flowTarget)
+{
+    setDestination(entity, dst);
+    mFlowTarget = flowTarget;
+    mFollowsFlowField = true;
 }
 
 void BeingComponent::clearDestination(Entity &entity)
@@ -143,6 +181,17 @@ void BeingComponent::clearDestination(Entity &entity)
                    entity.getComponent<ActorComponent>()->getPosition());
 }
 
+Point BeingComponent::getNextStep(Entity &entity) const
+{
+    if (mPath.empty())
+        return entity.getComponent<ActorComponent>()->getPosition();
+
+    const Map *map = entity.getMap()->getMap();
+    const Point &next = mPath.front();
+    return Point(next.x * map->getTileWidth() + map->getTileWidth() / 2,
+                 next.y * map->getTileHeight() + map->getTileHeight() / 2);
+}
+
 void BeingComponent::setDirection(Entity &entity, BeingDirection direction)
 {
     mDirection = direction;
@@ -150,19 +199,53 @@ void BeingComponent::setDirection(Entity &entity, BeingDirection direction)
             UPDATEFLAG_DIRCHANGE);
 }
 
-Path BeingComponent::findPath(Entity &entity)
+PathRequest BeingComponent::getPathRequest(Entity &entity) const
 {
     auto *actorComponent = entity.getComponent<ActorComponent>();
 
     Map *map = entity.getMap()->getMap();
     int tileWidth = map->getTileWidth();
     int tileHeight = map->getTileHeight();
-    int startX = actorComponent->getPosition().x / tileWidth;
-    int startY = actorComponent->getPosition().y / tileHeight;
-    int destX = mDst.x / tileWidth, destY = mDst.y / tileHeight;
 
-    return map->findPath(startX, startY, destX, destY,
-                         actorComponent->getWalkMask());
+    PathRequest request;
+    request.map = map;
+    request.start = Point(actorComponent->getPosition().x / tileWidth,
+                          actorComponent->getPosition().y / tileHeight);
+    request.dest = Point(mDst.x / tileWidth, mDst.y / tileHeight);
+    request.walkmask = actorComponent->getWalkMask();
+    // Characters are walked by their clients, which must not be able to
+    // ask for searches across the whole map
+    const Configuration::Settings &settings = Configuration::getSettings();
+    request.maxCost = entity.getType() == OBJECT_CHARACTER ?
+            settings.characterPathCost : settings.pathCost;
+    request.followsFlowField = mFollowsFlowField;
+    request.flowTarget = Point(mFlowTarget.x / tileWidth,
+                               mFlowTarget.y / tileHeight);
+    return request;
+}
+
+Path BeingComponent::findPath(Entity &entity)
+{
+    return PathQueue::search(getPathRequest(entity));
+}
+
+void BeingComponent::pathFound(Entity &entity, const Point &start,
+                               const Path &path)
+{
+    const Point &position =
+            entity.getComponent<ActorComponent>()->getPosition();
+    Map *map = entity.getMap()->getMap();
+
+    // A being that was moved meanwhile needs another search
+    if (position.x / map->getTileWidth() != start.x ||
+        position.y / map->getTileHeight() != start.y)
+    {
+        mPathSearch = PATH_SEARCH_NONE;
+        return;
+    }
+
+    mPath = path;
+    mPathSearch = PATH_SEARCH_DONE;
 }
 
 void BeingComponent::updateDirection(Entity &entity,
@@ -241,16 +324,31 @@ void BeingComponent::move(Entity &entity)
         if (!map->getWalk(point.x, point.y, walkmask))
         {
             mPath.clear();
+            mPathSearch = PATH_SEARCH_NONE;
             break;
         }
     }
 
-    if (mPath.empty())
+    if (mPath.empty() && mPathSearch != PATH_SEARCH_DONE)
     {
+        // The being waits for the result of the search it queued
+        if (mPathSearch == PATH_SEARCH_QUEUED)
+            return;
+
         // No path exists: the walkability of cached path has changed, the
         // destination has changed, or a path was never set.
-        mPath = findPath(entity);
+        if (PathQueue::searchNow(entity))
+        {
+            mPath = findPath(entity);
+        }
+        else
+        {
+            PathQueue::queue(entity, getPathRequest(entity));
+            mPathSearch = PATH_SEARCH_QUEUED;
+            return;
+        }
     }
+    mPathSearch = PATH_SEARCH_NONE;
 
     if (mPath.empty())
     {
@@ -322,8 +420,19 @@ void BeingComponent::applyModifier(Entity &entity, unsigned attr, double value,
                                    unsigned layer, unsigned duration,
                                    unsigned id)
 {
-    mAttributes.at(attr).add(duration, value, layer, id);
-    updateDerivedAttributes(entity, attr);
+    const int expireTick =
+            duration ? GameState::getCurrentTick() + duration : 0;
+
+    if (expireTick)
+    {
+        const ModifierExpiry expiry = { expireTick, attr };
+        mModifierExpiries.push_back(expiry);
+        std::push_heap(mModifierExpiries.begin(), mModifierExpiries.end(),
+                       std::greater<ModifierExpiry>());
+    }
+
+    if (mAttributes.at(attr).add(expireTick, value, layer, id))
+        updateDerivedAttributes(entity, attr);
 }
 
 bool BeingComponent::removeModifier(Entity &entity, unsigned attr,
@@ -331,7 +440,8 @@ bool BeingComponent::removeModifier(Entity &entity, unsigned attr,
                                     unsigned id, bool fullcheck)
 {
     bool ret = mAttributes.at(attr).remove(value, layer, id, fullcheck);
-    updateDerivedAttributes(entity, attr);
+    if (ret)
+        updateDerivedAttributes(entity, attr);
     return ret;
 }
 
@@ -342,8 +452,8 @@ void BeingComponent::setGender(BeingGender gender)
 
 void BeingComponent::setAttribute(Entity &entity, unsigned id, double value)
 {
-    AttributeMap::iterator ret = mAttributes.find(id);
-    if (ret == mAttributes.end())
+    Attribute *ret = mAttributes.find(id);
+    if (!ret)
     {
         /*
          * The attribute does not yet exist, so we must attempt to create it.
@@ -355,7 +465,7 @@ void BeingComponent::setAttribute(Entity &entity, unsigned id, double value)
     }
     else
     {
-        ret->second.setBase(value);
+        ret->setBase(value);
         updateDerivedAttributes(entity, id);
     }
 }
@@ -363,45 +473,44 @@ void BeingComponent::setAttribute(Entity &entity, unsigned id, double value)
 void BeingComponent::createAttribute(unsigned id, const AttributeManager::AttributeInfo
                             &attributeInfo)
 {
-    mAttributes.insert(std::pair<unsigned, Attribute>
-                                            (id,Attribute(attributeInfo)));
+    mAttributes.insert(id, attributeInfo);
 }
 
 const Attribute *BeingComponent::getAttribute(unsigned id) const
 {
-    AttributeMap::const_iterator ret = mAttributes.find(id);
-    if (ret == mAttributes.end())
+    const Attribute *ret = mAttributes.find(id);
+    if (!ret)
     {
         LOG_DEBUG("BeingComponent::getAttribute: Attribute "
                   << id << " not found! Returning 0.");
         return 0;
     }
-    return &ret->second;
+    return ret;
 }
 
 double BeingComponent::getAttributeBase(unsigned id) const
 {
-    AttributeMap::const_iterator ret = mAttributes.find(id);
-    if (ret == mAttributes.end())
+    const Attribute *ret = mAttributes.find(id);
+    if (!ret)
     {
         LOG_DEBUG("BeingComponent::getAttributeBase: Attribute "
                   << id << " not found! Returning 0.");
         return 0;
     }
-    return ret->second.getBase();
+    return ret->getBase();
 }
 
 
 double BeingComponent::getModifiedAttribute(unsigned id) const
 {
-    AttributeMap::const_iterator ret = mAttributes.find(id);
-    if (ret == mAttributes.end())
+    const Attribute *ret = mAttributes.find(id);
+    if (!ret)
     {
         LOG_DEBUG("BeingComponent::getModifiedAttribute: Attribute "
                   << id << " not found! Returning 0.");
         return 0;
     }
-    return ret->second.getModifiedAttribute();
+    return ret->getModifiedAttribute();
 }
 
 void BeingComponent::setModAttribute(unsigned, double)
@@ -431,6 +540,15 @@ void BeingComponent::recalculateBaseAttribute(Entity &entity, unsigned attr)
         return;
     }
 
+    // Formulas from the attributes file do not need the script engine
+    if (const AttributeFormula *formula = attributeManager->getFormula(attr))
+    {
+        double newBase = formula->evaluate(*this);
+        if (newBase != getAttributeBase(attr))
+            setAttribute(entity, attr, newBase);
+        return;
+    }
+
     if (!mRecalculateBaseAttributeCallback.isValid())
         return;
 
@@ -443,9 +561,19 @@ void BeingComponent::recalculateBaseAttribute(Entity &entity, unsigned attr)
 
 void BeingComponent::updateDerivedAttributes(Entity &entity, unsigned attr)
 {
-    signal_attribute_changed.emit(&entity, attr);
+    LOG_DEBUG("Being: Queuing update of derived attribute(s) of: " << attr);
 
-    LOG_DEBUG("Being: Updating derived attribute(s) of: " << attr);
+    if (mChangedAttributes.empty())
+    {
+        if (MapComposite *map = entity.getMap())
+            map->attributesChanged(&entity);
+    }
+
+    if (std::find(mChangedAttributes.begin(), mChangedAttributes.end(),
+                  attr) == mChangedAttributes.end())
+    {
+        mChangedAttributes.push_back(attr);
+    }
 
     // Handle default actions before handing over to the script engine
     switch (attr)
@@ -461,15 +589,86 @@ void BeingComponent::updateDerivedAttributes(Entity &entity, unsigned attr)
         recalculateBaseAttribute(entity, ATTR_MOVE_SPEED_RAW);
         break;
     }
+}
+
+void BeingComponent::recalculateFormulas(Entity &entity)
+{
+    // Start at the first formula using a changed attribute
+    const std::vector<int> &order = attributeManager->getFormulaOrder();
+    unsigned first = order.size();
+    for (unsigned attr : mChangedAttributes)
+    {
+        if (const std::vector<unsigned> *dependants =
+                attributeManager->getDependants(attr))
+            first = std::min(first, dependants->front());
+    }
 
-    if (!mRecalculateDerivedAttributesCallback.isValid())
+    // Formulas come after the attributes they use, and attributes changed on
+    // the way are appended to the list, so every formula sees the final
+    // values of its dependencies.
+    for (unsigned rank = first; rank < order.size(); ++rank)
+    {
+        const int id = order[rank];
+        if (!mAttributes.count(id))
+            continue;
+
+        for (int dependency :
+             attributeManager->getFormula(id)->getDependencies())
+        {
+            if (std::find(mChangedAttributes.begin(), mChangedAttributes.end(),
+                          (unsigned) dependency) != mChangedAttributes.end())
+            {
+                recalculateBaseAttribute(entity, id);
+                break;
+            }
+        }
+    }
+}
+
+void BeingComponent::flushChangedAttributes(Entity &entity)
+{
+    if (mChangedAttributes.empty())
         return;
 
-    Script *script = ScriptManager::currentState();
-    script->prepare(mRecalculateDerivedAttributesCallback);
-    script->push(&entity);
-    script->push(attr);
-    script->execute(entity.getMap());
+    recalculateFormulas(entity);
+
+    std::vector<unsigned> changed;
+    changed.swap(mChangedAttributes);
+
+    for (unsigned attr : changed)
+        signal_attribute_changed.emit(&entity, attr);
+
+    if (mRecalculateDerivedAttributesCallback.isValid())
+    {
+        Script *script = ScriptManager::currentState();
+        script->prepare(mRecalculateDerivedAttributesCallback);
+        script->push(&entity);
+        script->push(std::vector<int>(changed.begin(), changed.end()));
+        script->execute(entity.getMap());
+    }
+    else if (mRecalculateDerivedAttributeCallback.isValid())
+    {
+        Script *script = ScriptManager::currentState();
+        for (unsigned attr : changed)
+        {
+            script->prepare(mRecalculateDerivedAttributeCallback);
+            script->push(&entity);
+            script->push(attr);
+            script->execute(entity.getMap());
+        }
+    }
+
+    // The formulas using the attributes changed by the callback are
+    // recalculated, but the callback is not called again
+    while (!mChangedAttributes.empty())
+    {
+        recalculateFormulas(entity);
+
+        changed.clear();
+        changed.swap(mChangedAttributes);
+        for (unsigned attr : changed)
+            signal_attribute_changed.emit(&entity, attr);
+    }
 }
 
 void BeingComponent::applyStatusEffect(int id, int timer)
@@ -520,6 +719,11 @@ void BeingComponent::setStatusEffectTime(int id, int time)
 
 void BeingComponent::update(Entity &entity)
 {
+    // Ticks since the last update, more than one on hibernating maps
+    const int currentTick = GameState::getCurrentTick();
+    const int elapsed = std::max(1, currentTick - mLastUpdateTick);
+    mLastUpdateTick = currentTick;
+
     int oldHP = getModifiedAttribute(ATTR_HP);
     int newHP = oldHP;
     int maxHP = getModifiedAttribute(ATTR_MAX_HP);
@@ -527,8 +731,10 @@ void BeingComponent::update(Entity &entity)
     // Regenerate HP
     if (mAction != DEAD && mHealthRegenerationTimeout.expired())
     {
+        const int regenerations =
+                1 + (elapsed - 1) / TICKS_PER_HP_REGENERATION;
         mHealthRegenerationTimeout.set(TICKS_PER_HP_REGENERATION);
-        newHP += getModifiedAttribute(ATTR_HP_REGEN);
+        newHP += regenerations * getModifiedAttribute(ATTR_HP_REGEN);
     }
     // Cap HP at maximum
     if (newHP > maxHP)
@@ -543,24 +749,33 @@ void BeingComponent::update(Entity &entity)
                 UPDATEFLAG_HEALTHCHANGE);
     }
 
-    // Update lifetime of effects.
-    for (AttributeMap::iterator it = mAttributes.begin();
-         it != mAttributes.end();
-         ++it)
-    {
-        if (it->second.tick())
-            updateDerivedAttributes(entity, it->first);
-    }
+    expireModifiers(entity, currentTick);
 
-    // Update and run status effects
+    // Update status effects and queue their ticks when due, the ticks of
+    // all the beings of the map are run in batches after its update
     StatusEffects::iterator it = mStatus.begin();
     while (it != mStatus.end())
     {
-        it->second.time--;
-        if (it->second.time > 0 && mAction != DEAD)
-            it->second.status->tick(entity, it->second.time);
+        StatusEffect *statusEffect = it->second.status;
+        const int oldTime = it->second.time;
+        const int newTime = std::max(0, oldTime - elapsed);
+        it->second.time = newTime;
+
+        if (newTime > 0 && mAction != DEAD &&
+            statusEffect->hasTickCallback())
+        {
+            // Due each time the time reaches a multiple of the interval.
+            // After several ticks on a hibernating map, the being is queued
+            // once for every multiple it went past, oldest first.
+            const int interval = statusEffect->getTickInterval();
+            for (int time = (oldTime - 1) / interval * interval;
+                 time >= newTime; time -= interval)
+            {
+                StatusManager::queueTick(statusEffect, entity, time);
+            }
+        }
 
-        if (it->second.time <= 0 || mAction == DEAD)
+        if (newTime <= 0 || mAction == DEAD)
         {
             StatusEffects::iterator removeIt = it;
             ++it; // bring this iterator to the safety of the next element
@@ -577,9 +792,42 @@ void BeingComponent::update(Entity &entity)
         died(entity);
 }
 
+void BeingComponent::expireModifiers(Entity &entity, int tick)
+{
+    while (!mModifierExpiries.empty() &&
+           mModifierExpiries.front().tick <= tick)
+    {
+        const unsigned attr = mModifierExpiries.front().attribute;
+        std::pop_heap(mModifierExpiries.begin(), mModifierExpiries.end(),
+                      std::greater<ModifierExpiry>());
+        mModifierExpiries.pop_back();
+
+        // Modifiers removed or cleared in the meantime leave stale entries
+        Attribute *attribute = mAttributes.find(attr);
+        if (attribute && attribute->expire(tick))
+            updateDerivedAttributes(entity, attr);
+    }
+}
+
 void BeingComponent::inserted(Entity *entity)
 {
     // Reset the old position, since after insertion it is important that it is
     // in sync with the zone that we're currently present in.
     mOld = entity->getComponent<ActorComponent>()->getPosition();
+
+    // Ticks spent off the map are not caught up
+    mLastUpdateTick = GameState::getCurrentTick();
+
+    // Changes made while off the map are flushed with the ones of the map
+    if (!mChangedAttributes.empty())
+        entity->getMap()->attributesChanged(entity);
+}
+
+void BeingComponent::removed(Entity *entity)
+{
+    // The path was for the map the being leaves
+    if (mPathSearch == PATH_SEARCH_QUEUED)
+        PathQueue::cancel(*entity);
+    mPathSearch = PATH_SEARCH_NONE;
+    mPath.clear();
 }
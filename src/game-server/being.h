@@ -31,12 +31,29 @@
 #include "game-server/attribute.h"
 #include "game-server/attack.h"
 #include "game-server/timeout.h"
+#include "net/messageout.h"
 
 class BeingComponent;
 class MapComposite;
 class StatusEffect;
+struct PathRequest;
 
-typedef std::map< unsigned, Attribute > AttributeMap;
+/**
+ * Parts of the messages about a being that are the same for every client
+ * seeing it. They are serialized once per tick, and are only valid when the
+ * matching change happened during that tick.
+ */
+enum UpdateFragment
+{
+    FRAGMENT_ATTACK = 0,    /**< UPDATEFLAG_ATTACK */
+    FRAGMENT_ACTION,        /**< UPDATEFLAG_ACTIONCHANGE */
+    FRAGMENT_LOOKS,         /**< UPDATEFLAG_LOOKSCHANGE, kept until then. */
+    FRAGMENT_EMOTE,         /**< UPDATEFLAG_EMOTE */
+    FRAGMENT_DIRECTION,     /**< UPDATEFLAG_DIRCHANGE */
+    FRAGMENT_MOVE,          /**< Change of position. */
+    FRAGMENT_DAMAGE,        /**< Hits taken. */
+    FRAGMENT_COUNT
+};
 
 struct Status
 {
@@ -87,12 +104,26 @@ class BeingComponent : public Component
          */
         void setDestination(Entity &entity, const Point &dst);
 
+        /**
+         * Sets the destination coordinates of the being, close to a position
+         * other beings may be heading to as well. The path then follows the
+         * flow field shared by all the beings heading to that position.
+         */
+        void setDestination(Entity &entity, const Point &dst,
+                            const Point &flowTarget);
+
         /**
          * Sets the destination coordinates of the being to the current
          * position.
          */
         void clearDestination(Entity &entity);
 
+        /**
+         * Gets the center of the next tile of the path of the being, or its
+         * position when it has no path.
+         */
+        Point getNextStep(Entity &entity) const;
+
         /**
          * Gets the old coordinates of the being.
          */
@@ -127,6 +158,12 @@ class BeingComponent : public Component
          */
         virtual Path findPath(Entity &);
 
+        /**
+         * Gives the being the result of the search it queued, made from the
+         * given start tile.
+         */
+        void pathFound(Entity &entity, const Point &start, const Path &path);
+
         /** Gets the gender of the being (male or female). */
         BeingGender getGender() const
         { return mGender; }
@@ -198,19 +235,35 @@ class BeingComponent : public Component
 
         /**
          * Called when an attribute modifier is changed.
-         * Recalculate the base value of an attribute and update derived
-         *     attributes if it has changed.
-         * @returns Whether it was changed.
+         * Recalculate the base value of an attribute, from its formula when
+         *     it has one or through the script callback otherwise, and
+         *     update derived attributes if it has changed.
          */
         void recalculateBaseAttribute(Entity &, unsigned);
 
         /**
-         * Attribute has changed, recalculate base value of dependant
-         *     attributes (and handle other actions for the modified
-         *     attribute)
+         * Attribute has changed. Handles the engine side of the change right
+         *     away and queues the attribute, so that the base values of
+         *     dependant attributes are recalculated by
+         *     flushChangedAttributes(). Only the map flushes its beings,
+         *     once at the end of its update, so that the dependants of a
+         *     being are recalculated at most once per tick. The values are
+         *     flushed as well before a character is saved.
          */
         void updateDerivedAttributes(Entity &entity, unsigned);
 
+        /**
+         * Recalculates the attributes whose native formula depends on the
+         *     attributes changed since the last flush, then emits
+         *     signal_attribute_changed for all the changed attributes and
+         *     calls the derived attributes callback once with all of them, or
+         *     the older callback once for each of them. Attributes changed by the callback itself have their formula
+         *     dependants recalculated and are reported to the listeners, but
+         *     are not handed to the callback again, it is expected to
+         *     resolve chains of dependencies by itself.
+         */
+        void flushChangedAttributes(Entity &entity);
+
         /**
          * Sets a statuseffect on this being
          */
@@ -255,11 +308,29 @@ class BeingComponent : public Component
         static void setUpdateDerivedAttributesCallback(Script *script)
         { script->assignCallback(mRecalculateDerivedAttributesCallback); }
 
+        static void setUpdateDerivedAttributeCallback(Script *script)
+        { script->assignCallback(mRecalculateDerivedAttributeCallback); }
+
         static void setRecalculateBaseAttributeCallback(Script *script)
         { script->assignCallback(mRecalculateBaseAttributeCallback); }
 
-        sigc::signal<void, Entity *> signal_died;
-        sigc::signal<void, Entity *, unsigned> signal_attribute_changed;
+        /**
+         * Gets a serialized change of the being, to be appended to the
+         * messages sent about it.
+         */
+        const MessageOut &getUpdateFragment(UpdateFragment fragment) const
+        { return mUpdateFragments[fragment]; }
+
+        MessageOut &getUpdateFragment(UpdateFragment fragment)
+        { return mUpdateFragments[fragment]; }
+
+        utils::Event<Entity *> signal_died;
+        utils::Event<Entity *, unsigned> signal_attribute_changed;
+
+        /**
+         * Emitted with the character the being came into view of.
+         */
+        utils::Event<Entity *> signal_observed;
 
         /**
          * Activate an emote flag on the being.
@@ -280,9 +351,10 @@ class BeingComponent : public Component
                              const Point &currentPos,
                              const Point &destPos);
 
-    protected:
+        /** Ticks between two regenerations of hit points. */
         static const int TICKS_PER_HP_REGENERATION = 100;
 
+    protected:
         /** Delay until move to next tile in miliseconds. */
         unsigned short mMoveTime;
         BeingAction mAction;
@@ -290,8 +362,12 @@ class BeingComponent : public Component
         StatusEffects mStatus;
         Point mOld;                 /**< Old coordinates. */
         Point mDst;                 /**< Target coordinates. */
+        Point mFlowTarget;          /**< Position the flow field leads to. */
+        bool mFollowsFlowField;     /**< Whether to follow a flow field. */
         BeingGender mGender;        /**< Gender of the being. */
 
+        MessageOut mUpdateFragments[FRAGMENT_COUNT];
+
     private:
         BeingComponent(const BeingComponent &rhs);
         BeingComponent &operator=(const BeingComponent &rhs);
@@ -301,7 +377,52 @@ class BeingComponent : public Component
          */
         void inserted(Entity *);
 
+        /**
+         * Connected to signal_removed to forget the queued path search.
+         */
+        void removed(Entity *);
+
+        /**
+         * Recalculates, in the order of their dependencies, the attributes
+         * whose native formula uses one of the changed attributes.
+         */
+        void recalculateFormulas(Entity &entity);
+
+        /**
+         * Gets what is needed to search the path to the current destination.
+         */
+        PathRequest getPathRequest(Entity &entity) const;
+
+        /**
+         * Removes the timed attribute modifiers that expired.
+         */
+        void expireModifiers(Entity &entity, int tick);
+
+        /**
+         * Tick at which a timed modifier of an attribute expires.
+         */
+        struct ModifierExpiry
+        {
+            int tick;
+            unsigned attribute;
+
+            bool operator>(const ModifierExpiry &other) const
+            { return tick > other.tick; }
+        };
+
+        /**
+         * State of the search of the path when it is queued.
+         */
+        enum PathSearch
+        {
+            PATH_SEARCH_NONE,
+            PATH_SEARCH_QUEUED,
+            PATH_SEARCH_DONE        /**< The result is in mPath. */
+        };
+
         Path mPath;
+        PathSearch mPathSearch;
+
         BeingDirection mDirection;   /**< Facing direction. */
 
         std::string mName;
@@ -312,9 +433,27 @@ class BeingComponent : public Component
         /** The last being emote Id. Used when triggering a being emoticon. */
         int mEmoteId;
 
+        /** Tick of the last update, to catch up after skipped ticks. */
+        int mLastUpdateTick;
+
+        /** Timed modifiers, as a min-heap ordered by expiry tick. */
+        std::vector<ModifierExpiry> mModifierExpiries;
+
+        /** Attributes changed since the last flush, without duplicates. */
+        std::vector<unsigned> mChangedAttributes;
+
+        utils::EventListener<Entity *> mInsertedListener;
+        utils::EventListener<Entity *> mRemovedListener;
+
         /** Called when derived attributes need to get calculated */
         static Script::Ref mRecalculateDerivedAttributesCallback;
 
+        /**
+         * Called once for each changed attribute instead, when the scripts
+         * did not set the callback above.
+         */
+        static Script::Ref mRecalculateDerivedAttributeCallback;
+
         /** Called when a base attribute needs to get calculated */
         static Script::Ref mRecalculateBaseAttributeCallback;
 };
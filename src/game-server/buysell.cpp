@@ -147,7 +147,7 @@ bool BuySell::start(Entity *actor)
         msg.writeInt16(i->amount);
         msg.writeInt16(i->cost);
     }
-    mChar->getComponent<CharacterComponent>()->getClient()->send(msg);
+    gameHandler->sendTo(mChar, msg);
     return true;
 }
 
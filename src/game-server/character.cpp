@@ -108,10 +108,12 @@ CharacterComponent::CharacterComponent(Entity &entity, MessageIn &msg):
 
     CombatComponent *combatcomponent = new CombatComponent(entity);
     entity.addComponent(combatcomponent);
-    combatcomponent->getAttacks().attack_added.connect(
-            sigc::mem_fun(this, &CharacterComponent::attackAdded));
-    combatcomponent->getAttacks().attack_removed.connect(
-            sigc::mem_fun(this, &CharacterComponent::attackRemoved));
+    mAttackAddedListener.connect<CharacterComponent,
+                                 &CharacterComponent::attackAdded>(
+            combatcomponent->getAttacks().attack_added, this);
+    mAttackRemovedListener.connect<CharacterComponent,
+                                   &CharacterComponent::attackRemoved>(
+            combatcomponent->getAttacks().attack_removed, this);
 
     // Default knuckle attack
     int damageBase = beingComponent->getModifiedAttribute(ATTR_STR);
@@ -138,8 +140,9 @@ CharacterComponent::CharacterComponent(Entity &entity, MessageIn &msg):
     Inventory(&entity, mPossessions).initialize();
     modifiedAllAttributes(entity);;
 
-    beingComponent->signal_attribute_changed.connect(sigc::mem_fun(
-            this, &CharacterComponent::attributeChanged));
+    mAttributeChangedListener.connect<CharacterComponent,
+                                      &CharacterComponent::attributeChanged>(
+            beingComponent->signal_attribute_changed, this);
 }
 
 CharacterComponent::~CharacterComponent()
@@ -711,6 +714,14 @@ void CharacterComponent::attackRemoved(CombatComponent *combatComponent,
         combatComponent->addAttack(mKnuckleAttackInfo);
 }
 
+void CharacterComponent::setParty(Entity &entity, int party)
+{
+    if (MapComposite *map = entity.getMap())
+        map->changeParty(&entity, mParty, party);
+
+    mParty = party;
+}
+
 void CharacterComponent::disconnected(Entity &entity)
 {
     mConnected = false;
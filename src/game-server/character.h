@@ -39,6 +39,8 @@
 #include <string>
 #include <vector>
 
+#include <sigc++/signal.h>
+
 class BuySell;
 class GameClient;
 class MessageIn;
@@ -291,9 +293,23 @@ class CharacterComponent : public Component
         int getParty() const
         { return mParty; }
 
-        /** Sets the party id of the character */
-        void setParty(int party)
-        { mParty = party; }
+        /**
+         * Sets the party id of the character, and updates the party members
+         * known by its map.
+         */
+        void setParty(Entity &entity, int party);
+
+        /**
+         * Gets the actors the client of this character currently knows about.
+         */
+        const std::set<Entity *> &getVisibleActors() const
+        { return mVisibleActors; }
+
+        void addVisibleActor(Entity *actor)
+        { mVisibleActors.insert(actor); }
+
+        void removeVisibleActor(Entity *actor)
+        { mVisibleActors.erase(actor); }
 
         /**
          * Sends a message that informs the client about attribute
@@ -549,6 +565,7 @@ class CharacterComponent : public Component
         bool mRecalculateLevel;      /**< Flag raised when the character level might have increased */
         unsigned char mAccountLevel; /**< Account level of the user. */
         int mParty;                  /**< Party id of the character */
+        std::set<Entity *> mVisibleActors; /**< Actors known by the client */
         TransactionType mTransaction; /**< Trade/buy/sell action the character is involved in. */
         std::map<int, int> mKillCount;  /**< How many monsters the character has slain of each type */
 
@@ -559,6 +576,11 @@ class CharacterComponent : public Component
 
         AttackInfo *mKnuckleAttackInfo;
 
+        utils::EventListener<Entity *, unsigned> mAttributeChangedListener;
+        utils::EventListener<CombatComponent *, Attack &> mAttackAddedListener;
+        utils::EventListener<CombatComponent *, Attack &>
+                mAttackRemovedListener;
+
         Entity *mBaseEntity;        /**< The entity this component is part of
                                          this is ONLY required to allow using
                                          the serialization routine without many
@@ -0,0 +1,506 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/clustergraph.h"
+
+#include "game-server/map.h"
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+const int ClusterGraph::CLUSTER_SIZE;
+const int ClusterGraph::BASIC_COST;
+const int ClusterGraph::DIAGONAL_COST;
+
+/**
+ * Cost of the shortest path between two tiles when nothing is in the way.
+ */
+static int estimateCost(const Point &a, const Point &b)
+{
+    const int dx = std::abs(a.x - b.x);
+    const int dy = std::abs(a.y - b.y);
+    return std::abs(dx - dy) * ClusterGraph::BASIC_COST +
+           std::min(dx, dy) * ClusterGraph::DIAGONAL_COST;
+}
+
+ClusterGraph::ClusterGraph():
+    mMap(nullptr),
+    mClustersWide(0),
+    mClustersHigh(0),
+    mSearch(0)
+{
+}
+
+void ClusterGraph::build(const Map *map)
+{
+    clear();
+
+    mMap = map;
+    mClustersWide = (map->getWidth() + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+    mClustersHigh = (map->getHeight() + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+
+    const int clusterCount = mClustersWide * mClustersHigh;
+    mClusters.resize(clusterCount);
+    mRightBorders.resize(clusterCount);
+    mBottomBorders.resize(clusterCount);
+
+    for (int cluster = 0; cluster < clusterCount; ++cluster)
+        tileChanged(cluster % mClustersWide * CLUSTER_SIZE,
+                    cluster / mClustersWide * CLUSTER_SIZE);
+    refresh();
+
+    LOG_DEBUG("Cluster graph built with " << clusterCount << " clusters and "
+              << mFirstNodes.back() << " portals.");
+}
+
+void ClusterGraph::clear()
+{
+    mMap = nullptr;
+    mClustersWide = 0;
+    mClustersHigh = 0;
+    mClusters.clear();
+    mRightBorders.clear();
+    mBottomBorders.clear();
+    mFirstNodes.clear();
+    mDirtyClusters.clear();
+}
+
+void ClusterGraph::tileChanged(int x, int y)
+{
+    if (!mMap || !mMap->contains(x, y))
+        return;
+
+    const int cluster = getClusterAt(Point(x, y));
+    if (!mClusters[cluster].dirty)
+    {
+        mClusters[cluster].dirty = true;
+        mDirtyClusters.push_back(cluster);
+    }
+}
+
+bool ClusterGraph::isWalkable(int x, int y) const
+{
+    return mMap->getWalk(x, y, Map::BLOCKMASK_WALL);
+}
+
+std::vector<ClusterGraph::Entrance> *ClusterGraph::getBorder(int cluster,
+                                                             Side side)
+{
+    const int x = cluster % mClustersWide;
+    const int y = cluster / mClustersWide;
+
+    switch (side)
+    {
+        case LEFT:
+            return x > 0 ? &mRightBorders[cluster - 1] : nullptr;
+        case RIGHT:
+            return x + 1 < mClustersWide ? &mRightBorders[cluster] : nullptr;
+        case TOP:
+            return y > 0 ? &mBottomBorders[cluster - mClustersWide] : nullptr;
+        case BOTTOM:
+            return y + 1 < mClustersHigh ? &mBottomBorders[cluster] : nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+int ClusterGraph::getNeighbour(int cluster, Side side) const
+{
+    switch (side)
+    {
+        case LEFT:
+            return cluster - 1;
+        case RIGHT:
+            return cluster + 1;
+        case TOP:
+            return cluster - mClustersWide;
+        default:
+            return cluster + mClustersWide;
+    }
+}
+
+int ClusterGraph::getLinkedNode(int cluster, const Node &node) const
+{
+    static const Side opposites[SIDE_COUNT] = { RIGHT, LEFT, BOTTOM, TOP };
+
+    const int neighbour = getNeighbour(cluster, node.side);
+    return mFirstNodes[neighbour] +
+           mClusters[neighbour].sideStart[opposites[node.side]] +
+           node.entrance;
+}
+
+int ClusterGraph::getClusterOfNode(int node) const
+{
+    return std::upper_bound(mFirstNodes.begin(), mFirstNodes.end(), node) -
+           mFirstNodes.begin() - 1;
+}
+
+const Point &ClusterGraph::getNodeTile(int node) const
+{
+    const int cluster = getClusterOfNode(node);
+    return mClusters[cluster].nodes[node - mFirstNodes[cluster]].tile;
+}
+
+bool ClusterGraph::findEntrances(int cluster, Side side)
+{
+    std::vector<Entrance> *border = getBorder(cluster, side);
+    if (!border)
+        return false;
+
+    // Borders are scanned from the cluster on their left or top
+    if (side == LEFT || side == TOP)
+    {
+        cluster = getNeighbour(cluster, side);
+        side = side == LEFT ? RIGHT : BOTTOM;
+    }
+
+    const bool vertical = side == RIGHT;
+    const int clusterX = cluster % mClustersWide * CLUSTER_SIZE;
+    const int clusterY = cluster / mClustersWide * CLUSTER_SIZE;
+    const int edge = (vertical ? clusterX : clusterY) + CLUSTER_SIZE - 1;
+    const int begin = vertical ? clusterY : clusterX;
+    const int end = std::min(begin + CLUSTER_SIZE,
+                             vertical ? mMap->getHeight() : mMap->getWidth());
+
+    // Put a portal in the middle of each run of tiles that can be crossed
+    std::vector<Entrance> entrances;
+    int runStart = -1;
+    for (int i = begin; i <= end; ++i)
+    {
+        bool open = false;
+        if (i < end)
+        {
+            open = vertical ?
+                    isWalkable(edge, i) && isWalkable(edge + 1, i) :
+                    isWalkable(i, edge) && isWalkable(i, edge + 1);
+        }
+
+        if (open)
+        {
+            if (runStart < 0)
+                runStart = i;
+        }
+        else if (runStart >= 0)
+        {
+            const int middle = (runStart + i - 1) / 2;
+            Entrance entrance;
+            entrance.first = vertical ? Point(edge, middle)
+                                      : Point(middle, edge);
+            entrance.second = vertical ? Point(edge + 1, middle)
+                                       : Point(middle, edge + 1);
+            entrances.push_back(entrance);
+            runStart = -1;
+        }
+    }
+
+    if (entrances == *border)
+        return false;
+
+    border->swap(entrances);
+    return true;
+}
+
+void ClusterGraph::updateCluster(int index)
+{
+    Cluster &cluster = mClusters[index];
+    cluster.nodes.clear();
+
+    for (int side = 0; side < SIDE_COUNT; ++side)
+    {
+        cluster.sideStart[side] = cluster.nodes.size();
+
+        const std::vector<Entrance> *border = getBorder(index, (Side) side);
+        if (!border)
+            continue;
+
+        for (unsigned i = 0; i < border->size(); ++i)
+        {
+            const Entrance &entrance = (*border)[i];
+            Node node;
+            node.tile = side == LEFT || side == TOP ? entrance.second
+                                                    : entrance.first;
+            node.side = (Side) side;
+            node.entrance = i;
+            cluster.nodes.push_back(node);
+        }
+    }
+
+    const unsigned nodeCount = cluster.nodes.size();
+    cluster.costs.assign(nodeCount * nodeCount, -1);
+    for (unsigned i = 0; i < nodeCount; ++i)
+    {
+        computeTileCosts(cluster.nodes[i].tile);
+        for (unsigned j = 0; j < nodeCount; ++j)
+            cluster.costs[i * nodeCount + j] =
+                    getTileCost(cluster.nodes[j].tile);
+    }
+}
+
+void ClusterGraph::refresh()
+{
+    if (mDirtyClusters.empty())
+        return;
+
+    std::vector<int> clusters;
+    clusters.swap(mDirtyClusters);
+
+    // The clusters next to a changed one only need an update when the
+    // portals of their shared border moved.
+    const unsigned changedCount = clusters.size();
+    for (unsigned i = 0; i < changedCount; ++i)
+    {
+        for (int side = 0; side < SIDE_COUNT; ++side)
+        {
+            if (!findEntrances(clusters[i], (Side) side))
+                continue;
+
+            const int neighbour = getNeighbour(clusters[i], (Side) side);
+            if (!mClusters[neighbour].dirty)
+            {
+                mClusters[neighbour].dirty = true;
+                clusters.push_back(neighbour);
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < clusters.size(); ++i)
+    {
+        updateCluster(clusters[i]);
+        mClusters[clusters[i]].dirty = false;
+    }
+
+    mFirstNodes.resize(mClusters.size() + 1);
+    mFirstNodes[0] = 0;
+    for (unsigned i = 0; i < mClusters.size(); ++i)
+        mFirstNodes[i + 1] = mFirstNodes[i] + mClusters[i].nodes.size();
+}
+
+void ClusterGraph::computeTileCosts(const Point &source)
+{
+    mTileCostsOrigin = Point(source.x / CLUSTER_SIZE * CLUSTER_SIZE,
+                             source.y / CLUSTER_SIZE * CLUSTER_SIZE);
+    const int width = std::min(CLUSTER_SIZE,
+                               mMap->getWidth() - mTileCostsOrigin.x);
+    const int height = std::min(CLUSTER_SIZE,
+                                mMap->getHeight() - mTileCostsOrigin.y);
+
+    mTileCosts.assign(CLUSTER_SIZE * CLUSTER_SIZE, -1);
+
+    std::priority_queue<OpenNode> openList;
+    const int sourceIndex = (source.x - mTileCostsOrigin.x) +
+                            (source.y - mTileCostsOrigin.y) * CLUSTER_SIZE;
+    mTileCosts[sourceIndex] = 0;
+    openList.push(OpenNode(sourceIndex, 0));
+
+    while (!openList.empty())
+    {
+        const OpenNode current = openList.top();
+        openList.pop();
+
+        if (current.cost > mTileCosts[current.node])
+            continue;
+
+        const int x = current.node % CLUSTER_SIZE;
+        const int y = current.node / CLUSTER_SIZE;
+
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                const int nx = x + dx;
+                const int ny = y + dy;
+                if ((dx == 0 && dy == 0) ||
+                        nx < 0 || ny < 0 || nx >= width || ny >= height)
+                    continue;
+
+                const int mapX = mTileCostsOrigin.x + nx;
+                const int mapY = mTileCostsOrigin.y + ny;
+                if (!isWalkable(mapX, mapY))
+                    continue;
+
+                // Same corner rule as the tile pathfinder
+                if (dx != 0 && dy != 0 &&
+                        (!isWalkable(mTileCostsOrigin.x + x, mapY) ||
+                         !isWalkable(mapX, mTileCostsOrigin.y + y)))
+                    continue;
+
+                const int cost = current.cost +
+                        (dx == 0 || dy == 0 ? BASIC_COST : DIAGONAL_COST);
+                int &knownCost = mTileCosts[nx + ny * CLUSTER_SIZE];
+                if (knownCost < 0 || cost < knownCost)
+                {
+                    knownCost = cost;
+                    openList.push(OpenNode(nx + ny * CLUSTER_SIZE, cost));
+                }
+            }
+        }
+    }
+}
+
+int ClusterGraph::getTileCost(const Point &tile) const
+{
+    const int x = tile.x - mTileCostsOrigin.x;
+    const int y = tile.y - mTileCostsOrigin.y;
+    if (x < 0 || y < 0 || x >= CLUSTER_SIZE || y >= CLUSTER_SIZE)
+        return -1;
+
+    return mTileCosts[x + y * CLUSTER_SIZE];
+}
+
+void ClusterGraph::addOpenNode(int node, int cost, int parent,
+                               const Point &tile, const Point &dest)
+{
+    if (mNodeVisits[node] == mSearch && mNodeCosts[node] <= cost)
+        return;
+
+    mNodeVisits[node] = mSearch;
+    mNodeCosts[node] = cost;
+    mNodeParents[node] = parent;
+    mOpenList.push(OpenNode(node, cost + estimateCost(tile, dest)));
+}
+
+bool ClusterGraph::findRoute(const Point &start, const Point &dest,
+                             std::vector<Step> &steps)
+{
+    steps.clear();
+
+    if (!mMap || !mMap->contains(start.x, start.y) ||
+            !mMap->contains(dest.x, dest.y))
+        return false;
+
+    refresh();
+
+    // The destination is an extra node after those of the clusters
+    const int goal = mFirstNodes.back();
+    if (mNodeVisits.size() < (unsigned) goal + 1)
+    {
+        mNodeCosts.resize(goal + 1);
+        mNodeParents.resize(goal + 1);
+        mNodeVisits.resize(goal + 1, 0);
+    }
+
+    if (++mSearch == 0)
+    {
+        std::fill(mNodeVisits.begin(), mNodeVisits.end(), 0);
+        mSearch = 1;
+    }
+
+    mOpenList = std::priority_queue<OpenNode>();
+
+    const int startCluster = getClusterAt(start);
+    const int destCluster = getClusterAt(dest);
+    const Cluster &startNodes = mClusters[startCluster];
+    const Cluster &destNodes = mClusters[destCluster];
+
+    // Costs from the portals of the destination cluster to the destination
+    computeTileCosts(dest);
+    std::vector<int> destCosts(destNodes.nodes.size());
+    for (unsigned i = 0; i < destNodes.nodes.size(); ++i)
+        destCosts[i] = getTileCost(destNodes.nodes[i].tile);
+
+    if (startCluster == destCluster)
+    {
+        const int cost = getTileCost(start);
+        if (cost >= 0)
+            addOpenNode(goal, cost, -1, dest, dest);
+    }
+
+    // Costs from the start to the portals of its cluster
+    computeTileCosts(start);
+    for (unsigned i = 0; i < startNodes.nodes.size(); ++i)
+    {
+        const int cost = getTileCost(startNodes.nodes[i].tile);
+        if (cost >= 0)
+            addOpenNode(mFirstNodes[startCluster] + i, cost, -1,
+                        startNodes.nodes[i].tile, dest);
+    }
+
+    bool found = false;
+    while (!mOpenList.empty())
+    {
+        const OpenNode current = mOpenList.top();
+        mOpenList.pop();
+
+        if (current.node == goal)
+        {
+            found = true;
+            break;
+        }
+
+        const int clusterIndex = getClusterOfNode(current.node);
+        const Cluster &cluster = mClusters[clusterIndex];
+        const int first = mFirstNodes[clusterIndex];
+        const int local = current.node - first;
+        const Node &node = cluster.nodes[local];
+        const int cost = mNodeCosts[current.node];
+
+        // Skip the entries of nodes that were reached again more cheaply
+        if (current.cost > cost + estimateCost(node.tile, dest))
+            continue;
+
+        const int nodeCount = cluster.nodes.size();
+        for (int i = 0; i < nodeCount; ++i)
+        {
+            const int pathCost = cluster.costs[local * nodeCount + i];
+            if (i != local && pathCost >= 0)
+                addOpenNode(first + i, cost + pathCost, current.node,
+                            cluster.nodes[i].tile, dest);
+        }
+
+        const int linked = getLinkedNode(clusterIndex, node);
+        addOpenNode(linked, cost + BASIC_COST, current.node,
+                    getNodeTile(linked), dest);
+
+        if (clusterIndex == destCluster && destCosts[local] >= 0)
+            addOpenNode(goal, cost + destCosts[local], current.node,
+                        dest, dest);
+    }
+
+    if (!found)
+        return false;
+
+    std::vector<int> route;
+    for (int node = mNodeParents[goal]; node != -1; node = mNodeParents[node])
+        route.push_back(node);
+
+    Point previousTile = start;
+    int previousCost = 0;
+    for (std::vector<int>::reverse_iterator it = route.rbegin(),
+         it_end = route.rend(); it != it_end; ++it)
+    {
+        const Point &tile = getNodeTile(*it);
+        if (tile != previousTile)
+        {
+            Step step = { tile, mNodeCosts[*it] - previousCost };
+            steps.push_back(step);
+            previousTile = tile;
+        }
+        previousCost = mNodeCosts[*it];
+    }
+
+    if (dest != previousTile)
+    {
+        Step step = { dest, mNodeCosts[goal] - previousCost };
+        steps.push_back(step);
+    }
+
+    return true;
+}
@@ -0,0 +1,230 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CLUSTERGRAPH_H
+#define CLUSTERGRAPH_H
+
+#include <queue>
+#include <vector>
+
+#include "utils/point.h"
+
+class Map;
+
+/**
+ * Abstract graph of a map used for hierarchical pathfinding.
+ *
+ * The map is cut into square clusters. Each run of tiles that can be walked
+ * across the border of two clusters gets a portal in its middle, and the
+ * graph stores the cost of walking between every two portals of the same
+ * cluster. Long routes are first searched on this graph, which only knows
+ * about walls, and then refined tile by tile.
+ *
+ * When a wall appears or disappears, only the cluster containing it is marked
+ * for an update. Its borders and costs, and those of the clusters next to it
+ * when their shared portals moved, are computed again before the next search.
+ */
+class ClusterGraph
+{
+    public:
+        /**
+         * Tile the route goes through, with the cost of reaching it from the
+         * previous step. Costs are in hundredths of a tile, like those of the
+         * tile pathfinder.
+         */
+        struct Step
+        {
+            Point tile;
+            int cost;
+        };
+
+        /** Width and height of a cluster, in tiles. */
+        static const int CLUSTER_SIZE = 16;
+
+        /** Cost of a horizontal or vertical step. */
+        static const int BASIC_COST = 100;
+
+        /** Cost of a diagonal step. */
+        static const int DIAGONAL_COST = BASIC_COST * 362 / 256;
+
+        ClusterGraph();
+
+        /**
+         * Builds the graph of the given map, replacing the previous one.
+         */
+        void build(const Map *map);
+
+        /**
+         * Forgets the graph.
+         */
+        void clear();
+
+        bool isBuilt() const
+        { return mMap; }
+
+        /**
+         * Notifies that the wall state of a tile changed.
+         */
+        void tileChanged(int x, int y);
+
+        /**
+         * Finds the tiles a route from \a start to \a dest goes through,
+         * ignoring everything but walls. The steps do not include the start
+         * and end with the destination; two steps in a row are always in the
+         * same cluster or on both sides of a portal.
+         *
+         * @returns false when the destination cannot be reached.
+         */
+        bool findRoute(const Point &start, const Point &dest,
+                       std::vector<Step> &steps);
+
+    private:
+        ClusterGraph(const ClusterGraph &);
+        ClusterGraph &operator=(const ClusterGraph &);
+
+        enum Side
+        {
+            LEFT,
+            RIGHT,
+            TOP,
+            BOTTOM,
+            SIDE_COUNT
+        };
+
+        /**
+         * Pair of walkable tiles facing each other across a border. The
+         * first one is in the left or top cluster.
+         */
+        struct Entrance
+        {
+            Point first;
+            Point second;
+
+            bool operator==(const Entrance &other) const
+            { return first == other.first && second == other.second; }
+        };
+
+        struct Node
+        {
+            Point tile;
+            Side side;              /**< Border the portal is on. */
+            int entrance;           /**< Index in the border. */
+        };
+
+        struct Cluster
+        {
+            Cluster(): dirty(false) {}
+
+            std::vector<Node> nodes;
+            int sideStart[SIDE_COUNT];  /**< First node of each border. */
+            std::vector<int> costs;     /**< Node to node, -1 if no path. */
+            bool dirty;
+        };
+
+        /** Entry of the open lists of the searches. */
+        struct OpenNode
+        {
+            OpenNode(int node, int cost): node(node), cost(cost) {}
+
+            bool operator<(const OpenNode &other) const
+            { return cost > other.cost; }
+
+            int node;
+            int cost;
+        };
+
+        bool isWalkable(int x, int y) const;
+
+        /**
+         * Gets the entrances of a border of a cluster, or a null pointer on
+         * the edges of the map.
+         */
+        std::vector<Entrance> *getBorder(int cluster, Side side);
+
+        /**
+         * Gets the cluster on the other side of a border.
+         */
+        int getNeighbour(int cluster, Side side) const;
+
+        /**
+         * Gets the node of the neighbouring cluster a node leads to.
+         */
+        int getLinkedNode(int cluster, const Node &node) const;
+
+        int getClusterOfNode(int node) const;
+
+        const Point &getNodeTile(int node) const;
+
+        int getClusterAt(const Point &tile) const
+        {
+            return tile.x / CLUSTER_SIZE +
+                   tile.y / CLUSTER_SIZE * mClustersWide;
+        }
+
+        /**
+         * Finds again the entrances of a border of a cluster.
+         * @returns whether they changed.
+         */
+        bool findEntrances(int cluster, Side side);
+
+        /**
+         * Lists the portals of a cluster and computes the costs between them.
+         */
+        void updateCluster(int cluster);
+
+        /**
+         * Updates the clusters that were marked as dirty.
+         */
+        void refresh();
+
+        /**
+         * Computes the cost of walking from a tile to every tile of its
+         * cluster, without leaving it. Results are stored in mTileCosts.
+         */
+        void computeTileCosts(const Point &source);
+
+        int getTileCost(const Point &tile) const;
+
+        /**
+         * Puts a node on the open list of the route search, unless it was
+         * already reached more cheaply.
+         */
+        void addOpenNode(int node, int cost, int parent,
+                         const Point &tile, const Point &dest);
+
+        const Map *mMap;
+        int mClustersWide, mClustersHigh;
+        std::vector<Cluster> mClusters;
+        std::vector<std::vector<Entrance> > mRightBorders;
+        std::vector<std::vector<Entrance> > mBottomBorders;
+        std::vector<int> mFirstNodes;   /**< Global id of the first nodes. */
+        std::vector<int> mDirtyClusters;
+
+        // Scratch data of the searches
+        Point mTileCostsOrigin;         /**< Top left tile of mTileCosts. */
+        std::vector<int> mTileCosts;
+        std::vector<int> mNodeCosts;
+        std::vector<int> mNodeParents;
+        std::vector<unsigned> mNodeVisits;
+        unsigned mSearch;               /**< Marks the nodes of a search. */
+        std::priority_queue<OpenNode> mOpenList;
+};
+
+#endif // CLUSTERGRAPH_H
@@ -29,14 +29,44 @@ CombatComponent::CombatComponent(Entity &being):
     mTarget(nullptr),
     mCurrentAttack(nullptr)
 {
-    being.getComponent<BeingComponent>()->signal_died.connect(sigc::mem_fun(
-            this, &CombatComponent::diedOrRemoved));
-    being.signal_removed.connect(sigc::mem_fun(this,
-                                  &CombatComponent::diedOrRemoved));
+    mDiedListener.connect<CombatComponent, &CombatComponent::diedOrRemoved>(
+            being.getComponent<BeingComponent>()->signal_died, this);
+    mRemovedListener.connect<CombatComponent,
+                             &CombatComponent::diedOrRemoved>(
+            being.signal_removed, this);
 }
 
 CombatComponent::~CombatComponent()
 {
+    clearTarget();
+    clearTargetedBy();
+}
+
+/**
+ * Set Target
+ */
+void CombatComponent::setTarget(Entity *target)
+{
+    clearTarget();
+    mTarget = target;
+    if (mTarget)
+        mTarget->getComponent<CombatComponent>()->mTargetedBy.insert(this);
+}
+
+/**
+ * Clears the target
+ */
+void CombatComponent::clearTarget()
+{
+    if (mTarget)
+        mTarget->getComponent<CombatComponent>()->mTargetedBy.erase(this);
+    mTarget = nullptr;
+}
+
+void CombatComponent::clearTargetedBy()
+{
+    while (!mTargetedBy.empty())
+        (*mTargetedBy.begin())->clearTarget();
 }
 
 void CombatComponent::update(Entity &entity)
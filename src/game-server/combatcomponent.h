@@ -23,12 +23,13 @@
 
 #include "component.h"
 
+#include <set>
 #include <vector>
 
-#include <sigc++/trackable.h>
-
 #include "game-server/attack.h"
 
+#include "utils/event.h"
+
 class Entity;
 
 /**
@@ -62,18 +63,28 @@ public:
     void setTarget(Entity *target);
     void clearTarget();
 
+    /**
+     * Makes all the beings targeting this one forget about their target.
+     */
+    void clearTargetedBy();
+
     void diedOrRemoved(Entity *entity);
 
-    sigc::signal<void, Entity *, const Damage &, int> signal_damaged;
+    utils::Event<Entity *, const Damage &, int> signal_damaged;
 
 protected:
     virtual void processAttack(Entity &source, Attack &attack);
 
     Entity *mTarget;
+    std::set<CombatComponent *> mTargetedBy; // Beings targeting this one
     Attacks mAttacks;
     Attack *mCurrentAttack;     // Last used attack
     Hits mHitsTaken;            //List of punches taken since last update.
 
+private:
+    utils::EventListener<Entity *> mDiedListener;
+    utils::EventListener<Entity *> mRemovedListener;
+
 };
 
 inline Attacks &CombatComponent::getAttacks()
@@ -115,22 +126,6 @@ inline Entity *CombatComponent::getTarget() const
     return mTarget;
 }
 
-/**
- * Set Target
- */
-inline void CombatComponent::setTarget(Entity *target)
-{
-    mTarget = target;
-}
-
-/**
- * Clears the target
- */
-inline void CombatComponent::clearTarget()
-{
-    mTarget = nullptr;
-}
-
 /**
  * Handler for the died and removed event of the targeting being
  * @param entity The removed/died being (not used here)
@@ -86,6 +86,7 @@ static void handleGiveSpecial(Entity*, std::string&);
 static void handleTakeSpecial(Entity*, std::string&);
 static void handleRechargeSpecial(Entity*, std::string&);
 static void handleListSpecials(Entity*, std::string&);
+static void handleMonsterAi(Entity*, std::string&);
 
 static CmdRef const cmdRef[] =
 {
@@ -167,6 +168,9 @@ static CmdRef const cmdRef[] =
         "<setname>_<specialname>", &handleRechargeSpecial},
     {"listspecials", "<character>",
         "Lists the specials of the character.", &handleListSpecials},
+    {"monsterai", "",
+        "Tells how many monsters of your map think at each level of detail",
+        &handleMonsterAi},
     {nullptr, nullptr, nullptr, nullptr}
 
 };
@@ -1778,6 +1782,17 @@ static void handleListSpecials(Entity *player, std::string &args)
     }
 }
 
+static void handleMonsterAi(Entity *player, std::string &)
+{
+    const MapComposite *map = player->getMap();
+    std::stringstream str;
+    str << "Monsters on map " << map->getName() << ": "
+        << map->getAiCount(AI_ACTIVE) << " active, "
+        << map->getAiCount(AI_REDUCED) << " reduced, "
+        << map->getAiCount(AI_SLEEPING) << " sleeping";
+    say(str.str(), player);
+}
+
 void CommandHandler::handleCommand(Entity *player,
                                    const std::string &command)
 {
@@ -21,8 +21,6 @@
 #ifndef COMPONENT_H
 #define COMPONENT_H
 
-#include <sigc++/trackable.h>
-
 class Entity;
 
 enum ComponentType
@@ -41,10 +39,26 @@ enum ComponentType
     ComponentTypeCount
 };
 
+/**
+ * Refers to a component in the component pool of a map. Unlike the position
+ * of the component in the pool, it does not change when other components are
+ * removed, and it no longer matches once the component itself was removed.
+ */
+struct ComponentHandle
+{
+    ComponentHandle():
+        index(0),
+        generation(0)
+    {}
+
+    unsigned index;         /**< Slot of the pool pointing at the component. */
+    unsigned generation;    /**< Reuses of the slot, 0 for no component. */
+};
+
 /**
  * A component of an entity.
  */
-class Component : public sigc::trackable
+class Component
 {
     public:
         virtual ~Component() {}
@@ -54,6 +68,19 @@ class Component : public sigc::trackable
          * component.
          */
         virtual void update(Entity &entity) = 0;
+
+        /**
+         * Gets the handle of the component in the component pool of the map
+         * its entity is on.
+         */
+        const ComponentHandle &getPoolHandle() const
+        { return mPoolHandle; }
+
+        void setPoolHandle(const ComponentHandle &handle)
+        { mPoolHandle = handle; }
+
+    private:
+        ComponentHandle mPoolHandle;
 };
 
 #endif // COMPONENT_H
@@ -21,9 +21,15 @@
 
 #include "game-server/entity.h"
 
+#include "game-server/mapcomposite.h"
+
 Entity::Entity(EntityType type, MapComposite *map) :
     mMap(map),
-    mType(type)
+    mMapSlot(0),
+    mUpdateSlot(NO_UPDATE_SLOT),
+    mSleeping(false),
+    mType(type),
+    mWakeUpTimer(this)
 {
     for (int i = 0; i < ComponentTypeCount; ++i)
         mComponents[i] = nullptr;
@@ -31,6 +37,8 @@ Entity::Entity(EntityType type, MapComposite *map) :
 
 Entity::~Entity()
 {
+    signal_destroyed.emit(this);
+
     for (int i = 0; i < ComponentTypeCount; ++i)
         delete mComponents[i];
 }
@@ -44,3 +52,26 @@ void Entity::update()
         if (mComponents[i])
             mComponents[i]->update(*this);
 }
+
+/**
+ * Stops updating the entity until the given amount of \a ticks passed, or
+ * until wakeUp is called when \a ticks is not positive. Meant to be called by
+ * components that have nothing to do for a while, from their update.
+ *
+ * @note All the components of the entity must be fine with not being updated
+ *       meanwhile.
+ */
+void Entity::sleep(int ticks)
+{
+    assert(mMap);
+    mMap->sleep(this, ticks);
+}
+
+/**
+ * Makes the map update the entity again, starting with the next update.
+ */
+void Entity::wakeUp()
+{
+    if (mMap)
+        mMap->wakeUp(this);
+}
@@ -25,9 +25,9 @@
 #include "common/manaserv_protocol.h"
 
 #include "game-server/component.h"
+#include "game-server/timerwheel.h"
 
-#include <sigc++/signal.h>
-#include <sigc++/trackable.h>
+#include "utils/event.h"
 
 #include <cassert>
 
@@ -41,7 +41,7 @@ class MapComposite;
  * Knows its type, the map it resides on and is host to a number of optional
  * components.
  */
-class Entity : public sigc::trackable
+class Entity
 {
     public:
         Entity(EntityType type, MapComposite *map = nullptr);
@@ -51,6 +51,7 @@ class Entity : public sigc::trackable
         EntityType getType() const;
 
         template <class T> void addComponent(T *component);
+        Component *getComponent(ComponentType type) const;
         template <class T> T *getComponent() const;
         template <class T> T *findComponent() const;
         template <class T> bool hasComponent() const;
@@ -64,16 +65,36 @@ class Entity : public sigc::trackable
         MapComposite *getMap() const;
         void setMap(MapComposite *map);
 
-        sigc::signal<void, Entity *> signal_inserted;
-        sigc::signal<void, Entity *> signal_removed;
-        sigc::signal<void, Entity *> signal_map_changed;
+        unsigned getMapSlot() const;
+        void setMapSlot(unsigned slot);
 
-    private:
-        Component *getComponent(ComponentType type) const;
+        void sleep(int ticks = 0);
+        void wakeUp();
+        bool isSleeping() const;
+        void setSleeping(bool sleeping);
+
+        TimerWheel::Timer &getWakeUpTimer();
+
+        unsigned getUpdateSlot() const;
+        void setUpdateSlot(unsigned slot);
+
+        /** Update slot of entities that are not updated by their map. */
+        static const unsigned NO_UPDATE_SLOT = ~0u;
 
+        utils::Event<Entity *> signal_inserted;
+        utils::Event<Entity *> signal_removed;
+        utils::Event<Entity *> signal_map_changed;
+        utils::Event<Entity *> signal_destroyed;
+
+    private:
         MapComposite *mMap;     /**< Map the entity is on */
+        unsigned mMapSlot;      /**< Position in the entities of the map. */
+        unsigned mUpdateSlot;   /**< Position in the updated entities. */
+        bool mSleeping;         /**< Whether the entity asked to sleep. */
         EntityType mType;       /**< Type of this entity. */
 
+        TimerWheel::Timer mWakeUpTimer;
+
         Component *mComponents[ComponentTypeCount];
 };
 
@@ -182,4 +203,63 @@ inline void Entity::setMap(MapComposite *map)
     signal_map_changed.emit(this);
 }
 
+/**
+ * Gets the position of this entity in the list of entities of its map.
+ */
+inline unsigned Entity::getMapSlot() const
+{
+    return mMapSlot;
+}
+
+/**
+ * Sets the position of this entity in the list of entities of its map.
+ */
+inline void Entity::setMapSlot(unsigned slot)
+{
+    mMapSlot = slot;
+}
+
+/**
+ * Tells whether the entity asked not to be updated anymore.
+ */
+inline bool Entity::isSleeping() const
+{
+    return mSleeping;
+}
+
+/**
+ * Sets whether the entity is sleeping. Used by the map, call sleep or wakeUp
+ * instead.
+ */
+inline void Entity::setSleeping(bool sleeping)
+{
+    mSleeping = sleeping;
+}
+
+/**
+ * Gets the timer waking the entity up, scheduled by its map.
+ */
+inline TimerWheel::Timer &Entity::getWakeUpTimer()
+{
+    return mWakeUpTimer;
+}
+
+/**
+ * Gets the position of this entity in the list of entities updated by its
+ * map, or NO_UPDATE_SLOT when it is not updated.
+ */
+inline unsigned Entity::getUpdateSlot() const
+{
+    return mUpdateSlot;
+}
+
+/**
+ * Sets the position of this entity in the list of entities updated by its
+ * map.
+ */
+inline void Entity::setUpdateSlot(unsigned slot)
+{
+    mUpdateSlot = slot;
+}
+
 #endif // ENTITY_H
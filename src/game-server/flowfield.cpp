@@ -0,0 +1,294 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/flowfield.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+/** Cost of a horizontal or vertical step. */
+static const int basicCost = 100;
+
+/** Cost of a diagonal step. */
+static const int diagonalCost = basicCost * 362 / 256;
+
+/**
+ * Largest distance between the destination and the bottom of the field for
+ * which the last steps of a path are searched.
+ */
+static const int finishRange = 3;
+
+/** Directions of the neighbours of a tile, the diagonal ones last. */
+static const int neighbourX[] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+static const int neighbourY[] = { 0, 0, 1, -1, 1, 1, -1, -1 };
+
+FlowField::FlowField(const Map *map, int targetX, int targetY):
+    mMap(map),
+    mWidth(0),
+    mHeight(0),
+    mStride(0),
+    mBuckets(diagonalCost + 1),
+    mSearchCost(0),
+    mOpenCount(0),
+    mStarted(false),
+    mStale(false),
+    mLastUse(0),
+    mRequests(0)
+{
+    reset(targetX, targetY);
+}
+
+void FlowField::reset(int targetX, int targetY)
+{
+    mTarget = Point(targetX, targetY);
+    mStarted = false;
+    mStale = false;
+    mRequests = 0;
+
+    mOrigin = Point(std::max(0, targetX - RADIUS),
+                    std::max(0, targetY - RADIUS));
+    mWidth = std::min(mMap->getWidth(), targetX + RADIUS + 1) - mOrigin.x;
+    mHeight = std::min(mMap->getHeight(), targetY + RADIUS + 1) - mOrigin.y;
+
+    if (!covers(mTarget))
+        mWidth = mHeight = 0;
+}
+
+void FlowField::startSearch()
+{
+    mStarted = true;
+
+    // The arrays have a blocked border, so that the search never needs to
+    // check whether it left the field
+    mStride = mWidth + 2;
+    const int size = mStride * (mHeight + 2);
+    mCosts.assign(size, -1);
+    mStates.assign(size, UNKNOWN);
+    for (int x = 0; x < mStride; ++x)
+    {
+        mStates[x] = BLOCKED;
+        mStates[size - 1 - x] = BLOCKED;
+    }
+    for (int y = 1; y <= mHeight; ++y)
+    {
+        mStates[y * mStride] = BLOCKED;
+        mStates[y * mStride + mWidth + 1] = BLOCKED;
+    }
+
+    for (int i = 0; i < 8; ++i)
+        mNeighbours[i] = neighbourX[i] + neighbourY[i] * mStride;
+
+    for (std::vector<std::vector<int> >::iterator it = mBuckets.begin(),
+         it_end = mBuckets.end(); it != it_end; ++it)
+    {
+        it->clear();
+    }
+
+    const int targetIndex = getIndex(mTarget);
+    mCosts[targetIndex] = 0;
+    mBuckets[0].push_back(targetIndex);
+    mSearchCost = 0;
+    mOpenCount = 1;
+}
+
+void FlowField::tileChanged(int x, int y)
+{
+    if (covers(Point(x, y)))
+        mStale = true;
+}
+
+bool FlowField::isWalkable(int index)
+{
+    char &state = mStates[index];
+    if (state == UNKNOWN)
+    {
+        const int x = mOrigin.x + index % mStride - 1;
+        const int y = mOrigin.y + index / mStride - 1;
+        state = mMap->getWalk(x, y) ? WALKABLE : BLOCKED;
+    }
+    return state >= WALKABLE;
+}
+
+bool FlowField::isFree(const Point &tile, unsigned char walkmask)
+{
+    return covers(tile) && isWalkable(getIndex(tile)) &&
+           mMap->getWalk(tile.x, tile.y, walkmask);
+}
+
+bool FlowField::canStep(const Point &from, const Point &to,
+                        unsigned char walkmask)
+{
+    if (!isFree(to, walkmask))
+        return false;
+
+    // Same corner rule as the tile pathfinder
+    return from.x == to.x || from.y == to.y ||
+           (isFree(Point(from.x, to.y), walkmask) &&
+            isFree(Point(to.x, from.y), walkmask));
+}
+
+int FlowField::settle(const Point &tile)
+{
+    const int tileIndex = getIndex(tile);
+    const int bucketCount = mBuckets.size();
+
+    // Steps cost less than there are buckets, so the costs of the tiles
+    // waiting for a visit never share a bucket
+    while (mStates[tileIndex] != SETTLED && mOpenCount > 0)
+    {
+        std::vector<int> &bucket = mBuckets[mSearchCost % bucketCount];
+        if (bucket.empty())
+        {
+            ++mSearchCost;
+            continue;
+        }
+
+        const int index = bucket.back();
+        bucket.pop_back();
+        --mOpenCount;
+
+        if (mStates[index] == SETTLED)
+            continue;
+        mStates[index] = SETTLED;
+
+        for (int i = 0; i < 8; ++i)
+        {
+            const int next = index + mNeighbours[i];
+            if (mStates[next] == SETTLED || !isWalkable(next))
+                continue;
+
+            const bool diagonal = i >= 4;
+            if (diagonal &&
+                    (!isWalkable(index + neighbourX[i]) ||
+                     !isWalkable(index + neighbourY[i] * mStride)))
+                continue;
+
+            const int cost = mSearchCost +
+                    (diagonal ? diagonalCost : basicCost);
+            if (mCosts[next] < 0 || cost < mCosts[next])
+            {
+                mCosts[next] = cost;
+                mBuckets[cost % bucketCount].push_back(next);
+                ++mOpenCount;
+            }
+        }
+    }
+
+    return mStates[tileIndex] == SETTLED ? mCosts[tileIndex] : -1;
+}
+
+Path FlowField::findPath(const Point &start, const Point &dest,
+                         unsigned char walkmask)
+{
+    Path path;
+
+    if (!covers(start))
+        return path;
+
+    if (!mStarted)
+        startSearch();
+
+    if (settle(start) < 0)
+        return path;
+
+    // Every tile closer to the target than the start is settled now, so
+    // the path can walk down the field without searching any further.
+    Point current = start;
+    int currentCost = mCosts[getIndex(start)];
+    while (current != dest)
+    {
+        if (std::abs(current.x - dest.x) <= 1 &&
+                std::abs(current.y - dest.y) <= 1 &&
+                canStep(current, dest, walkmask))
+        {
+            path.push_back(dest);
+            return path;
+        }
+
+        Point best = current;
+        int bestCost = currentCost;
+
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                const Point next(current.x + dx, current.y + dy);
+                if ((dx == 0 && dy == 0) || !covers(next))
+                    continue;
+
+                const int nextIndex = getIndex(next);
+                if (mStates[nextIndex] == SETTLED &&
+                        mCosts[nextIndex] < bestCost &&
+                        canStep(current, next, walkmask))
+                {
+                    best = next;
+                    bestCost = mCosts[nextIndex];
+                }
+            }
+        }
+
+        // Arrived next to the target or blocked by other beings
+        if (best == current)
+            break;
+
+        path.push_back(best);
+        current = best;
+        currentCost = bestCost;
+    }
+
+    if (current != dest)
+    {
+        const int distance = std::max(std::abs(current.x - dest.x),
+                                      std::abs(current.y - dest.y));
+        if (distance > finishRange)
+            return Path();
+
+        // Beings around a target usually end up two tiles away from their
+        // destination, look for a tile between them before searching.
+        if (distance == 2)
+        {
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    const Point next(current.x + dx, current.y + dy);
+                    if (std::abs(next.x - dest.x) <= 1 &&
+                            std::abs(next.y - dest.y) <= 1 &&
+                            canStep(current, next, walkmask) &&
+                            canStep(next, dest, walkmask))
+                    {
+                        path.push_back(next);
+                        path.push_back(dest);
+                        return path;
+                    }
+                }
+            }
+        }
+
+        Path end = mMap->findPath(current.x, current.y, dest.x, dest.y,
+                                  walkmask, finishRange * 4);
+        if (end.empty())
+            return Path();
+
+        path.splice(path.end(), end);
+    }
+
+    return path;
+}
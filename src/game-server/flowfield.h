@@ -0,0 +1,170 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include <vector>
+
+#include "game-server/map.h"
+
+/**
+ * Cost of walking to a target tile from the tiles around it, shared by all
+ * the beings heading to that tile.
+ *
+ * The field is a Dijkstra search started from the target and limited to a
+ * square around it. It is filled in lazily: the search only goes on as far as
+ * needed to reach the tile of a being asking for a path, and the next beings
+ * resume it where it stopped. A being then walks down the field, always
+ * stepping to the free neighbour closest to the target.
+ *
+ * Only walls are taken into account by the search, so that beings moving
+ * around do not make the field stale. They are avoided while walking down.
+ *
+ * Filling in a whole field costs about as much as eight path searches across
+ * it, so fields are meant for large packs chasing the same target from far
+ * away. With 50 beings within 32 tiles of their target, walking down the
+ * field is about twice as fast as searching each path with the tile
+ * pathfinder, and four times as fast as going through the cluster graph.
+ */
+class FlowField
+{
+    public:
+        /** Distance from the target to the edges of the field, in tiles. */
+        static const int RADIUS = 32;
+
+        FlowField(const Map *map, int targetX, int targetY);
+
+        /**
+         * Starts the field again, for the given target. The search itself
+         * only starts when a path is asked for.
+         */
+        void reset(int targetX, int targetY);
+
+        bool isFor(int targetX, int targetY) const
+        { return mTarget.x == targetX && mTarget.y == targetY; }
+
+        /**
+         * Notifies that the wall state of a tile changed. The field becomes
+         * stale when it covers the tile.
+         */
+        void tileChanged(int x, int y);
+
+        bool isStale() const
+        { return mStale; }
+
+        unsigned getLastUse() const
+        { return mLastUse; }
+
+        void setLastUse(unsigned use)
+        { mLastUse = use; }
+
+        /**
+         * Counts a request for the field.
+         * @returns the number of requests since the field was reset.
+         */
+        unsigned addRequest()
+        { return ++mRequests; }
+
+        /**
+         * Finds a path from \a start to \a dest, a tile close to the target,
+         * for a being with the given walkmask, by walking down the field.
+         * When the field leads next to the target without passing by
+         * \a dest, the last steps are searched with the tile pathfinder.
+         *
+         * @returns an empty path when \a start is not covered by the field or
+         *          when the field does not lead close enough to \a dest,
+         *          for example because other beings are in the way.
+         */
+        Path findPath(const Point &start, const Point &dest,
+                      unsigned char walkmask);
+
+    private:
+        enum TileState
+        {
+            UNKNOWN,        /**< Not looked at yet. */
+            BLOCKED,        /**< Wall, or border of the field. */
+            WALKABLE,
+            SETTLED         /**< Walkable, with its final cost. */
+        };
+
+        bool covers(const Point &tile) const
+        {
+            return tile.x >= mOrigin.x && tile.y >= mOrigin.y &&
+                   tile.x < mOrigin.x + mWidth &&
+                   tile.y < mOrigin.y + mHeight;
+        }
+
+        int getIndex(const Point &tile) const
+        {
+            return (tile.x - mOrigin.x + 1) +
+                   (tile.y - mOrigin.y + 1) * mStride;
+        }
+
+        /**
+         * Tells whether a tile is free of walls, remembering the result.
+         */
+        bool isWalkable(int index);
+
+        /**
+         * Tells whether a tile is free for a being with the given walkmask.
+         */
+        bool isFree(const Point &tile, unsigned char walkmask);
+
+        /**
+         * Tells whether a being with the given walkmask can step between two
+         * neighbouring tiles.
+         */
+        bool canStep(const Point &from, const Point &to,
+                     unsigned char walkmask);
+
+        /**
+         * Starts the search from the target.
+         */
+        void startSearch();
+
+        /**
+         * Goes on with the search until the cost of the given tile is known.
+         * @returns the cost, or -1 when the tile cannot reach the target.
+         */
+        int settle(const Point &tile);
+
+        const Map *mMap;
+        Point mTarget;
+        Point mOrigin;                  /**< Top left tile of the field. */
+        int mWidth, mHeight;
+        int mStride;                    /**< Row length, with the border. */
+        int mNeighbours[8];             /**< Index offsets of neighbours. */
+        std::vector<int> mCosts;        /**< Cost to the target, or -1. */
+        std::vector<char> mStates;      /**< TileState values. */
+
+        /**
+         * Tiles waiting for a visit, by cost modulo the number of buckets.
+         */
+        std::vector<std::vector<int> > mBuckets;
+        int mSearchCost;                /**< Cost of the tiles being visited. */
+        int mOpenCount;                 /**< Tiles waiting in the buckets. */
+        bool mStarted;
+        bool mStale;
+        unsigned mLastUse;
+        unsigned mRequests;
+};
+
+#endif // FLOWFIELD_H
@@ -133,7 +133,7 @@ void GameHandler::updateCharacter(int charid, int partyid)
                 c->character->getComponent<CharacterComponent>();
 
         if (characterComponent->getDatabaseID() == charid)
-            characterComponent->setParty(partyid);
+            characterComponent->setParty(*c->character, partyid);
     }
 }
 
@@ -337,6 +337,16 @@ void GameHandler::sendTo(Entity *beingPtr, MessageOut &msg)
 void GameHandler::sendTo(GameClient *client, MessageOut &msg)
 {
     assert(client && client->status == CLIENT_CONNECTED);
+
+    // The message may be filled again by the caller before it is sent
+    if (GameState::SideEffects *sideEffects = GameState::getSideEffects())
+    {
+        sideEffects->push_back([this, client, msg]() mutable {
+            sendTo(client, msg);
+        });
+        return;
+    }
+
     client->send(msg);
 }
 
@@ -526,7 +536,7 @@ void GameHandler::handlePickup(GameClient &client, MessageIn &message)
 
                     // We only do this when items are to be kept in memory
                     // between two server restart.
-                    if (!Configuration::getValue("game_floorItemDecayTime", 0))
+                    if (!Configuration::getSettings().floorItemDecayTime)
                     {
                         // Remove the floor item from map
                         accountHandler->removeFloorItems(map->getID(),
@@ -601,7 +611,7 @@ void GameHandler::handleDrop(GameClient &client, MessageIn &message)
 
         // We store the item in database only when the floor items are meant
         // to be persistent between two server restarts.
-        if (!Configuration::getValue("game_floorItemDecayTime", 0))
+        if (!Configuration::getSettings().floorItemDecayTime)
         {
             // Create the floor item on map
             accountHandler->createFloorItems(client.character->getMap()->getID(),
@@ -962,7 +972,7 @@ void GameHandler::handleNpcPostSend(GameClient &client, MessageIn &message)
 void GameHandler::handlePartyInvite(GameClient &client, MessageIn &message)
 {
     MapComposite *map = client.character->getMap();
-    const int visualRange = Configuration::getValue("game_visualRange", 448);
+    const int visualRange = Configuration::getSettings().visualRange;
     std::string invitee = message.readString();
 
     if (invitee == client.character->getComponent<BeingComponent>()->getName())
@@ -158,18 +158,28 @@ void ItemClass::addAttack(AttackInfo *attackInfo,
 
 ItemComponent::ItemComponent(ItemClass *type, int amount) :
     mType(type),
-    mAmount(amount)
+    mAmount(amount),
+    mDecaying(false)
 {
-    mLifetime = Configuration::getValue("game_floorItemDecayTime", 0) * 10;
+    mLifetime = Configuration::getSettings().floorItemDecayTime * 10;
 }
 
 void ItemComponent::update(Entity &entity)
 {
-    if (mLifetime)
+    // Items are only updated when dropped and when they decay, they sleep
+    // the rest of the time.
+    if (mDecaying || mLifetime == 1)
     {
-        mLifetime--;
-        if (!mLifetime)
-            GameState::enqueueRemove(&entity);
+        GameState::enqueueRemove(&entity);
+    }
+    else if (mLifetime)
+    {
+        mDecaying = true;
+        entity.sleep(mLifetime - 1);
+    }
+    else
+    {
+        entity.sleep();
     }
 }
 
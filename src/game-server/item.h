@@ -316,7 +316,8 @@ class ItemComponent : public Component
     private:
         ItemClass *mType;
         unsigned char mAmount;
-        int mLifetime;
+        int mLifetime;      /**< Ticks before decaying, 0 for never. */
+        bool mDecaying;     /**< Whether the item sleeps until it decays. */
 };
 
 namespace Item {
@@ -75,6 +75,7 @@ static int const WORLD_TICK_SKIP = 2; /** tolerance for lagging behind in world
 static utils::Timer worldTimer(WORLD_TICK_MS);
 static int currentTick = 0;     /**< Current world time in ticks */
 static bool running = true;     /**< Whether the server keeps running */
+static volatile sig_atomic_t reloadConfiguration = false; /**< Whether to reload the config */
 
 utils::StringFilter *stringFilter; /**< Slang's Filter */
 
@@ -105,6 +106,14 @@ static void closeGracefully(int)
     running = false;
 }
 
+#ifdef SIGHUP
+/** Callback used when SIGHUP signal is received. */
+static void requestConfigurationReload(int)
+{
+    reloadConfiguration = true;
+}
+#endif
+
 static void initializeServer()
 {
     // Used to close via process signals
@@ -113,6 +122,10 @@ static void initializeServer()
 #endif
     signal(SIGINT, closeGracefully);
     signal(SIGTERM, closeGracefully);
+#ifdef SIGHUP
+    // Used to reload the configuration without restarting
+    signal(SIGHUP, requestConfigurationReload);
+#endif
 
     std::string logFile = Configuration::getValue("log_gameServerFile",
                                                   DEFAULT_LOG_FILE);
@@ -312,6 +325,16 @@ int main(int argc, char *argv[])
                                                        options.verbosity) );
     Logger::setVerbosity(options.verbosity);
 
+    // Follow changes of the log level, unless it was given on the command line
+    if (!options.verbosityChanged)
+    {
+        Configuration::addReloadListener([]() {
+            Logger::setVerbosity(static_cast<Logger::Level>(
+                    Configuration::getValue("log_gameServerLogLevel",
+                                            Logger::Warn)));
+        });
+    }
+
     // General initialization
     initializeServer();
 
@@ -391,6 +414,12 @@ int main(int argc, char *argv[])
             currentTick++;
             elapsedTicks--;
 
+            if (reloadConfiguration)
+            {
+                reloadConfiguration = false;
+                Configuration::reload();
+            }
+
             // Print world time at 10 second intervals to show we're alive
             if (currentTick % 100 == 0)
                 LOG_INFO("World time: " << currentTick);
@@ -25,7 +25,9 @@
 #include <limits.h>
 
 #include "game-server/map.h"
+#include "game-server/flowfield.h"
 
+#include "common/configuration.h"
 #include "common/defines.h"
 
 /**
@@ -49,6 +51,26 @@ class PathInfo
         int parentY;            /**< Y coordinate of parent tile */
 };
 
+/**
+ * A location on a tile map. Used for pathfinding, open list.
+ */
+class Location
+{
+    public:
+        Location(int x, int y, int Fcost):
+            x(x), y(y), Fcost(Fcost)
+        {}
+
+        /**
+         * Comparison operator.
+         */
+        bool operator< (const Location &other) const
+        { return Fcost > other.Fcost; }
+
+        int x, y;
+        int Fcost;              /**< Estimation of total path cost */
+};
+
 /**
  * A helper class for finding a path on a map, functor style.
  */
@@ -58,7 +80,14 @@ class FindPath
         FindPath() :
             mWidth(0),
             mOnClosedList(1),
-            mOnOpenList(2)
+            mOnOpenList(2),
+            mMap(nullptr),
+            mWalkmask(0),
+            mDestX(0),
+            mDestY(0),
+            mMaxGcost(0),
+            mFoundPath(false),
+            mPushes(0)
         {}
 
         Path operator() (int startX, int startY,
@@ -66,44 +95,73 @@ class FindPath
                          unsigned char walkmask, int maxCost,
                          const Map *map);
 
+        unsigned long getPushes() const
+        { return mPushes; }
+
     private:
         PathInfo *getInfo(int x, int y)
         { return &mPathInfos.at(x + y * mWidth); }
 
         void prepare(const Map *map);
 
-        int mWidth;
-        std::vector<PathInfo> mPathInfos;
-        unsigned mOnClosedList, mOnOpenList;
-};
-
-static FindPath findPath;
+        /**
+         * Jump point search variant of the search. Since all steps in the
+         * same direction cost the same, only the tiles where an optimal
+         * path may turn are put on the open list. The tiles in between are
+         * filled in when extracting the path.
+         */
+        Path findJumpPath(int startX, int startY,
+                          int destX, int destY,
+                          unsigned char walkmask, int maxCost,
+                          const Map *map);
 
+        /**
+         * Adds the tile reached by jumping from \a parent in the given
+         * direction to the open list, if any.
+         */
+        void jump(const PathInfo *parent, int parentX, int parentY,
+                  int dx, int dy, std::priority_queue<Location> &openList);
 
-/**
- * A location on a tile map. Used for pathfinding, open list.
- */
-class Location
-{
-    public:
-        Location(int x, int y, int Fcost):
-            x(x), y(y), Fcost(Fcost)
-        {}
+        /**
+         * Walks in a straight line until reaching a tile where the path may
+         * have to turn. \a x and \a y are updated to that tile.
+         * @returns the G cost of the tile, or -1 when there is none.
+         */
+        int jumpStraight(int &x, int &y, int dx, int dy, int Gcost) const;
 
         /**
-         * Comparison operator.
+         * Walks diagonally until reaching a tile from which a straight jump
+         * finds a turn. \a x and \a y are updated to that tile.
+         * @returns the G cost of the tile, or -1 when there is none.
          */
-        bool operator< (const Location &other) const
-        { return Fcost > other.Fcost; }
+        int jumpDiagonal(int &x, int &y, int dx, int dy, int Gcost) const;
 
-        int x, y;
-        int Fcost;              /**< Estimation of total path cost */
+        bool isWalkable(int x, int y) const
+        { return mMap->getWalk(x, y, mWalkmask); }
+
+        int mWidth;
+        std::vector<PathInfo> mPathInfos;
+        unsigned mOnClosedList, mOnOpenList;
+
+        // State of the jump point search in progress
+        const Map *mMap;
+        unsigned char mWalkmask;
+        int mDestX, mDestY;
+        int mMaxGcost;
+        bool mFoundPath;
+
+        unsigned long mPushes;  /**< Tiles put on the open list so far. */
 };
 
+// Paths are searched by several threads when the searches are queued
+static thread_local FindPath findPath;
+
+
 Map::Map(int width, int height, int tileWidth, int tileHeight):
     mWidth(width), mHeight(height),
     mTileWidth(tileWidth), mTileHeight(tileHeight),
-    mMetaTiles(width * height)
+    mMetaTiles(width * height),
+    mFlowFieldUses(0)
 {
 }
 
@@ -114,6 +172,12 @@ Map::~Map()
     {
         delete *it;
     }
+
+    for (std::vector<FlowField *>::iterator it = mFlowFields.begin();
+         it != mFlowFields.end(); ++it)
+    {
+        delete *it;
+    }
 }
 
 void Map::setSize(int width, int height)
@@ -122,6 +186,14 @@ void Map::setSize(int width, int height)
     mHeight = height;
 
     mMetaTiles.resize(width * height);
+    mClusterGraph.clear();
+
+    for (std::vector<FlowField *>::iterator it = mFlowFields.begin();
+         it != mFlowFields.end(); ++it)
+    {
+        delete *it;
+    }
+    mFlowFields.clear();
 }
 
 const std::string &Map::getProperty(const std::string &key) const
@@ -148,6 +220,7 @@ void Map::blockTile(int x, int y, BlockType type)
         {
             case BLOCKTYPE_WALL:
                 metaTile.blockmask |= BLOCKMASK_WALL;
+                wallChanged(x, y);
                 break;
             case BLOCKTYPE_CHARACTER:
                 metaTile.blockmask |= BLOCKMASK_CHARACTER;
@@ -176,6 +249,7 @@ void Map::freeTile(int x, int y, BlockType type)
         {
             case BLOCKTYPE_WALL:
                 metaTile.blockmask &= (BLOCKMASK_WALL xor 0xff);
+                wallChanged(x, y);
                 break;
             case BLOCKTYPE_CHARACTER:
                 metaTile.blockmask &= (BLOCKMASK_CHARACTER xor 0xff);
@@ -190,6 +264,17 @@ void Map::freeTile(int x, int y, BlockType type)
     }
 }
 
+void Map::wallChanged(int x, int y)
+{
+    mClusterGraph.tileChanged(x, y);
+
+    for (std::vector<FlowField *>::iterator it = mFlowFields.begin(),
+         it_end = mFlowFields.end(); it != it_end; ++it)
+    {
+        (*it)->tileChanged(x, y);
+    }
+}
+
 bool Map::getWalk(int x, int y, char walkmask) const
 {
     // You can't walk outside of the map
@@ -204,17 +289,138 @@ Path Map::findPath(int startX, int startY,
                    int destX, int destY,
                    unsigned char walkmask, int maxCost) const
 {
+    // Every step costs at least one tile, so there is no need to search when
+    // the destination is further away than the cost limit
+    if (std::max(std::abs(destX - startX), std::abs(destY - startY)) > maxCost)
+        return Path();
+
     return ::findPath(startX, startY,
                       destX, destY,
                       walkmask, maxCost,
                       this);
 }
 
+unsigned long Map::getOpenListPushes()
+{
+    return ::findPath.getPushes();
+}
+
+FlowField *Map::getFlowField(int targetX, int targetY)
+{
+    FlowField *field = nullptr;
+    for (std::vector<FlowField *>::iterator it = mFlowFields.begin(),
+         it_end = mFlowFields.end(); it != it_end; ++it)
+    {
+        if ((*it)->isFor(targetX, targetY))
+        {
+            field = *it;
+            if (field->isStale())
+                field->reset(targetX, targetY);
+            break;
+        }
+    }
+
+    if (!field)
+    {
+        if (mFlowFields.size() < MAX_FLOW_FIELDS)
+        {
+            field = new FlowField(this, targetX, targetY);
+            mFlowFields.push_back(field);
+        }
+        else
+        {
+            // Reuse the field that was used the longest time ago
+            field = mFlowFields.front();
+            for (std::vector<FlowField *>::iterator it = mFlowFields.begin(),
+                 it_end = mFlowFields.end(); it != it_end; ++it)
+            {
+                if ((*it)->getLastUse() < field->getLastUse())
+                    field = *it;
+            }
+            field->reset(targetX, targetY);
+        }
+    }
+
+    field->setLastUse(++mFlowFieldUses);
+    return field->addRequest() > 1 ? field : nullptr;
+}
+
+Path Map::findLongPath(int startX, int startY,
+                       int destX, int destY,
+                       unsigned char walkmask,
+                       int maxCost)
+{
+    // Limits the tile pathfinder reaches by itself do not need the graph
+    if (!mClusterGraph.isBuilt() ||
+            (maxCost > 0 && maxCost <= ClusterGraph::CLUSTER_SIZE * 2))
+    {
+        return findPath(startX, startY, destX, destY, walkmask,
+                        maxCost > 0 ? maxCost : 20);
+    }
+
+    Path path;
+
+    const int distance = std::max(std::abs(destX - startX),
+                                  std::abs(destY - startY));
+    if ((maxCost > 0 && distance > maxCost) ||
+            !getWalk(destX, destY, walkmask))
+        return path;
+
+    // Close destinations are found faster by the tile pathfinder alone. The
+    // route on the cluster graph is only needed when it has to go far around.
+    if (distance <= ClusterGraph::CLUSTER_SIZE)
+    {
+        path = ::findPath(startX, startY, destX, destY,
+                          walkmask, ClusterGraph::CLUSTER_SIZE * 2, this);
+        if (!path.empty())
+            return path;
+    }
+
+    std::vector<ClusterGraph::Step> steps;
+    if (!mClusterGraph.findRoute(Point(startX, startY), Point(destX, destY),
+                                 steps))
+        return path;
+
+    if (maxCost > 0)
+    {
+        int routeCost = 0;
+        for (std::vector<ClusterGraph::Step>::const_iterator
+             it = steps.begin(), it_end = steps.end(); it != it_end; ++it)
+            routeCost += it->cost;
+        if (routeCost > maxCost * ClusterGraph::BASIC_COST)
+            return path;
+    }
+
+    // Each step is close to the previous one, so the tile pathfinder only
+    // explores a small area. It is given some margin to walk around beings.
+    Point current(startX, startY);
+    for (std::vector<ClusterGraph::Step>::const_iterator it = steps.begin(),
+         it_end = steps.end(); it != it_end; ++it)
+    {
+        const int maxCost = it->cost / ClusterGraph::BASIC_COST +
+                            ClusterGraph::CLUSTER_SIZE / 2;
+        Path segment = ::findPath(current.x, current.y,
+                                  it->tile.x, it->tile.y,
+                                  walkmask, maxCost, this);
+        if (segment.empty())
+            return Path();
+
+        path.splice(path.end(), segment);
+        current = it->tile;
+    }
+
+    return path;
+}
+
 Path FindPath::operator() (int startX, int startY,
                            int destX, int destY,
                            unsigned char walkmask, int maxCost,
                            const Map *map)
 {
+    if (Configuration::getSettings().jumpPointSearch)
+        return findJumpPath(startX, startY, destX, destY,
+                            walkmask, maxCost, map);
+
     // Basic cost for moving from one tile to another.
     static int const basicCost = 100;
 
@@ -236,6 +442,7 @@ Path FindPath::operator() (int startX, int startY,
 
     // Add the start point to the open list (F cost irrelevant here)
     openList.push(Location(startX, startY, 0));
+    ++mPushes;
 
     bool foundPath = false;
 
@@ -333,6 +540,7 @@ Path FindPath::operator() (int startX, int startY,
                         // Add this tile to the open list
                         newTile->whichList = mOnOpenList;
                         openList.push(Location(x, y, Gcost + newTile->Hcost));
+                        ++mPushes;
                     }
                     else
                     {
@@ -353,6 +561,7 @@ Path FindPath::operator() (int startX, int startY,
                     // Add this tile to the open list (it's already
                     // there, but this instance has a lower F score)
                     openList.push(Location(x, y, Gcost + newTile->Hcost));
+                    ++mPushes;
                 }
             }
         }
@@ -380,6 +589,218 @@ Path FindPath::operator() (int startX, int startY,
     return path;
 }
 
+// Costs of the jump point search. Horizontal and vertical steps include the
+// same defect as in the A* search, so that both find paths of equal cost.
+static int const jumpStraightCost = 100 + 1;
+static int const jumpDiagonalCost = 100 * 362 / 256;
+
+static int sign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+Path FindPath::findJumpPath(int startX, int startY,
+                            int destX, int destY,
+                            unsigned char walkmask, int maxCost,
+                            const Map *map)
+{
+    Path path;
+
+    if (!map->getWalk(destX, destY, walkmask))
+        return path;
+
+    prepare(map);
+
+    mMap = map;
+    mWalkmask = walkmask;
+    mDestX = destX;
+    mDestY = destY;
+    mMaxGcost = maxCost * 100;
+    mFoundPath = false;
+
+    std::priority_queue<Location> openList;
+
+    PathInfo *startTile = getInfo(startX, startY);
+    startTile->Gcost = 0;
+    openList.push(Location(startX, startY, 0));
+    ++mPushes;
+
+    while (!openList.empty())
+    {
+        Location curr = openList.top();
+        openList.pop();
+        PathInfo *currInfo = getInfo(curr.x, curr.y);
+
+        if (currInfo->whichList == mOnClosedList)
+            continue;
+
+        currInfo->whichList = mOnClosedList;
+
+        // A long jump may reach the destination before a cheaper route, so
+        // the search only ends once the destination has the lowest cost
+        if (curr.x == destX && curr.y == destY)
+        {
+            mFoundPath = true;
+            break;
+        }
+
+        if (curr.x == startX && curr.y == startY)
+        {
+            // Nothing to prune around the start
+            for (int dy = -1; dy <= 1; ++dy)
+                for (int dx = -1; dx <= 1; ++dx)
+                    if (dx != 0 || dy != 0)
+                        jump(currInfo, curr.x, curr.y, dx, dy, openList);
+            continue;
+        }
+
+        // Only look ahead and to the sides of the direction the tile was
+        // reached from. The other neighbours are reached more cheaply
+        // through the parent.
+        const int dx = sign(curr.x - currInfo->parentX);
+        const int dy = sign(curr.y - currInfo->parentY);
+
+        if (dx != 0 && dy != 0)
+        {
+            jump(currInfo, curr.x, curr.y, dx, 0, openList);
+            jump(currInfo, curr.x, curr.y, 0, dy, openList);
+            jump(currInfo, curr.x, curr.y, dx, dy, openList);
+        }
+        else
+        {
+            // Sideways tiles may need a turn when a wall ends next to them
+            const int sideX = dy, sideY = dx;
+            jump(currInfo, curr.x, curr.y, dx, dy, openList);
+            jump(currInfo, curr.x, curr.y, dx + sideX, dy + sideY, openList);
+            jump(currInfo, curr.x, curr.y, dx - sideX, dy - sideY, openList);
+            jump(currInfo, curr.x, curr.y, sideX, sideY, openList);
+            jump(currInfo, curr.x, curr.y, -sideX, -sideY, openList);
+        }
+    }
+
+    if (mFoundPath)
+    {
+        // Fill in the straight lines between the jump points
+        int pathX = destX;
+        int pathY = destY;
+
+        while (pathX != startX || pathY != startY)
+        {
+            const PathInfo *tile = getInfo(pathX, pathY);
+            const int parentX = tile->parentX;
+            const int parentY = tile->parentY;
+            const int stepX = sign(parentX - pathX);
+            const int stepY = sign(parentY - pathY);
+
+            while (pathX != parentX || pathY != parentY)
+            {
+                path.push_front(Point(pathX, pathY));
+                pathX += stepX;
+                pathY += stepY;
+            }
+        }
+    }
+
+    return path;
+}
+
+void FindPath::jump(const PathInfo *parent, int parentX, int parentY,
+                    int dx, int dy, std::priority_queue<Location> &openList)
+{
+    int x = parentX;
+    int y = parentY;
+    const int Gcost = dx != 0 && dy != 0 ?
+            jumpDiagonal(x, y, dx, dy, parent->Gcost) :
+            jumpStraight(x, y, dx, dy, parent->Gcost);
+
+    if (Gcost < 0)
+        return;
+
+    PathInfo *newTile = getInfo(x, y);
+    if (newTile->whichList == mOnClosedList)
+        return;
+
+    if (newTile->whichList != mOnOpenList)
+    {
+        const int distX = std::abs(x - mDestX);
+        const int distY = std::abs(y - mDestY);
+        newTile->Hcost = std::abs(distX - distY) * 100 +
+                std::min(distX, distY) * jumpDiagonalCost;
+    }
+    else if (Gcost >= newTile->Gcost)
+    {
+        return;
+    }
+
+    newTile->parentX = parentX;
+    newTile->parentY = parentY;
+    newTile->Gcost = Gcost;
+
+    newTile->whichList = mOnOpenList;
+    openList.push(Location(x, y, Gcost + newTile->Hcost));
+    ++mPushes;
+}
+
+int FindPath::jumpStraight(int &x, int &y, int dx, int dy, int Gcost) const
+{
+    for (;;)
+    {
+        x += dx;
+        y += dy;
+        Gcost += jumpStraightCost;
+
+        if (Gcost > mMaxGcost || !isWalkable(x, y))
+            return -1;
+
+        if (x == mDestX && y == mDestY)
+            return Gcost;
+
+        // A tile next to the line can only be reached optimally by turning
+        // here when the wall that was in front of it ends.
+        if (dx != 0)
+        {
+            if ((isWalkable(x, y - 1) && !isWalkable(x - dx, y - 1)) ||
+                (isWalkable(x, y + 1) && !isWalkable(x - dx, y + 1)))
+                return Gcost;
+        }
+        else
+        {
+            if ((isWalkable(x - 1, y) && !isWalkable(x - 1, y - dy)) ||
+                (isWalkable(x + 1, y) && !isWalkable(x + 1, y - dy)))
+                return Gcost;
+        }
+    }
+}
+
+int FindPath::jumpDiagonal(int &x, int &y, int dx, int dy, int Gcost) const
+{
+    for (;;)
+    {
+        // Diagonal steps cannot cut corners
+        if (!isWalkable(x + dx, y) || !isWalkable(x, y + dy))
+            return -1;
+
+        x += dx;
+        y += dy;
+        Gcost += jumpDiagonalCost;
+
+        if (Gcost > mMaxGcost || !isWalkable(x, y))
+            return -1;
+
+        if (x == mDestX && y == mDestY)
+            return Gcost;
+
+        int straightX = x, straightY = y;
+        if (jumpStraight(straightX, straightY, dx, 0, Gcost) >= 0)
+            return Gcost;
+
+        straightX = x;
+        straightY = y;
+        if (jumpStraight(straightX, straightY, 0, dy, Gcost) >= 0)
+            return Gcost;
+    }
+}
+
 void FindPath::prepare(const Map *map)
 {
     // Two new values to indicate whether a tile is on the open or closed list,
@@ -26,10 +26,14 @@
 #include <string>
 #include <vector>
 
+#include "game-server/clustergraph.h"
+
 #include "utils/logger.h"
 #include "utils/point.h"
 #include "utils/string.h"
 
+class FlowField;
+
 typedef std::list<Point> Path;
 
 enum BlockType
@@ -198,6 +202,41 @@ class Map
                       unsigned char walkmask,
                       int maxCost = 20) const;
 
+        /**
+         * Gets the amount of tiles that the path searches of the calling
+         * thread have put on their open list so far.
+         */
+        static unsigned long getOpenListPushes();
+
+        /**
+         * Find a path of any length from one location to the next. The route
+         * is searched on the cluster graph first, then refined tile by tile.
+         * When a cost limit is given, longer paths are not found, and limits
+         * within the reach of the tile pathfinder only use that one.
+         */
+        Path findLongPath(int startX, int startY,
+                          int destX, int destY,
+                          unsigned char walkmask,
+                          int maxCost = 0);
+
+        /**
+         * Builds the cluster graph used to find long paths. To be called
+         * once the walls of the map are known.
+         */
+        void buildClusterGraph()
+        { mClusterGraph.build(this); }
+
+        /**
+         * Gets the flow field leading beings to a tile. Fields are kept for
+         * the next beings heading to the same tile until a wall appears or
+         * disappears around it.
+         *
+         * Returns a null pointer on the first request for a tile since its
+         * field was reset, since searching the path of a single being
+         * directly is cheaper than filling in a field.
+         */
+        FlowField *getFlowField(int targetX, int targetY);
+
         /**
          * Blockmasks for different entities
          */
@@ -206,6 +245,15 @@ class Map
         static const unsigned char BLOCKMASK_MONSTER = 0x02;  // = bin 0000 0010
 
     private:
+        /**
+         * Notifies the cluster graph and the flow fields that the wall state
+         * of a tile changed.
+         */
+        void wallChanged(int x, int y);
+
+        /** Number of flow fields kept before reusing the oldest one. */
+        static const unsigned MAX_FLOW_FIELDS = 8;
+
         // map properties
         int mWidth, mHeight;
         int mTileWidth, mTileHeight;
@@ -213,6 +261,11 @@ class Map
 
         std::vector<MetaTile> mMetaTiles;
         std::vector<MapObject*> mMapObjects;
+
+        ClusterGraph mClusterGraph;
+
+        std::vector<FlowField *> mFlowFields;
+        unsigned mFlowFieldUses;    /**< Orders the uses of flow fields. */
 };
 
 #endif
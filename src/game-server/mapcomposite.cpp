@@ -33,147 +33,142 @@
 #include "game-server/mapreader.h"
 #include "game-server/monstermanager.h"
 #include "game-server/spawnareacomponent.h"
+#include "game-server/state.h"
 #include "game-server/triggerareacomponent.h"
 #include "scripting/script.h"
 #include "scripting/scriptmanager.h"
 #include "utils/logger.h"
 #include "utils/point.h"
 
-/* TODO: Implement overlapping map zones instead of strict partitioning.
-   Purpose: to decrease the number of zone changes, as overlapping allows for
-   hysteresis effect and prevents an actor from changing zone each server
-   tick. It requires storing the zone in the actor since it will not be
-   uniquely defined any longer. */
-
-/* Pixel-based width and height of the squares used in partitioning the map.
+/* Default pixel-based width and height of the squares used in partitioning
+   the map. Maps can override it with the "zonesize" property.
    Squares should be big enough so that an actor cannot cross several ones
-   in one world tick.
-   TODO: Tune for decreasing server load. The higher the value, the closer we
-   regress to quadratic behavior; the lower the value, the more we waste time
-   in dealing with zone changes. */
-static int const zoneDiam = 256;
+   in one world tick. The higher the value, the closer we regress to
+   quadratic behavior; the lower the value, the more we waste time in
+   dealing with zone changes. */
+static int const defaultZoneDiam = 256;
+
+/* Zones overlap: an actor only changes zone once it is further than the
+   margin, a fraction of the zone size, outside of its current zone. This
+   hysteresis prevents an actor walking along a border from changing zone
+   each server tick. As a consequence the zone of an actor is stored in the
+   actor, and regions are extended by the margin. Maps can set the margin in
+   pixels with the "zonemargin" property, 0 turning the hysteresis off. */
+static int const zoneMarginDivisor = 4;
+
+void MapZone::place(Entity *obj, unsigned pos)
+{
+    objects[pos] = obj;
+    obj->getComponent<ActorComponent>()->setZoneSlot(pos);
+}
 
 void MapZone::insert(Entity *obj)
 {
+    // Make room at the end of each part preceding the one of the object, by
+    // moving the first object of the following part to its end.
+    unsigned pos = objects.size();
+    objects.push_back(obj);
+
     int type = obj->getType();
     switch (type)
     {
         case OBJECT_CHARACTER:
-        {
-            if (nbCharacters != nbMovingObjects)
-            {
-                if (nbMovingObjects != objects.size())
-                {
-                    objects.push_back(objects[nbMovingObjects]);
-                    objects[nbMovingObjects] = objects[nbCharacters];
-                }
-                else
-                {
-                    objects.push_back(objects[nbCharacters]);
-                }
-                objects[nbCharacters] = obj;
-                ++nbCharacters;
-                ++nbMovingObjects;
-                break;
-            }
-            ++nbCharacters;
-        } // no break!
         case OBJECT_MONSTER:
         case OBJECT_NPC:
         {
-            if (nbMovingObjects != objects.size())
+            if (pos != nbMovingObjects)
             {
-                objects.push_back(objects[nbMovingObjects]);
-                objects[nbMovingObjects] = obj;
-                ++nbMovingObjects;
-                break;
+                place(objects[nbMovingObjects], pos);
+                pos = nbMovingObjects;
             }
             ++nbMovingObjects;
-        } // no break!
+
+            if (type != OBJECT_CHARACTER)
+                break;
+
+            if (pos != nbCharacters)
+            {
+                place(objects[nbCharacters], pos);
+                pos = nbCharacters;
+            }
+            ++nbCharacters;
+        } break;
+
         default:
-        {
-            objects.push_back(obj);
             break;
-        }
     }
+
+    place(obj, pos);
 }
 
 void MapZone::remove(Entity *obj)
 {
-    std::vector< Entity * >::iterator i_beg = objects.begin(), i, i_end;
-    int type = obj->getType();
-    switch (type)
-    {
-        case OBJECT_CHARACTER:
-        {
-            i = i_beg;
-            i_end = objects.begin() + nbCharacters;
-        } break;
-        case OBJECT_MONSTER:
-        case OBJECT_NPC:
-        {
-            i = objects.begin() + nbCharacters;
-            i_end = objects.begin() + nbMovingObjects;
-        } break;
-        default:
-        {
-            i = objects.begin() + nbMovingObjects;
-            i_end = objects.end();
-            break;
-        }
-    }
-    i = std::find(i, i_end, obj);
-    assert(i != i_end);
-    unsigned pos = i - i_beg;
+    unsigned pos = obj->getComponent<ActorComponent>()->getZoneSlot();
+    assert(pos < objects.size() && objects[pos] == obj);
+
+    // Fill the hole with the last object of each part, up to the last one.
+    // An object that is already the last of its part stays where it is, as
+    // placing it again would point it at the slot about to be emptied.
     if (pos < nbCharacters)
     {
-        objects[pos] = objects[nbCharacters - 1];
-        pos = nbCharacters - 1;
         --nbCharacters;
+        if (pos != nbCharacters)
+        {
+            place(objects[nbCharacters], pos);
+            pos = nbCharacters;
+        }
     }
     if (pos < nbMovingObjects)
     {
-        objects[pos] = objects[nbMovingObjects - 1];
-        pos = nbMovingObjects - 1;
         --nbMovingObjects;
+        if (pos != nbMovingObjects)
+        {
+            place(objects[nbMovingObjects], pos);
+            pos = nbMovingObjects;
+        }
     }
-    objects[pos] = objects[objects.size() - 1];
+    if (pos != objects.size() - 1)
+        place(objects.back(), pos);
     objects.pop_back();
 }
 
-static void addZone(MapRegion &r, unsigned z)
+void MapRegion::extend(int x, int y)
 {
-    MapRegion::iterator i_end = r.end(),
-                        i = std::lower_bound(r.begin(), i_end, z);
-    if (i == i_end || *i != z)
-    {
-        r.insert(i, z);
-    }
+    left = std::min(left, x);
+    top = std::min(top, y);
+    right = std::max(right, x);
+    bottom = std::max(bottom, y);
+}
+
+void MapRegion::extend(const MapRegion &r)
+{
+    left = std::min(left, r.left);
+    top = std::min(top, r.top);
+    right = std::max(right, r.right);
+    bottom = std::max(bottom, r.bottom);
 }
 
 ZoneIterator::ZoneIterator(const MapRegion &r, const MapContent *m)
-  : region(r), pos(0), map(m)
+  : region(r), x(r.left), y(r.top), map(m)
 {
-    current = &map->zones[r.empty() ? 0 : r[0]];
+    if (r.left <= r.right && r.top <= r.bottom)
+        current = &map->zones[x + y * map->mapWidth];
+    else
+        current = nullptr;
 }
 
 void ZoneIterator::operator++()
 {
-    current = nullptr;
-    if (!region.empty())
+    if (++x > region.right)
     {
-        if (++pos != region.size())
-        {
-            current = &map->zones[region[pos]];
-        }
+        x = region.left;
+        ++y;
     }
+
+    if (y <= region.bottom)
+        current = &map->zones[x + y * map->mapWidth];
     else
-    {
-        if (++pos != (unsigned)map->mapWidth * map->mapHeight)
-        {
-            current = &map->zones[pos];
-        }
-    }
+        current = nullptr;
 }
 
 CharacterIterator::CharacterIterator(const ZoneIterator &it)
@@ -273,6 +268,50 @@ void ActorIterator::operator++()
 }
 
 
+/******************************************************************************
+ * ComponentPool
+ *****************************************************************************/
+
+ComponentHandle ComponentPool::insert(Component *component, Entity *entity)
+{
+    unsigned slot;
+    if (mFreeSlots.empty())
+    {
+        slot = mSlots.size();
+        const Slot newSlot = { 0, 1 };
+        mSlots.push_back(newSlot);
+    }
+    else
+    {
+        slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+    }
+
+    mSlots[slot].entry = mEntries.size();
+    const Entry entry = { component, entity, slot };
+    mEntries.push_back(entry);
+
+    ComponentHandle handle;
+    handle.index = slot;
+    handle.generation = mSlots[slot].generation;
+    return handle;
+}
+
+void ComponentPool::remove(const ComponentHandle &handle)
+{
+    assert(get(handle));
+    Slot &slot = mSlots[handle.index];
+
+    // Move the last entry into the freed place
+    mEntries[slot.entry] = mEntries.back();
+    mSlots[mEntries[slot.entry].slot].entry = slot.entry;
+    mEntries.pop_back();
+
+    ++slot.generation;
+    mFreeSlots.push_back(handle.index);
+}
+
+
 /******************************************************************************
  * ObjectBucket
  *****************************************************************************/
@@ -348,7 +387,7 @@ void ObjectBucket::deallocate(int i)
  *****************************************************************************/
 
 MapContent::MapContent(Map *map)
-  : last_bucket(0), zones(nullptr)
+  : last_bucket(0), zones(nullptr), timers(GameState::getCurrentTick())
 {
     buckets[0] = new ObjectBucket;
     buckets[0]->allocate(); // Skip ID 0
@@ -356,6 +395,17 @@ MapContent::MapContent(Map *map)
     {
         buckets[i] = nullptr;
     }
+    zoneDiam = utils::stringToInt(map->getProperty("zonesize"));
+    if (zoneDiam <= 0)
+        zoneDiam = defaultZoneDiam;
+    const std::string &margin = map->getProperty("zonemargin");
+    zoneMargin = margin.empty() ? zoneDiam / zoneMarginDivisor
+                                : std::max(0, utils::stringToInt(margin));
+    zoneChanges = 0;
+    aiLevelsChanged = true;
+    aiSleepRange = 0;
+    aiVisualRange = 0;
+
     mapWidth = (map->getWidth() * map->getTileWidth() + zoneDiam - 1)
                / zoneDiam;
     mapHeight = (map->getHeight() * map->getTileHeight() + zoneDiam - 1)
@@ -422,39 +472,53 @@ void MapContent::deallocate(Entity *obj)
     buckets[id / 256]->deallocate(id % 256);
 }
 
-void MapContent::fillRegion(MapRegion &r, const Point &p, int radius) const
+MapRegion MapContent::getRegion(const Point &p, int radius) const
 {
-    int ax = p.x > radius ? (p.x - radius) / zoneDiam : 0,
-        ay = p.y > radius ? (p.y - radius) / zoneDiam : 0,
-        bx = std::min((p.x + radius) / zoneDiam, mapWidth - 1),
-        by = std::min((p.y + radius) / zoneDiam, mapHeight - 1);
-    for (int y = ay; y <= by; ++y)
-    {
-        for (int x = ax; x <= bx; ++x)
-        {
-            addZone(r, x + y * mapWidth);
-        }
-    }
+    // Actors may be stored in zones up to the margin away from them.
+    radius += zoneMargin;
+    return MapRegion(p.x > radius ? (p.x - radius) / zoneDiam : 0,
+                     p.y > radius ? (p.y - radius) / zoneDiam : 0,
+                     std::min((p.x + radius) / zoneDiam, mapWidth - 1),
+                     std::min((p.y + radius) / zoneDiam, mapHeight - 1));
 }
 
-void MapContent::fillRegion(MapRegion &r, const Rectangle &p) const
+MapRegion MapContent::getRegion(const Rectangle &p) const
 {
-    int ax = p.x / zoneDiam,
-        ay = p.y / zoneDiam,
-        bx = std::min((p.x + p.w) / zoneDiam, mapWidth - 1),
-        by = std::min((p.y + p.h) / zoneDiam, mapHeight - 1);
-    for (int y = ay; y <= by; ++y)
-    {
-        for (int x = ax; x <= bx; ++x)
-        {
-            addZone(r, x + y * mapWidth);
-        }
-    }
+    // Actors may be stored in zones up to the margin away from them.
+    return MapRegion(p.x > zoneMargin ? (p.x - zoneMargin) / zoneDiam : 0,
+                     p.y > zoneMargin ? (p.y - zoneMargin) / zoneDiam : 0,
+                     std::min((p.x + p.w + zoneMargin) / zoneDiam,
+                              mapWidth - 1),
+                     std::min((p.y + p.h + zoneMargin) / zoneDiam,
+                              mapHeight - 1));
+}
+
+MapRegion MapContent::getRegion(unsigned zone, int radius) const
+{
+    // The actors of the zone may be up to the margin outside of it.
+    radius += zoneMargin;
+    Rectangle r;
+    r.x = (zone % mapWidth) * zoneDiam - radius;
+    r.y = (zone / mapWidth) * zoneDiam - radius;
+    r.w = zoneDiam + 2 * radius;
+    r.h = zoneDiam + 2 * radius;
+    return getRegion(r);
 }
 
-MapZone& MapContent::getZone(const Point &pos) const
+unsigned MapContent::getZoneIndex(const Point &pos) const
 {
-    return zones[(pos.x / zoneDiam) + (pos.y / zoneDiam) * mapWidth];
+    int x = std::min(pos.x / zoneDiam, mapWidth - 1),
+        y = std::min(pos.y / zoneDiam, mapHeight - 1);
+    return x + y * mapWidth;
+}
+
+bool MapContent::isNearZone(unsigned zone, const Point &pos) const
+{
+    int left = (zone % mapWidth) * zoneDiam - zoneMargin,
+        top = (zone / mapWidth) * zoneDiam - zoneMargin,
+        size = zoneDiam + 2 * zoneMargin;
+    return pos.x >= left && pos.x < left + size &&
+           pos.y >= top && pos.y < top + size;
 }
 
 
@@ -471,8 +535,13 @@ MapComposite::MapComposite(int id, const std::string &name):
     mContent(0),
     mName(name),
     mID(id),
-    mPvPRules(PVP_NONE)
+    mPvPRules(PVP_NONE),
+    mCharacterCount(0),
+    mLastOccupiedTick(0),
+    mHibernating(false)
 {
+    for (int level = 0; level < AI_LEVEL_COUNT; ++level)
+        mAiCounts[level] = 0;
 }
 
 MapComposite::~MapComposite()
@@ -525,53 +594,30 @@ bool MapComposite::activate()
 
 ZoneIterator MapComposite::getAroundPointIterator(const Point &p, int radius) const
 {
-    MapRegion r;
-    mContent->fillRegion(r, p, radius);
-    return ZoneIterator(r, mContent);
+    return ZoneIterator(mContent->getRegion(p, radius), mContent);
 }
 
 ZoneIterator MapComposite::getAroundActorIterator(Entity *obj, int radius) const
 {
-    MapRegion r;
-    mContent->fillRegion(r, obj->getComponent<ActorComponent>()->getPosition(),
-                         radius);
-    return ZoneIterator(r, mContent);
+    const Point &p = obj->getComponent<ActorComponent>()->getPosition();
+    return ZoneIterator(mContent->getRegion(p, radius), mContent);
 }
 
 ZoneIterator MapComposite::getInsideRectangleIterator(const Rectangle &p) const
 {
-    MapRegion r;
-    mContent->fillRegion(r, p);
-    return ZoneIterator(r, mContent);
+    return ZoneIterator(mContent->getRegion(p), mContent);
 }
 
 ZoneIterator MapComposite::getAroundBeingIterator(Entity *obj, int radius) const
 {
-    MapRegion r1;
-    mContent->fillRegion(r1,
-                         obj->getComponent<BeingComponent>()->getOldPosition(),
-                         radius);
-    MapRegion r2 = r1;
-    for (MapRegion::iterator i = r1.begin(), i_end = r1.end(); i != i_end; ++i)
-    {
-        /* Fills region with destinations taken around the old position.
-           This is necessary to detect two moving objects changing zones at the
-           same time and at the border, and going in opposite directions (or
-           more simply to detect teleportations, if any). */
-        MapRegion &r4 = mContent->zones[*i].destinations;
-        if (!r4.empty())
-        {
-            MapRegion r3;
-            r3.reserve(r2.size() + r4.size());
-            std::set_union(r2.begin(), r2.end(), r4.begin(), r4.end(),
-                           std::back_insert_iterator< MapRegion >(r3));
-            r2.swap(r3);
-        }
-    }
-    mContent->fillRegion(r2,
-                         obj->getComponent<ActorComponent>()->getPosition(),
-                         radius);
-    return ZoneIterator(r2, mContent);
+    /* The zones are brought up to date right after the beings moved, so the
+       region only needs to cover the being where it stands and where it is
+       about to step. */
+    const Point &pos = obj->getComponent<ActorComponent>()->getPosition();
+    MapRegion r = mContent->getRegion(pos, radius);
+    r.extend(mContent->getRegion(
+            obj->getComponent<BeingComponent>()->getNextStep(*obj), radius));
+    return ZoneIterator(r, mContent);
 }
 
 bool MapComposite::insert(Entity *ptr)
@@ -581,39 +627,81 @@ bool MapComposite::insert(Entity *ptr)
         if (ptr->canMove() && !mContent->allocate(ptr))
             return false;
 
-        const Point &point =
-                ptr->getComponent<ActorComponent>()->getPosition();
-        mContent->getZone(point).insert(ptr);
+        auto *actorComponent = ptr->getComponent<ActorComponent>();
+        unsigned zoneIndex =
+                mContent->getZoneIndex(actorComponent->getPosition());
+        actorComponent->setZone(zoneIndex);
+        MapZone &zone = mContent->zones[zoneIndex];
+        zone.insert(ptr);
+        zone.changed = true;
+
+        if (ptr->getType() == OBJECT_CHARACTER)
+            mContent->aiLevelsChanged = true;
     }
 
     ptr->setMap(this);
+    ptr->setMapSlot(mContent->entities.size());
     mContent->entities.push_back(ptr);
+
+    ptr->setSleeping(false);
+    startUpdating(ptr);
+
+    if (ptr->getType() == OBJECT_CHARACTER)
+    {
+        int party = ptr->getComponent<CharacterComponent>()->getParty();
+        mPartyMembers[party].push_back(ptr);
+
+        ++mCharacterCount;
+        if (mHibernating)
+            stopHibernating();
+    }
     return true;
 }
 
 void MapComposite::remove(Entity *ptr)
 {
-    for (std::vector<Entity*>::iterator i = mContent->entities.begin(),
-         i_end = mContent->entities.end(); i != i_end; ++i)
+    if (ptr->canFight())
+        ptr->getComponent<CombatComponent>()->clearTargetedBy();
+
+    // Move the last entity in place of the removed one.
+    std::vector< Entity * > &entities = mContent->entities;
+    unsigned slot = ptr->getMapSlot();
+    assert(slot < entities.size() && entities[slot] == ptr);
+    entities[slot] = entities.back();
+    entities[slot]->setMapSlot(slot);
+    entities.pop_back();
+
+    mContent->timers.cancel(ptr->getWakeUpTimer());
+    if (ptr->getUpdateSlot() != Entity::NO_UPDATE_SLOT)
+        stopUpdating(ptr);
+    if (ptr->isSleeping())
     {
-        if ((*i)->canFight())
-        {
-            if ((*i)->getComponent<CombatComponent>()->getTarget() == ptr)
-            {
-                (*i)->getComponent<CombatComponent>()->clearTarget();
-            }
-        }
-        if (*i == ptr)
-        {
-            i = mContent->entities.erase(i);
-        }
+        std::vector< Entity * > &fallingAsleep = mContent->fallingAsleep;
+        fallingAsleep.erase(std::remove(fallingAsleep.begin(),
+                                        fallingAsleep.end(), ptr),
+                            fallingAsleep.end());
+        ptr->setSleeping(false);
+    }
+
+    std::vector< Entity * > &changedAttributes = mContent->changedAttributes;
+    changedAttributes.erase(std::remove(changedAttributes.begin(),
+                                        changedAttributes.end(), ptr),
+                            changedAttributes.end());
+
+    if (ptr->getType() == OBJECT_CHARACTER)
+    {
+        int party = ptr->getComponent<CharacterComponent>()->getParty();
+        changeParty(ptr, party, -1);
+        --mCharacterCount;
     }
 
     if (ptr->isVisible())
     {
-        const Point &point =
-                ptr->getComponent<ActorComponent>()->getPosition();
-        mContent->getZone(point).remove(ptr);
+        unsigned zone = ptr->getComponent<ActorComponent>()->getZone();
+        mContent->zones[zone].remove(ptr);
+
+        if (ptr->getType() == OBJECT_CHARACTER)
+            mContent->aiLevelsChanged = true;
 
         if (ptr->canMove())
         {
@@ -622,15 +710,241 @@ void MapComposite::remove(Entity *ptr)
     }
 }
 
+bool MapComposite::contains(Entity *entity) const
+{
+    const std::vector< Entity * > &entities = mContent->entities;
+    unsigned slot = entity->getMapSlot();
+    return slot < entities.size() && entities[slot] == entity;
+}
+
+void MapComposite::startUpdating(Entity *entity)
+{
+    std::vector< Entity * > &updatedEntities = mContent->updatedEntities;
+    entity->setUpdateSlot(updatedEntities.size());
+    updatedEntities.push_back(entity);
+
+    for (int type = 0; type < ComponentTypeCount; ++type)
+    {
+        if (Component *component = entity->getComponent(ComponentType(type)))
+        {
+            component->setPoolHandle(
+                    mContent->componentPools[type].insert(component, entity));
+        }
+    }
+}
+
+void MapComposite::stopUpdating(Entity *entity)
+{
+    std::vector< Entity * > &updatedEntities = mContent->updatedEntities;
+    unsigned slot = entity->getUpdateSlot();
+    assert(slot < updatedEntities.size() && updatedEntities[slot] == entity);
+    updatedEntities[slot] = updatedEntities.back();
+    updatedEntities[slot]->setUpdateSlot(slot);
+    updatedEntities.pop_back();
+    entity->setUpdateSlot(Entity::NO_UPDATE_SLOT);
+
+    for (int type = 0; type < ComponentTypeCount; ++type)
+    {
+        if (Component *component = entity->getComponent(ComponentType(type)))
+        {
+            mContent->componentPools[type].remove(
+                    component->getPoolHandle());
+            component->setPoolHandle(ComponentHandle());
+        }
+    }
+}
+
+void MapComposite::sleep(Entity *entity, int ticks)
+{
+    assert(contains(entity));
+
+    TimerWheel::Timer &timer = entity->getWakeUpTimer();
+    if (ticks > 0)
+        mContent->timers.schedule(timer, GameState::getCurrentTick() + ticks);
+    else
+        mContent->timers.cancel(timer);
+
+    // Entities are only taken out of the update list once it has been
+    // walked through.
+    if (!entity->isSleeping())
+    {
+        entity->setSleeping(true);
+        mContent->fallingAsleep.push_back(entity);
+    }
+}
+
+void MapComposite::wakeUp(Entity *entity)
+{
+    mContent->timers.cancel(entity->getWakeUpTimer());
+    entity->setSleeping(false);
+
+    if (entity->getUpdateSlot() == Entity::NO_UPDATE_SLOT && contains(entity))
+        startUpdating(entity);
+}
+
+void MapComposite::attributesChanged(Entity *entity)
+{
+    if (mContent && contains(entity))
+        mContent->changedAttributes.push_back(entity);
+}
+
+void MapComposite::flushChangedAttributes()
+{
+    // Indices are used since the scripts may change the attributes of other
+    // beings on the way.
+    std::vector< Entity * > &changed = mContent->changedAttributes;
+    for (unsigned i = 0; i < changed.size(); ++i)
+    {
+        changed[i]->getComponent<BeingComponent>()
+                ->flushChangedAttributes(*changed[i]);
+    }
+    changed.clear();
+}
+
+bool MapComposite::needsUpdate(int tick)
+{
+    const Configuration::Settings &settings = Configuration::getSettings();
+
+    if (mCharacterCount > 0 || settings.hibernationRate <= 1)
+    {
+        mLastOccupiedTick = tick;
+        if (mHibernating)
+            stopHibernating();
+        return true;
+    }
+
+    if (tick - mLastOccupiedTick < settings.hibernationDelay)
+        return true;
+
+    if (!mHibernating)
+    {
+        LOG_DEBUG("Map " << mName << " starts hibernating.");
+        mHibernating = true;
+    }
+
+    // Spread the updates of the hibernating maps over the ticks
+    return (tick + mID) % settings.hibernationRate == 0;
+}
+
+void MapComposite::stopHibernating()
+{
+    LOG_DEBUG("Map " << mName << " stops hibernating.");
+    mHibernating = false;
+
+    // Spawn areas catch up with the spawns that were due since the last
+    // update now, rather than when their next spawn comes
+    for (std::vector< Entity * >::const_iterator it = mContent->entities.begin(),
+         it_end = mContent->entities.end(); it != it_end; ++it)
+    {
+        Entity *entity = *it;
+        if (entity->isSleeping() && entity->hasComponent<SpawnAreaComponent>())
+            wakeUp(entity);
+    }
+}
+
+AiLevel MapComposite::getAiLevel(unsigned zone) const
+{
+    return mContent->zones[zone].aiLevel;
+}
+
+/**
+ * Raises the level of detail of the AI in a region to the given level.
+ */
+static void raiseAiLevel(ZoneIterator it, AiLevel level)
+{
+    for (; it; ++it)
+        if ((*it)->aiLevel > level)
+            (*it)->aiLevel = level;
+}
+
+void MapComposite::updateAiLevels()
+{
+    const Configuration::Settings &settings = Configuration::getSettings();
+    if (!mContent->aiLevelsChanged &&
+        mContent->aiSleepRange == settings.aiSleepRange &&
+        mContent->aiVisualRange == settings.visualRange)
+        return;
+
+    mContent->aiLevelsChanged = false;
+    mContent->aiSleepRange = settings.aiSleepRange;
+    mContent->aiVisualRange = settings.visualRange;
+
+    const int zoneCount = mContent->mapWidth * mContent->mapHeight;
+    MapZone *zones = mContent->zones;
+
+    // Without level of detail, all the monsters are always active
+    const AiLevel defaultLevel =
+            settings.aiSleepRange > 0 ? AI_SLEEPING : AI_ACTIVE;
+    for (int i = 0; i < zoneCount; ++i)
+        zones[i].aiLevel = defaultLevel;
+
+    if (defaultLevel == AI_ACTIVE)
+        return;
+
+    // The levels only depend on the zones holding characters, so that they
+    // stay valid while the characters move inside their zones.
+    for (int i = 0; i < zoneCount; ++i)
+    {
+        if (!zones[i].nbCharacters)
+            continue;
+
+        raiseAiLevel(ZoneIterator(mContent->getRegion(
+                             i, settings.aiSleepRange), mContent),
+                     AI_REDUCED);
+        raiseAiLevel(ZoneIterator(mContent->getRegion(
+                             i, settings.visualRange), mContent),
+                     AI_ACTIVE);
+    }
+}
+
 void MapComposite::update()
 {
-    // Update object status
-    const std::vector< Entity * > &entities = getEverything();
-    for (std::vector< Entity * >::const_iterator it = entities.begin(),
-         it_end = entities.end(); it != it_end; ++it)
+    updateAiLevels();
+    for (int level = 0; level < AI_LEVEL_COUNT; ++level)
+        mAiCounts[level] = 0;
+
+    // Wake up the entities whose time has come
+    std::vector< Entity * > &wokenUp = mContent->wokenUp;
+    wokenUp.clear();
+    mContent->timers.advance(GameState::getCurrentTick(), wokenUp);
+    for (std::vector< Entity * >::iterator it = wokenUp.begin(),
+         it_end = wokenUp.end(); it != it_end; ++it)
+    {
+        wakeUp(*it);
+    }
+
+    // Update object status. Indices are used since entities woken up by
+    // others are added to the lists on the way.
+    if (Configuration::getSettings().batchComponentUpdates)
     {
-        (*it)->update();
+        // One kind of component after the other
+        for (int type = 0; type < ComponentTypeCount; ++type)
+        {
+            const std::vector< ComponentPool::Entry > &entries =
+                    mContent->componentPools[type].getEntries();
+            for (unsigned i = 0; i < entries.size(); ++i)
+                entries[i].component->update(*entries[i].entity);
+        }
+    }
+    else
+    {
+        const std::vector< Entity * > &entities = mContent->updatedEntities;
+        for (unsigned i = 0; i < entities.size(); ++i)
+            entities[i]->update();
+    }
+
+    // Stop updating the entities that went to sleep
+    for (std::vector< Entity * >::iterator it = mContent->fallingAsleep.begin(),
+         it_end = mContent->fallingAsleep.end(); it != it_end; ++it)
+    {
+        Entity *entity = *it;
+        if (entity->isSleeping() &&
+            entity->getUpdateSlot() != Entity::NO_UPDATE_SLOT)
+        {
+            stopUpdating(entity);
+        }
     }
+    mContent->fallingAsleep.clear();
 
     if (mUpdateCallback.isValid())
     {
@@ -646,11 +960,6 @@ void MapComposite::update()
         (*it)->getComponent<BeingComponent>()->move(**it);
     }
 
-    for (int i = 0; i < mContent->mapHeight * mContent->mapWidth; ++i)
-    {
-        mContent->zones[i].destinations.clear();
-    }
-
     // Cannot use a WholeMap iterator as objects will change zones under its feet.
     for (std::vector< Entity * >::iterator i = mContent->entities.begin(),
          i_end = mContent->entities.end(); i != i_end; ++i)
@@ -658,22 +967,82 @@ void MapComposite::update()
         if (!(*i)->canMove())
             continue;
 
+        auto *actorComponent = (*i)->getComponent<ActorComponent>();
         const Point &pos1 =
                 (*i)->getComponent<BeingComponent>()->getOldPosition();
-        const Point &pos2 =
-                (*i)->getComponent<ActorComponent>()->getPosition();
+        const Point &pos2 = actorComponent->getPosition();
 
-        MapZone &src = mContent->getZone(pos1),
-                &dst = mContent->getZone(pos2);
-        if (&src != &dst)
+        if (pos1 == pos2)
+            continue;
+
+        unsigned srcIndex = actorComponent->getZone();
+        if (mContent->isNearZone(srcIndex, pos2))
         {
-            addZone(src.destinations, &dst - mContent->zones);
-            src.remove(*i);
-            dst.insert(*i);
+            mContent->zones[srcIndex].changed = true;
+            continue;
         }
+
+        unsigned dstIndex = mContent->getZoneIndex(pos2);
+        MapZone &src = mContent->zones[srcIndex],
+                &dst = mContent->zones[dstIndex];
+        dst.changed = true;
+        src.remove(*i);
+        dst.insert(*i);
+        actorComponent->setZone(dstIndex);
+        ++mContent->zoneChanges;
+
+        if ((*i)->getType() == OBJECT_CHARACTER)
+            mContent->aiLevelsChanged = true;
     }
 }
 
+unsigned MapComposite::takeZoneChanges()
+{
+    const unsigned zoneChanges = mContent->zoneChanges;
+    mContent->zoneChanges = 0;
+    return zoneChanges;
+}
+
+void MapComposite::clearZoneChanges()
+{
+    for (int i = 0; i < mContent->mapHeight * mContent->mapWidth; ++i)
+    {
+        mContent->zones[i].changed = false;
+    }
+}
+
+const std::vector< Entity * > &MapComposite::getPartyMembers(int party) const
+{
+    static const std::vector< Entity * > noMembers;
+    std::map< int, std::vector< Entity * > >::const_iterator it =
+            mPartyMembers.find(party);
+    return it != mPartyMembers.end() ? it->second : noMembers;
+}
+
+void MapComposite::changeParty(Entity *character, int oldParty, int newParty)
+{
+    std::map< int, std::vector< Entity * > >::iterator it =
+            mPartyMembers.find(oldParty);
+    if (it == mPartyMembers.end())
+        return;
+
+    std::vector< Entity * > &members = it->second;
+    std::vector< Entity * >::iterator member =
+            std::find(members.begin(), members.end(), character);
+
+    // Characters that are not on the map yet are added on insertion.
+    if (member == members.end())
+        return;
+
+    members.erase(member);
+    if (members.empty())
+        mPartyMembers.erase(it);
+
+    // A negative party means that the character is leaving the map.
+    if (newParty >= 0)
+        mPartyMembers[newParty].push_back(character);
+}
+
 const std::vector< Entity * > &MapComposite::getEverything() const
 {
     return mContent->entities;
@@ -852,7 +1221,8 @@ void MapComposite::initializeContent()
             {
                 Entity *entity = new Entity(OBJECT_OTHER, this);
                 SpawnAreaComponent *spawnArea =
-                        new SpawnAreaComponent(monster, object->getBounds(),
+                        new SpawnAreaComponent(*entity, monster,
+                                               object->getBounds(),
                                                maxBeings, spawnRate);
 
                 entity->addComponent(spawnArea);
@@ -27,7 +27,9 @@
 #include <map>
 
 #include "scripting/script.h"
+#include "game-server/component.h"
 #include "game-server/map.h"
+#include "game-server/timerwheel.h"
 
 class CharacterComponent;
 class Entity;
@@ -47,17 +49,34 @@ enum PvPRules
 };
 
 /**
- * Ordered sets of zones of a map.
+ * Rectangle of zones of a map, given by the coordinates of its first and last
+ * zones. Being a plain value, it can be built and copied without allocating.
  */
-typedef std::vector< unsigned > MapRegion;
+struct MapRegion
+{
+    int left, top, right, bottom;
+
+    MapRegion(int l, int t, int r, int b):
+        left(l), top(t), right(r), bottom(b) {}
+
+    /**
+     * Extends the region so that it also contains the given zone.
+     */
+    void extend(int x, int y);
+
+    /**
+     * Extends the region so that it also contains another region.
+     */
+    void extend(const MapRegion &);
+};
 
 /**
  * Iterates through the zones of a region of the map.
  */
 struct ZoneIterator
 {
-    MapRegion region; /**< Zones to visit. Empty means the entire map. */
-    unsigned pos;
+    MapRegion region; /**< Zones to visit. */
+    int x, y;
     MapZone *current;
     const MapContent *map;
 
@@ -127,6 +146,19 @@ struct ActorIterator
     operator bool() const { return iterator; }
 };
 
+/**
+ * Level of detail of the AI of the monsters in a zone, depending on how far
+ * the closest character is.
+ */
+enum AiLevel
+{
+    AI_ACTIVE = 0,  // A character may see the monsters
+    AI_REDUCED,     // Characters are not far, think from time to time
+    AI_SLEEPING,    // No character around, do not think at all
+
+    AI_LEVEL_COUNT
+};
+
 /**
  * Part of a map.
  */
@@ -141,15 +173,79 @@ struct MapZone
     std::vector< Entity * > objects;
 
     /**
-     * Destinations of the objects that left this zone.
-     * This is necessary in order to have an accurate iterator around moving
-     * objects.
+     * Whether a being moved inside this zone or an actor was inserted in it
+     * since the characters were last informed. Actors can only come into
+     * view of a character that did not move from a zone that changed.
      */
-    MapRegion destinations;
+    bool changed;
 
-    MapZone(): nbCharacters(0), nbMovingObjects(0) {}
+    /**
+     * Level of detail of the AI of the monsters in this zone. It is computed
+     * again at the start of an update of the map when characters entered,
+     * left or changed zones.
+     */
+    AiLevel aiLevel;
+
+    MapZone():
+        nbCharacters(0), nbMovingObjects(0), changed(false),
+        aiLevel(AI_ACTIVE)
+    {}
     void insert(Entity *);
     void remove(Entity *);
+
+    private:
+        /**
+         * Stores an object at the given position and lets it know about it.
+         */
+        void place(Entity *, unsigned pos);
+};
+
+/**
+ * The components of one type of all the entities on a map. Updating them in
+ * a single pass avoids jumping from one kind of component to another for
+ * every entity.
+ *
+ * The entries are kept packed, so the last one moves into the place of a
+ * removed one. The components are referred to through handles to slots
+ * instead, which keep pointing at the entry wherever it moves.
+ */
+class ComponentPool
+{
+    public:
+        struct Entry
+        {
+            Component *component;
+            Entity *entity;
+            unsigned slot;          /**< Slot pointing at this entry. */
+        };
+
+        ComponentHandle insert(Component *, Entity *);
+        void remove(const ComponentHandle &);
+
+        /**
+         * Gets the component of a handle, or a null pointer when it was
+         * removed since.
+         */
+        Component *get(const ComponentHandle &handle) const
+        {
+            return handle.index < mSlots.size() &&
+                   mSlots[handle.index].generation == handle.generation ?
+                   mEntries[mSlots[handle.index].entry].component : 0;
+        }
+
+        const std::vector< Entry > &getEntries() const
+        { return mEntries; }
+
+    private:
+        struct Slot
+        {
+            unsigned entry;         /**< Position in mEntries. */
+            unsigned generation;    /**< Changes each time it is freed. */
+        };
+
+        std::vector< Entry > mEntries;
+        std::vector< Slot > mSlots;
+        std::vector< unsigned > mFreeSlots;
 };
 
 /**
@@ -189,19 +285,37 @@ struct MapContent
     void deallocate(Entity *);
 
     /**
-     * Fills a region of zones within the range of a point.
+     * Gets the region of zones within the range of a point.
      */
-    void fillRegion(MapRegion &, const Point &, int) const;
+    MapRegion getRegion(const Point &, int) const;
 
     /**
-     * Fills a region of zones inside a rectangle.
+     * Gets the region of zones inside a rectangle.
      */
-    void fillRegion(MapRegion &, const Rectangle &) const;
+    MapRegion getRegion(const Rectangle &) const;
 
     /**
-     * Gets zone at given position.
+     * Gets the region covering the whole map.
      */
-    MapZone &getZone(const Point &pos) const;
+    MapRegion getWholeRegion() const
+    { return MapRegion(0, 0, mapWidth - 1, mapHeight - 1); }
+
+    /**
+     * Gets the region of zones within the range of any actor stored in a
+     * zone.
+     */
+    MapRegion getRegion(unsigned zone, int radius) const;
+
+    /**
+     * Gets the index of the zone at given position.
+     */
+    unsigned getZoneIndex(const Point &pos) const;
+
+    /**
+     * Tells whether an actor at given position can stay in a zone, that is
+     * whether it is inside the zone extended by the margin.
+     */
+    bool isNearZone(unsigned zone, const Point &pos) const;
 
     /**
      * Entities (items, characters, monsters, etc) located on the map.
@@ -220,8 +334,53 @@ struct MapContent
      */
     MapZone *zones;
 
+    /**
+     * Entities that are not sleeping, and thus updated every tick.
+     */
+    std::vector< Entity * > updatedEntities;
+
+    /**
+     * Components of the updated entities, grouped by type.
+     */
+    ComponentPool componentPools[ComponentTypeCount];
+
+    /**
+     * Entities that went to sleep during the current update. They are only
+     * taken out of the updated entities afterwards.
+     */
+    std::vector< Entity * > fallingAsleep;
+
+    /**
+     * Beings whose attributes changed since they were last flushed. A being
+     * may be listed more than once.
+     */
+    std::vector< Entity * > changedAttributes;
+
+    /**
+     * Wakeups of the sleeping entities.
+     */
+    TimerWheel timers;
+
+    /**
+     * Entities woken up by their timer, reused from one update to the next.
+     */
+    std::vector< Entity * > wokenUp;
+
     unsigned short mapWidth;  /**< Width with respect to zones. */
     unsigned short mapHeight; /**< Height with respect to zones. */
+
+    int zoneDiam;             /**< Width and height of a zone in pixels. */
+    int zoneMargin;           /**< Overlap between neighbouring zones. */
+
+    unsigned zoneChanges;     /**< Zone changes since they were reported. */
+
+    /**
+     * Whether characters entered, left or changed zones since the AI levels
+     * were computed, and the ranges they were computed for.
+     */
+    bool aiLevelsChanged;
+    int aiSleepRange;
+    int aiVisualRange;
 };
 
 /**
@@ -279,10 +438,75 @@ class MapComposite
         void remove(Entity *);
 
         /**
-         * Updates zones of every moving beings.
+         * Updates the entities that are not sleeping, and zones of every
+         * moving beings.
          */
         void update();
 
+        /**
+         * Tells whether the map has to be updated during the given tick. A
+         * map that had no character for a while hibernates and is only
+         * updated every few ticks.
+         */
+        bool needsUpdate(int tick);
+
+        /**
+         * Stops updating an entity of the map until the given amount of
+         * \a ticks passed, or until it is woken up when \a ticks is not
+         * positive.
+         */
+        void sleep(Entity *, int ticks);
+
+        /**
+         * Makes the map update an entity again.
+         */
+        void wakeUp(Entity *);
+
+        /**
+         * Remembers that the attributes of a being of the map changed, so
+         * that their dependants are recalculated by flushChangedAttributes().
+         */
+        void attributesChanged(Entity *);
+
+        /**
+         * Recalculates the attributes depending on the ones changed on this
+         * map. Called at the end of its update, so that the values read
+         * while informing the characters and during the next tick are
+         * current.
+         */
+        void flushChangedAttributes();
+
+        /**
+         * Marks all the zones as unchanged. Called once the characters have
+         * been informed about the changes.
+         */
+        void clearZoneChanges();
+
+        /**
+         * Gets the amount of times an actor moved to another zone since the
+         * last call, and starts counting again.
+         */
+        unsigned takeZoneChanges();
+
+        /**
+         * Gets the level of detail of the AI of the monsters in a zone.
+         */
+        AiLevel getAiLevel(unsigned zone) const;
+
+        /**
+         * Counts a monster whose AI ran at the given level of detail during
+         * the current update.
+         */
+        void countAi(AiLevel level)
+        { ++mAiCounts[level]; }
+
+        /**
+         * Gets the amount of monsters whose AI ran at the given level of
+         * detail during the last update.
+         */
+        unsigned getAiCount(AiLevel level) const
+        { return mAiCounts[level]; }
+
         /**
          * Gets the PvP rules on the map.
          */
@@ -292,7 +516,7 @@ class MapComposite
          * Gets an iterator on the objects of the whole map.
          */
         ZoneIterator getWholeMapIterator() const
-        { return ZoneIterator(MapRegion(), mContent); }
+        { return ZoneIterator(mContent->getWholeRegion(), mContent); }
 
         /**
          * Gets an iterator on the objects inside a given rectangle.
@@ -310,8 +534,8 @@ class MapComposite
         ZoneIterator getAroundActorIterator(Entity *, int radius) const;
 
         /**
-         * Gets an iterator on the objects around the old and new positions of
-         * a character (including the ones that were but are now elsewhere).
+         * Gets an iterator on the objects around the position of a being and
+         * the next step of its path.
          */
         ZoneIterator getAroundBeingIterator(Entity *, int radius) const;
 
@@ -320,6 +544,16 @@ class MapComposite
          */
         const std::vector< Entity * > &getEverything() const;
 
+        /**
+         * Gets the characters of a party that are on the map.
+         */
+        const std::vector< Entity * > &getPartyMembers(int party) const;
+
+        /**
+         * Moves a character of the map from a party to another.
+         */
+        void changeParty(Entity *character, int oldParty, int newParty);
+
         /**
          * Gets the cached value of a map-bound script variable
          */
@@ -367,6 +601,26 @@ class MapComposite
         MapComposite(const MapComposite &);
 
         void initializeContent();
+
+        /**
+         * Tells whether an entity is inserted on this map.
+         */
+        bool contains(Entity *) const;
+
+        void startUpdating(Entity *);
+        void stopUpdating(Entity *);
+
+        /**
+         * Computes the level of detail of the AI of every zone from the
+         * positions of the characters.
+         */
+        void updateAiLevels();
+
+        /**
+         * Makes the map update again on every tick, called when a character
+         * enters a hibernating map.
+         */
+        void stopHibernating();
         void callMapVariableCallback(const std::string &key,
                                      const std::string &value);
 
@@ -378,6 +632,14 @@ class MapComposite
         /** Cached persistent variables */
         std::map<std::string, std::string> mScriptVariables;
         PvPRules mPvPRules;
+        unsigned mAiCounts[AI_LEVEL_COUNT];
+
+        unsigned mCharacterCount;   /**< Characters on the map. */
+        int mLastOccupiedTick;      /**< Last tick with characters. */
+        bool mHibernating;
+
+        /** Characters on the map, indexed by party id. */
+        std::map< int, std::vector< Entity * > > mPartyMembers;
         std::map<const std::string, Script::Ref> mMapVariableCallbacks;
         std::map<const std::string, Script::Ref> mWorldVariableCallbacks;
 
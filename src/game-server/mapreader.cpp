@@ -144,6 +144,8 @@ Map *MapReader::readMap(xmlNodePtr node)
     // Clean up tilesets
     ::tilesetFirstGids.clear();
 
+    map->buildClusterGraph();
+
     return map;
 }
 
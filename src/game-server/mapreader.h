@@ -41,12 +41,12 @@ class MapReader
          */
         static Map *readMap(const std::string &filename);
 
-    private:
         /**
          * Read an XML map from a parsed XML tree.
          */
         static Map *readMap(xmlNodePtr node);
 
+    private:
         /**
          * Reads a map layer and adds it to the given map.
          */
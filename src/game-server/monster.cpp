@@ -55,7 +55,9 @@ double MonsterClass::getVulnerability(Element element) const
 
 MonsterComponent::MonsterComponent(Entity &entity, MonsterClass *specy):
     mSpecy(specy),
-    mOwner(nullptr)
+    mOwner(nullptr),
+    mAiPhase(rand()),
+    mHadTarget(false)
 {
     LOG_DEBUG("Monster spawned! (id: " << mSpecy->getId() << ").");
 
@@ -96,8 +98,10 @@ MonsterComponent::MonsterComponent(Entity &entity, MonsterClass *specy):
 
     beingComponent->setGender(specy->getGender());
 
-    beingComponent->signal_died.connect(sigc::mem_fun(this,
-                                            &MonsterComponent::monsterDied));
+    mDiedListener.connect<MonsterComponent, &MonsterComponent::monsterDied>(
+            beingComponent->signal_died, this);
+    mObservedListener.connect<MonsterComponent, &MonsterComponent::observed>(
+            entity.getComponent<BeingComponent>()->signal_observed, this);
 
     // Set positions relative to target from which the monster can attack
     int dist = specy->getAttackDistance();
@@ -114,8 +118,9 @@ MonsterComponent::MonsterComponent(Entity &entity, MonsterClass *specy):
                 (100.0 + (rand() % (mutation * 2)) - mutation) / 100.0 : 1.0;
     combatComponent->setDamageMutation(damageMutation);
 
-    combatComponent->signal_damaged.connect(
-            sigc::mem_fun(this, &MonsterComponent::receivedDamage));
+    mDamagedListener.connect<MonsterComponent,
+                             &MonsterComponent::receivedDamage>(
+            combatComponent->signal_damaged, this);
 }
 
 MonsterComponent::~MonsterComponent()
@@ -138,6 +143,7 @@ void MonsterComponent::update(Entity &entity)
         return;
     }
 
+    // The scripts of the species keep running whatever the level of detail
     if (mSpecy->getUpdateCallback().isValid())
     {
         Script *script = ScriptManager::currentState();
@@ -146,6 +152,25 @@ void MonsterComponent::update(Entity &entity)
         script->execute(entity.getMap());
     }
 
+    // Target and stroll less, or not at all, when no character is close
+    MapComposite *map = entity.getMap();
+    const AiLevel aiLevel =
+            map->getAiLevel(entity.getComponent<ActorComponent>()->getZone());
+    map->countAi(aiLevel);
+
+    if (aiLevel == AI_SLEEPING)
+    {
+        entity.getComponent<CombatComponent>()->clearTarget();
+        return;
+    }
+
+    if (aiLevel == AI_REDUCED)
+    {
+        const unsigned rate = Configuration::getSettings().aiReducedRate;
+        if ((GameState::getCurrentTick() + mAiPhase) % rate != 0)
+            return;
+    }
+
     refreshTarget(entity);
 
     // Cancel the rest when we have a target
@@ -184,7 +209,89 @@ void MonsterComponent::refreshTarget(Entity &entity)
     if (beingComponent->getAction() == DEAD)
         return;
 
-    // Check potential attack positions
+    auto *combatComponent = entity.getComponent<CombatComponent>();
+    Entity *target = combatComponent->getTarget();
+
+    // Look for another target as soon as the current one died or left
+    if (target &&
+        target->getComponent<BeingComponent>()->getAction() == DEAD)
+    {
+        combatComponent->clearTarget();
+        target = nullptr;
+    }
+    if (!target && mHadTarget)
+        requestRescan();
+
+    if (mRescanTimeout.expired())
+    {
+        mRescanTimeout.set(Configuration::getSettings().aiRescanInterval);
+        rescan(entity);
+    }
+    else if (target)
+    {
+        // Only aim again when the target moved or we reached our position
+        const Point &ownPosition =
+                entity.getComponent<ActorComponent>()->getPosition();
+        const Point &targetPosition =
+                target->getComponent<ActorComponent>()->getPosition();
+        const bool arrived = beingComponent->getAction() != ATTACK &&
+                ownPosition == beingComponent->getDestination();
+
+        if (targetPosition != mTargetPosition || arrived)
+        {
+            Point attackPosition;
+            const int priority = getTargetPriority(target);
+            if (priority && findAttackPosition(entity, target, priority,
+                                               attackPosition))
+                attack(entity, target, attackPosition);
+            else
+                combatComponent->clearTarget();
+        }
+    }
+
+    mHadTarget = combatComponent->getTarget();
+}
+
+int MonsterComponent::getTargetPriority(Entity *target) const
+{
+    // Determine how much we hate the target
+    std::map<Entity *, AggressionInfo>::const_iterator angerIterator =
+            mAnger.find(target);
+    if (angerIterator != mAnger.end())
+        return angerIterator->second.anger;
+
+    return mSpecy->isAggressive() ? 1 : 0;
+}
+
+int MonsterComponent::findAttackPosition(Entity &entity, Entity *target,
+                                         int targetPriority,
+                                         Point &attackPosition)
+{
+    int bestPriority = 0;
+
+    // Check all attack positions
+    for (std::list<AttackPosition>::iterator j = mAttackPositions.begin();
+         j != mAttackPositions.end(); j++)
+    {
+        Point position = target->getComponent<ActorComponent>()->getPosition();
+        position.x += j->x;
+        position.y += j->y;
+
+        int posPriority = calculatePositionPriority(entity,
+                                                    position,
+                                                    targetPriority);
+        if (posPriority > bestPriority)
+        {
+            bestPriority = posPriority;
+            attackPosition = position;
+        }
+    }
+
+    return bestPriority;
+}
+
+void MonsterComponent::rescan(Entity &entity)
+{
     int bestTargetPriority = 0;
     Entity *bestTarget = 0;
     Point bestAttackPosition;
@@ -192,78 +299,59 @@ void MonsterComponent::refreshTarget(Entity &entity)
     // reset Target. We will find a new one if possible
     entity.getComponent<CombatComponent>()->clearTarget();
 
-    // Iterate through objects nearby
-    int aroundArea = Configuration::getValue("game_visualRange", 448);
-    for (BeingIterator i(entity.getMap()->getAroundBeingIterator(&entity,
-                                                                 aroundArea));
+    // Iterate through the characters nearby, we only want to attack them
+    int aroundArea = Configuration::getSettings().visualRange;
+    MapComposite *map = entity.getMap();
+    for (CharacterIterator i(map->getAroundBeingIterator(&entity, aroundArea));
          i; ++i)
     {
-        // We only want to attack player characters
-        if ((*i)->getType() != OBJECT_CHARACTER)
-            continue;
-
         Entity *target = *i;
 
         // Dead characters are ignored
-        if (beingComponent->getAction() == DEAD)
+        if (target->getComponent<BeingComponent>()->getAction() == DEAD)
             continue;
 
-        // Determine how much we hate the target
-        int targetPriority = 0;
-        std::map<Entity *, AggressionInfo>::iterator angerIterator =
-                mAnger.find(target);
-        if (angerIterator != mAnger.end())
-        {
-            const AggressionInfo &aggressionInfo = angerIterator->second;
-            targetPriority = aggressionInfo.anger;
-        }
-        else if (mSpecy->isAggressive())
-        {
-            targetPriority = 1;
-        }
-        else
-        {
+        int targetPriority = getTargetPriority(target);
+        if (!targetPriority)
             continue;
-        }
 
-        // Check all attack positions
-        for (std::list<AttackPosition>::iterator j = mAttackPositions.begin();
-             j != mAttackPositions.end(); j++)
+        Point attackPosition;
+        int posPriority = findAttackPosition(entity, target, targetPriority,
+                                             attackPosition);
+        if (posPriority > bestTargetPriority)
         {
-            Point attackPosition =
-                    target->getComponent<ActorComponent>()->getPosition();
-            attackPosition.x += j->x;
-            attackPosition.y += j->y;
-
-            int posPriority = calculatePositionPriority(entity,
-                                                        attackPosition,
-                                                        targetPriority);
-            if (posPriority > bestTargetPriority)
-            {
-                bestTargetPriority = posPriority;
-                bestTarget = target;
-                bestAttackPosition = attackPosition;
-            }
+            bestTargetPriority = posPriority;
+            bestTarget = target;
+            bestAttackPosition = attackPosition;
         }
     }
+
     if (bestTarget)
-    {
-        const Point &ownPosition =
-                entity.getComponent<ActorComponent>()->getPosition();
-        const Point &targetPosition =
-                bestTarget->getComponent<ActorComponent>()->getPosition();
+        attack(entity, bestTarget, bestAttackPosition);
+}
 
-        entity.getComponent<CombatComponent>()->setTarget(bestTarget);
-        if (bestAttackPosition == ownPosition)
-        {
-            beingComponent->setAction(entity, ATTACK);
-            beingComponent->updateDirection(entity, ownPosition,
-                                            targetPosition);
-        }
-        else
-        {
-            beingComponent->setDestination(entity, bestAttackPosition);
-        }
+void MonsterComponent::attack(Entity &entity, Entity *target,
+                              const Point &attackPosition)
+{
+    auto *beingComponent = entity.getComponent<BeingComponent>();
+    const Point &ownPosition =
+            entity.getComponent<ActorComponent>()->getPosition();
+    const Point &targetPosition =
+            target->getComponent<ActorComponent>()->getPosition();
+
+    mTargetPosition = targetPosition;
+
+    entity.getComponent<CombatComponent>()->setTarget(target);
+    if (attackPosition == ownPosition)
+    {
+        beingComponent->setAction(entity, ATTACK);
+        beingComponent->updateDirection(entity, ownPosition,
+                                        targetPosition);
+    }
+    else
+    {
+        beingComponent->setDestination(entity, attackPosition,
+                                       targetPosition);
     }
 }
 
@@ -304,11 +392,7 @@ int MonsterComponent::calculatePositionPriority(Entity &entity,
 
 void MonsterComponent::forgetTarget(Entity *entity)
 {
-    {
-        AggressionInfo &aggressionInfo = mAnger[entity];
-        aggressionInfo.removedConnection.disconnect();
-        aggressionInfo.diedConnection.disconnect();
-    }
+    // Erasing the aggression info disconnects its listeners
     mAnger.erase(entity);
 
     if (entity->getType() == OBJECT_CHARACTER)
@@ -335,11 +419,13 @@ void MonsterComponent::changeAnger(Entity *target, int amount)
 
         // Forget target either when it's removed or died, whichever
         // happens first.
-        aggressionInfo.removedConnection =
-                target->signal_removed.connect(sigc::mem_fun(this, &MonsterComponent::forgetTarget));
-        aggressionInfo.diedConnection = target->getComponent<BeingComponent>()
-                ->signal_died.connect(
-                        sigc::mem_fun(this, &MonsterComponent::forgetTarget));
+        aggressionInfo.removedListener.connect<
+                MonsterComponent, &MonsterComponent::forgetTarget>(
+                        target->signal_removed, this);
+        aggressionInfo.diedListener.connect<
+                MonsterComponent, &MonsterComponent::forgetTarget>(
+                        target->getComponent<BeingComponent>()->signal_died,
+                        this);
     }
 }
 
@@ -416,7 +502,10 @@ void MonsterComponent::monsterDied(Entity *monster)
 void MonsterComponent::receivedDamage(Entity *source, const Damage &damage, int hpLoss)
 {
     if (source)
+    {
         changeAnger(source, hpLoss);
+        requestRescan();
+    }
 
     if (hpLoss && source && source->getType() == OBJECT_CHARACTER)
     {
@@ -431,3 +520,8 @@ void MonsterComponent::receivedDamage(Entity *source, const Damage &damage, int
         }
     }
 }
+
+void MonsterComponent::observed(Entity *)
+{
+    requestRescan();
+}
@@ -24,6 +24,7 @@
 #include "game-server/being.h"
 #include "common/defines.h"
 #include "scripting/script.h"
+#include "utils/event.h"
 #include "utils/string.h"
 
 #include <map>
@@ -31,8 +32,6 @@
 #include <string>
 #include <vector>
 
-#include <sigc++/connection.h>
-
 class CharacterComponent;
 class ItemClass;
 class Script;
@@ -294,8 +293,19 @@ class MonsterComponent : public Component
          */
         void update(Entity &entity);
 
+        /**
+         * Keeps chasing the current target, and looks for the best target
+         * around when a rescan is due.
+         */
         void refreshTarget(Entity &entity);
 
+        /**
+         * Makes the monster look for the best target around on its next
+         * update rather than waiting for the rescan interval.
+         */
+        void requestRescan()
+        { mRescanTimeout.set(0); }
+
         /**
          * Signal handler
          */
@@ -303,6 +313,11 @@ class MonsterComponent : public Component
 
         void receivedDamage(Entity *attacker, const Damage &damage, int hpLoss);
 
+        /**
+         * Looks around again when a character comes within the visual range.
+         */
+        void observed(Entity *character);
+
         /**
          * Alters hate for the monster
          */
@@ -322,6 +337,32 @@ class MonsterComponent : public Component
                                       Point position,
                                       int targetPriority);
 
+        /**
+         * Gets how much the monster wants to attack the given character, or
+         * 0 when it does not want to.
+         */
+        int getTargetPriority(Entity *target) const;
+
+        /**
+         * Finds the best position from which to attack the given target.
+         *
+         * @return the priority of that position, or 0 when none is reachable
+         */
+        int findAttackPosition(Entity &entity, Entity *target,
+                               int targetPriority, Point &attackPosition);
+
+        /**
+         * Looks through the characters around for the best target.
+         */
+        void rescan(Entity &entity);
+
+        /**
+         * Sets the target and walks to the attack position, or attacks when
+         * already there.
+         */
+        void attack(Entity &entity, Entity *target,
+                    const Point &attackPosition);
+
         MonsterClass *mSpecy;
 
         /** Aggression towards other beings. */
@@ -331,8 +372,8 @@ class MonsterComponent : public Component
             {}
 
             int anger;
-            sigc::connection removedConnection;
-            sigc::connection diedConnection;
+            utils::EventListener<Entity *> removedListener;
+            utils::EventListener<Entity *> diedListener;
         };
         std::map<Entity *, AggressionInfo> mAnger;
 
@@ -361,6 +402,22 @@ class MonsterComponent : public Component
         Timeout mKillStealProtectedTimeout;
         /** Time until dead monster is removed */
         Timeout mDecayTimeout;
+
+        /** Time until the monster looks around for a better target */
+        Timeout mRescanTimeout;
+
+        /** Offset of the ticks at which the AI runs at reduced rate. */
+        unsigned mAiPhase;
+
+        /** Whether the monster had a target after its last update. */
+        bool mHadTarget;
+
+        /** Position of the target when the attack position was chosen. */
+        Point mTargetPosition;
+
+        utils::EventListener<Entity *> mDiedListener;
+        utils::EventListener<Entity *, const Damage &, int> mDamagedListener;
+        utils::EventListener<Entity *> mObservedListener;
 };
 
 #endif // MONSTER_H
@@ -0,0 +1,242 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/pathqueue.h"
+
+#include "common/configuration.h"
+#include "game-server/being.h"
+#include "game-server/flowfield.h"
+#include "game-server/state.h"
+#include "utils/workerpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+
+typedef std::chrono::steady_clock Clock;
+
+struct QueuedSearch
+{
+    Entity *entity;
+    PathRequest request;
+    Path path;
+    bool done;
+};
+
+struct IsSearchOf
+{
+    IsSearchOf(Entity *entity): entity(entity) {}
+
+    bool operator()(const QueuedSearch &search) const
+    { return search.entity == entity; }
+
+    Entity *entity;
+};
+
+/**
+ * Searches of the beings of a map, which have to run on the same thread.
+ */
+struct MapSearches
+{
+    Map *map;
+    std::vector<unsigned> searches;     /**< Indices in tickSearches. */
+};
+
+static std::deque<QueuedSearch> characterSearches;
+static std::deque<QueuedSearch> otherSearches;
+
+/** Queued searches taken up at the start of the tick, in turns. */
+static std::vector<QueuedSearch> tickSearches;
+
+static std::vector<MapSearches> mapSearches;
+
+/** Time after which the queued searches of the tick are not started. */
+static Clock::time_point deadline;
+
+/**
+ * Time spent searching paths during the tick, in clock periods. The maps
+ * updated by several threads add to it at the same time.
+ */
+static std::atomic<Clock::rep> searchTime(0);
+
+/** Character searches done right away once the time was used up. */
+static std::atomic<int> synchronousSearches(0);
+
+Path PathRequest::search() const
+{
+    if (followsFlowField && Configuration::getSettings().flowFields)
+    {
+        FlowField *flowField = map->getFlowField(flowTarget.x, flowTarget.y);
+        if (flowField)
+        {
+            Path path = flowField->findPath(start, dest, walkmask);
+            if (!path.empty())
+                return path;
+        }
+    }
+
+    return map->findLongPath(start.x, start.y, dest.x, dest.y, walkmask,
+                             maxCost);
+}
+
+bool PathQueue::searchNow(Entity &entity)
+{
+    const Configuration::Settings &settings = Configuration::getSettings();
+    if (settings.pathSearchTime <= 0 ||
+            Clock::duration(searchTime) <
+            std::chrono::microseconds(settings.pathSearchTime))
+        return true;
+
+    if (entity.getType() == OBJECT_CHARACTER &&
+            synchronousSearches++ < settings.syncPathSearches)
+        return true;
+
+    return false;
+}
+
+Path PathQueue::search(const PathRequest &request)
+{
+    if (Configuration::getSettings().pathSearchTime <= 0)
+        return request.search();
+
+    const Clock::time_point start = Clock::now();
+    Path path = request.search();
+    searchTime += (Clock::now() - start).count();
+    return path;
+}
+
+void PathQueue::queue(Entity &entity, const PathRequest &request)
+{
+    if (GameState::SideEffects *sideEffects = GameState::getSideEffects())
+    {
+        sideEffects->push_back([&entity, request] { queue(entity, request); });
+        return;
+    }
+
+    QueuedSearch search;
+    search.entity = &entity;
+    search.request = request;
+    search.done = false;
+
+    if (entity.getType() == OBJECT_CHARACTER)
+        characterSearches.push_back(search);
+    else
+        otherSearches.push_back(search);
+}
+
+void PathQueue::cancel(Entity &entity)
+{
+    if (GameState::SideEffects *sideEffects = GameState::getSideEffects())
+    {
+        sideEffects->push_back([&entity] { cancel(entity); });
+        return;
+    }
+
+    const IsSearchOf isSearchOf(&entity);
+
+    characterSearches.erase(std::remove_if(characterSearches.begin(),
+                                           characterSearches.end(),
+                                           isSearchOf),
+                            characterSearches.end());
+    otherSearches.erase(std::remove_if(otherSearches.begin(),
+                                       otherSearches.end(),
+                                       isSearchOf),
+                        otherSearches.end());
+}
+
+void PathQueue::runSearches(utils::WorkerPool &workerPool)
+{
+    searchTime = 0;
+    synchronousSearches = 0;
+
+    if (characterSearches.empty() && otherSearches.empty())
+        return;
+
+    tickSearches.clear();
+    bool charactersTurn = true;
+    while (!characterSearches.empty() || !otherSearches.empty())
+    {
+        std::deque<QueuedSearch> &queue =
+                (charactersTurn && !characterSearches.empty()) ||
+                otherSearches.empty() ? characterSearches : otherSearches;
+        tickSearches.push_back(queue.front());
+        queue.pop_front();
+        charactersTurn = !charactersTurn;
+    }
+
+    // Keep the searches of each map in order on a single thread
+    mapSearches.clear();
+    for (unsigned i = 0; i < tickSearches.size(); ++i)
+    {
+        Map *map = tickSearches[i].request.map;
+
+        std::vector<MapSearches>::iterator it = mapSearches.begin();
+        while (it != mapSearches.end() && it->map != map)
+            ++it;
+
+        if (it == mapSearches.end())
+        {
+            MapSearches searches;
+            searches.map = map;
+            it = mapSearches.insert(it, searches);
+        }
+        it->searches.push_back(i);
+    }
+
+    // Searches left when the configuration stopped limiting the time are
+    // all run.
+    const int timeLimit = Configuration::getSettings().pathSearchTime;
+    const Clock::time_point start = Clock::now();
+    deadline = timeLimit > 0 ? start + std::chrono::microseconds(timeLimit)
+                             : Clock::time_point::max();
+
+    workerPool.run(mapSearches.size(), [](unsigned index) {
+        const std::vector<unsigned> &searches = mapSearches[index].searches;
+        for (unsigned i = 0; i < searches.size() && Clock::now() < deadline;
+             ++i)
+        {
+            QueuedSearch &search = tickSearches[searches[i]];
+            search.path = search.request.search();
+            search.done = true;
+        }
+    });
+
+    searchTime = (Clock::now() - start).count();
+
+    // Hand out the paths, and queue the other searches again in order
+    for (std::vector<QueuedSearch>::iterator it = tickSearches.begin(),
+         it_end = tickSearches.end(); it != it_end; ++it)
+    {
+        if (it->done)
+        {
+            BeingComponent *being = it->entity->getComponent<BeingComponent>();
+            being->pathFound(*it->entity, it->request.start, it->path);
+        }
+        else if (it->entity->getType() == OBJECT_CHARACTER)
+        {
+            characterSearches.push_back(*it);
+        }
+        else
+        {
+            otherSearches.push_back(*it);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHQUEUE_H
+#define PATHQUEUE_H
+
+#include "game-server/map.h"
+
+class Entity;
+
+namespace utils
+{
+class WorkerPool;
+}
+
+/**
+ * Everything needed to search the path of a being, so that the search does
+ * not have to look at the being itself.
+ */
+struct PathRequest
+{
+    Map *map;
+    Point start;                /**< Tile the being stands on. */
+    Point dest;                 /**< Tile the being heads to. */
+    unsigned char walkmask;
+    int maxCost;                /**< Longest path, in tiles, 0: no limit. */
+    bool followsFlowField;
+    Point flowTarget;           /**< Tile the flow field leads to. */
+
+    Path search() const;
+};
+
+/**
+ * Limits the time spent searching paths in a tick.
+ *
+ * Beings search their path right away while the searches of the tick took
+ * less than game_pathSearchTime. Once that time is used up, they queue their
+ * search instead and stand still until it is done. The queued searches are
+ * run at the start of the next tick, before the maps are updated, and the
+ * beings get their path in time to walk during that tick.
+ *
+ * The time is checked before each search, so a single long search can still
+ * go over it. Characters and the other beings take turns in the queue, so
+ * that a crowd of monsters cannot hold back player walks.
+ */
+namespace PathQueue
+{
+    /**
+     * Tells whether the path of a being should be searched right away
+     * rather than queued. This is always the case when the time is not
+     * limited, or when the searches of the tick did not use it up yet.
+     * Otherwise, up to game_syncPathSearches character walks are still
+     * searched right away each tick, so that players rarely wait.
+     */
+    bool searchNow(Entity &entity);
+
+    /**
+     * Searches a path right away, counting the time it takes.
+     */
+    Path search(const PathRequest &request);
+
+    /**
+     * Queues the path search of a being. The being is given the result
+     * through BeingComponent::pathFound().
+     */
+    void queue(Entity &entity, const PathRequest &request);
+
+    /**
+     * Forgets the queued search of a being.
+     */
+    void cancel(Entity &entity);
+
+    /**
+     * Starts counting the search time of a new tick, and runs the queued
+     * searches until that time is used up. The searches of different maps
+     * run on the update threads. The searches only read the maps, so this
+     * must not run while they change.
+     */
+    void runSearches(utils::WorkerPool &workerPool);
+}
+
+#endif // PATHQUEUE_H
@@ -22,6 +22,7 @@
 
 #include "game-server/accountconnection.h"
 #include "game-server/character.h"
+#include "utils/event.h"
 #include "utils/logger.h"
 
 #include <cassert>
@@ -37,7 +38,7 @@ typedef std::map< std::string, QuestCallbacks > PendingVariables;
 struct PendingQuest
 {
     Entity *character;
-    sigc::connection removedConnection;
+    utils::EventListener<Entity *> removedListener;
     sigc::connection disconnectedConnection;
     PendingVariables variables;
 };
@@ -112,7 +113,7 @@ static void fullRemove(Entity &ch)
 
     {
         PendingQuest &pendingQuest = pendingQuests[id];
-        pendingQuest.removedConnection.disconnect();
+        pendingQuest.removedListener.disconnect();
         pendingQuest.disconnectedConnection.disconnect();
     }
 
@@ -132,20 +133,19 @@ void recoverQuestVar(Entity *ch, const std::string &name,
     PendingQuests::iterator i = pendingQuests.lower_bound(id);
     if (i == pendingQuests.end() || i->first != id)
     {
-        PendingQuest pendingQuest;
+        i = pendingQuests.insert(i, std::make_pair(id, PendingQuest()));
+        PendingQuest &pendingQuest = i->second;
         pendingQuest.character = ch;
 
         /* Connect to removed and disconnected signals, because we cannot
          * afford to get invalid pointers, when we finally recover the
          * variable.
          */
-        pendingQuest.removedConnection =
-                ch->signal_removed.connect(sigc::ptr_fun(partialRemove));
+        pendingQuest.removedListener.connect<&partialRemove>(
+                ch->signal_removed);
         pendingQuest.disconnectedConnection =
                 characterComponent->signal_disconnected.connect(
                         sigc::ptr_fun(fullRemove));
-
-        i = pendingQuests.insert(i, std::make_pair(id, pendingQuest));
     }
     i->second.variables[name].push_back(f);
     accountHandler->requestCharacterVar(ch, name);
@@ -160,7 +160,7 @@ void recoveredQuestVar(int id,
         return;
 
     PendingQuest &pendingQuest = i->second;
-    pendingQuest.removedConnection.disconnect();
+    pendingQuest.removedListener.disconnect();
     pendingQuest.disconnectedConnection.disconnect();
 
     PendingVariables &variables = pendingQuest.variables;
@@ -25,100 +25,144 @@
 #include "game-server/state.h"
 #include "utils/logger.h"
 
-SpawnAreaComponent::SpawnAreaComponent(MonsterClass *specy,
+#include <algorithm>
+
+SpawnAreaComponent::SpawnAreaComponent(Entity &entity,
+                                       MonsterClass *specy,
                                        const Rectangle &zone,
                                        int maxBeings,
                                        int spawnRate):
+    mEntity(&entity),
     mSpecy(specy),
     mZone(zone),
     mMaxBeings(maxBeings),
     mSpawnRate(spawnRate),
     mNumBeings(0),
-    mNextSpawn(0)
+    mBeingListeners(std::max(maxBeings, 0))
 {
+    mNextSpawn.set(0);
 }
 
 void SpawnAreaComponent::update(Entity &entity)
 {
-    if (mNextSpawn > 0)
-        mNextSpawn--;
+    MapComposite *map = entity.getMap();
 
-    if (mNextSpawn == 0 && mNumBeings < mMaxBeings && mSpawnRate > 0)
+    if (mNumBeings < mMaxBeings && mSpawnRate > 0 && mNextSpawn.expired())
     {
-        MapComposite *map = entity.getMap();
-        const Map *realMap = map->getMap();
+        // Predictable respawn intervals (can be randomized later)
+        const int interval = std::max(1, (10 * 60) / mSpawnRate);
 
-        // Reset the spawn area to the whole map in case of dimensionless zone
-        if (mZone.w == 0 || mZone.h == 0)
-        {
-            mZone.x = 0;
-            mZone.y = 0;
-            mZone.w = realMap->getWidth() * realMap->getTileWidth();
-            mZone.h = realMap->getHeight() * realMap->getTileHeight();
-        }
+        // A hibernating map is not updated on every tick, so the spawns that
+        // were due since the last update are caught up now.
+        const int late = -mNextSpawn.remaining();
+        int count = std::min(1 + late / interval, mMaxBeings - mNumBeings);
+        for (; count > 0; --count)
+            spawn(map);
+
+        mNextSpawn.set(interval - late % interval);
+    }
+
+    // Sleep until the next spawn, or until a being is removed when the area
+    // is full.
+    if (mNumBeings >= mMaxBeings || mSpawnRate <= 0)
+        entity.sleep();
+    else
+        entity.sleep(std::max(1, mNextSpawn.remaining()));
+}
+
+void SpawnAreaComponent::spawn(MapComposite *map)
+{
+    const Map *realMap = map->getMap();
+
+    // Reset the spawn area to the whole map in case of dimensionless zone
+    if (mZone.w == 0 || mZone.h == 0)
+    {
+        mZone.x = 0;
+        mZone.y = 0;
+        mZone.w = realMap->getWidth() * realMap->getTileWidth();
+        mZone.h = realMap->getHeight() * realMap->getTileHeight();
+    }
+
+    // Find a free spawn location. Give up after 10 tries
+    Point position;
+    const int x = mZone.x;
+    const int y = mZone.y;
+    const int width = mZone.w;
+    const int height = mZone.h;
+
+    Entity *being = new Entity(OBJECT_MONSTER);
+    auto *actorComponent = new ActorComponent(*being);
+    being->addComponent(actorComponent);
+    auto *beingComponent = new BeingComponent(*being);
+    being->addComponent(beingComponent);
+    being->addComponent(new MonsterComponent(*being, mSpecy));
+
+    if (beingComponent->getModifiedAttribute(ATTR_MAX_HP) <= 0)
+    {
+        LOG_WARN("Refusing to spawn dead monster " << mSpecy->getId());
+        delete being;
+        being = 0;
+    }
 
-        // Find a free spawn location. Give up after 10 tries
-        Point position;
-        const int x = mZone.x;
-        const int y = mZone.y;
-        const int width = mZone.w;
-        const int height = mZone.h;
-
-        Entity *being = new Entity(OBJECT_MONSTER);
-        auto *actorComponent = new ActorComponent(*being);
-        being->addComponent(actorComponent);
-        auto *beingComponent = new BeingComponent(*being);
-        being->addComponent(beingComponent);
-        being->addComponent(new MonsterComponent(*being, mSpecy));
-
-        if (beingComponent->getModifiedAttribute(ATTR_MAX_HP) <= 0)
+    if (being)
+    {
+        int triesLeft = 10;
+        do
         {
-            LOG_WARN("Refusing to spawn dead monster " << mSpecy->getId());
-            delete being;
-            being = 0;
+            position = Point(x + rand() % width, y + rand() % height);
+            triesLeft--;
         }
+        while (!realMap->getWalk(position.x / realMap->getTileWidth(),
+                                 position.y / realMap->getTileHeight(),
+                                 actorComponent->getWalkMask())
+               && triesLeft);
 
-        if (being)
+        if (triesLeft)
         {
-            int triesLeft = 10;
-            do
+            for (auto &listener : mBeingListeners)
             {
-                position = Point(x + rand() % width, y + rand() % height);
-                triesLeft--;
+                if (!listener.isConnected())
+                {
+                    listener.connect<SpawnAreaComponent,
+                                     &SpawnAreaComponent::decrease>(
+                            being->signal_removed, this);
+                    break;
+                }
             }
-            while (!realMap->getWalk(position.x / realMap->getTileWidth(),
-                                     position.y / realMap->getTileHeight(),
-                                     actorComponent->getWalkMask())
-                   && triesLeft);
 
-            if (triesLeft)
-            {
-                being->signal_removed.connect(
-                            sigc::mem_fun(this, &SpawnAreaComponent::decrease));
+            being->setMap(map);
+            actorComponent->setPosition(*being, position);
+            beingComponent->clearDestination(*being);
+            GameState::enqueueInsert(being);
 
-                being->setMap(map);
-                actorComponent->setPosition(*being, position);
-                beingComponent->clearDestination(*being);
-                GameState::enqueueInsert(being);
-
-                mNumBeings++;
-            }
-            else
-            {
-                LOG_WARN("Unable to find a free spawn location for monster "
-                         << mSpecy->getId() << " on map " << map->getName()
-                         << " (" << x << ',' << y << ','
-                         << width << ',' << height << ')');
-                delete being;
-            }
+            mNumBeings++;
+        }
+        else
+        {
+            LOG_WARN("Unable to find a free spawn location for monster "
+                     << mSpecy->getId() << " on map " << map->getName()
+                     << " (" << x << ',' << y << ','
+                     << width << ',' << height << ')');
+            delete being;
         }
-
-        // Predictable respawn intervals (can be randomized later)
-        mNextSpawn = (10 * 60) / mSpawnRate;
     }
 }
 
-void SpawnAreaComponent::decrease(Entity *)
+void SpawnAreaComponent::decrease(Entity *being)
 {
+    for (auto &listener : mBeingListeners)
+    {
+        if (listener.isConnectedTo(being->signal_removed))
+        {
+            // Frees the listener for the next spawned being
+            listener.disconnect();
+            break;
+        }
+    }
+    // A full area did not keep its spawn schedule, respawn right away
+    if (mNumBeings == mMaxBeings)
+        mNextSpawn.set(0);
+
     --mNumBeings;
+    mEntity->wakeUp();
 }
@@ -23,9 +23,14 @@
 #define SPAWNAREACOMPONENT_H
 
 #include "game-server/component.h"
+#include "game-server/timeout.h"
 
+#include "utils/event.h"
 #include "utils/point.h"
 
+#include <vector>
+
+class MapComposite;
 class MonsterClass;
 
 /**
@@ -37,7 +42,8 @@ class SpawnAreaComponent : public Component
     public:
         static const ComponentType type = CT_SpawnArea;
 
-        SpawnAreaComponent(MonsterClass *,
+        SpawnAreaComponent(Entity &entity,
+                           MonsterClass *,
                            const Rectangle &zone,
                            int maxBeings, int spawnRate);
 
@@ -49,12 +55,21 @@ class SpawnAreaComponent : public Component
         void decrease(Entity *);
 
     private:
+        /**
+         * Spawns a being at a random place of the area.
+         */
+        void spawn(MapComposite *map);
+
+        Entity *mEntity;      /**< Woken up when a being is removed. */
         MonsterClass *mSpecy; /**< Specy of monster that spawns in this area. */
         Rectangle mZone;
         int mMaxBeings;    /**< Maximum population of this area. */
         int mSpawnRate;    /**< Number of beings spawning per minute. */
         int mNumBeings;    /**< Current population of this area. */
-        int mNextSpawn;    /**< The time until next being spawn. */
+        Timeout mNextSpawn; /**< The time until next being spawn. */
+
+        /** One listener per possible being, notified of its removal. */
+        std::vector< utils::EventListener<Entity *> > mBeingListeners;
 
         friend struct SpawnAreaEventDispatch;
 };
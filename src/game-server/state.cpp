@@ -33,14 +33,19 @@
 #include "game-server/mapmanager.h"
 #include "game-server/monster.h"
 #include "game-server/npc.h"
+#include "game-server/pathqueue.h"
+#include "game-server/statusmanager.h"
 #include "game-server/trade.h"
 #include "net/messageout.h"
 #include "scripting/script.h"
 #include "scripting/scriptmanager.h"
 #include "utils/logger.h"
 #include "utils/speedconv.h"
+#include "utils/workerpool.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 
 enum
 {
@@ -61,6 +66,130 @@ struct DelayedEvent
 
 typedef std::map< Entity *, DelayedEvent > DelayedEvents;
 
+/**
+ * Messages generated while informing some characters of a map. They are kept
+ * aside so that several groups of characters can be handled at the same time,
+ * and are sent in a fixed order once all of them are done.
+ */
+class Outbox
+{
+    public:
+        /**
+         * Queues a message for the given character. The contents of \a msg
+         * are taken over by the outbox.
+         */
+        void queue(Entity *character, MessageOut &msg)
+        { mMessages.push_back(std::make_pair(character, std::move(msg))); }
+
+        /**
+         * Remembers that an effect has been shown to a character, so that it
+         * can be marked as such when the outbox is flushed.
+         */
+        void effectShown(EffectComponent *effect)
+        { mShownEffects.push_back(effect); }
+
+        /**
+         * Remembers that an actor came into view of a character or left it.
+         * The visible sets are only updated when the outbox is flushed, since
+         * the observers of an actor are shared between several characters.
+         */
+        void visibilityChanged(Entity *character, Entity *actor, bool visible)
+        {
+            VisibilityChange change = { character, actor, visible };
+            mVisibilityChanges.push_back(change);
+        }
+
+        /**
+         * Sends the queued messages in the order they were queued.
+         */
+        void flush();
+
+    private:
+        struct VisibilityChange
+        {
+            Entity *character;
+            Entity *actor;
+            bool visible;
+        };
+
+        typedef std::vector< std::pair< Entity *, MessageOut > > Messages;
+        Messages mMessages;
+        std::vector< EffectComponent * > mShownEffects;
+        std::vector< VisibilityChange > mVisibilityChanges;
+};
+
+/**
+ * Adds an actor to the ones known by the client of a character, or removes it.
+ */
+static void setVisible(Entity *character, Entity *actor, bool visible)
+{
+    auto *characterComponent = character->getComponent<CharacterComponent>();
+    auto *actorComponent = actor->getComponent<ActorComponent>();
+    if (visible)
+    {
+        characterComponent->addVisibleActor(actor);
+        actorComponent->addObserver(character);
+        if (auto *beingComponent = actor->getComponent<BeingComponent>())
+            beingComponent->signal_observed.emit(character);
+    }
+    else
+    {
+        characterComponent->removeVisibleActor(actor);
+        actorComponent->removeObserver(character);
+    }
+}
+
+void Outbox::flush()
+{
+    for (Messages::iterator it = mMessages.begin(), it_end = mMessages.end();
+         it != it_end; ++it)
+    {
+        gameHandler->sendTo(it->first, it->second);
+    }
+    mMessages.clear();
+
+    for (std::vector< EffectComponent * >::iterator it = mShownEffects.begin(),
+         it_end = mShownEffects.end(); it != it_end; ++it)
+    {
+        (*it)->setShown();
+    }
+    mShownEffects.clear();
+
+    for (std::vector< VisibilityChange >::iterator
+         it = mVisibilityChanges.begin(), it_end = mVisibilityChanges.end();
+         it != it_end; ++it)
+    {
+        setVisible(it->character, it->actor, it->visible);
+    }
+    mVisibilityChanges.clear();
+}
+
+/**
+ * A contiguous range of the characters of a map that are informed together.
+ */
+struct InformJob
+{
+    MapComposite *map;
+    unsigned first;     /**< First character of the range. */
+    unsigned last;      /**< One past the last character of the range. */
+};
+
+/**
+ * Time spent updating the world, reported regularly so that the amount of
+ * update threads can be tuned.
+ */
+struct UpdateStatistics
+{
+    UpdateStatistics(): ticks(0), totalTime(0), maxTime(0) {}
+
+    int ticks;
+    double totalTime;   /**< Milliseconds spent in the last ticks. */
+    double maxTime;     /**< Longest tick in milliseconds. */
+};
+
+/** Amount of ticks between two reports of the update statistics. */
+static int const STATISTICS_INTERVAL = 300;
+
 /**
  * The current world time in ticks since server start.
  */
@@ -76,6 +205,20 @@ static DelayedEvents delayedEvents;
  */
 static std::map< std::string, std::string > mScriptVariables;
 
+/**
+ * Threads used for informing the characters of the active maps, and for
+ * updating the maps themselves with game_parallelMapUpdates.
+ */
+static utils::WorkerPool workerPool;
+
+/**
+ * Side effects of the map being updated by the current thread, when the maps
+ * are updated by several threads.
+ */
+static thread_local GameState::SideEffects *currentSideEffects = nullptr;
+
+static UpdateStatistics updateStatistics;
+
 /**
  * Sets message fields describing character look.
  */
@@ -125,145 +268,359 @@ static void serializeLooks(Entity *ch, MessageOut &msg)
     }
 }
 
+/**
+ * Adds the movement of a being to a GPMSG_BEINGS_MOVE message.
+ */
+static void serializeMove(Entity *o, MessageOut &moveMsg)
+{
+    const Point &oold = o->getComponent<BeingComponent>()->getOldPosition();
+    const Point &opos = o->getComponent<ActorComponent>()->getPosition();
+    int flags = 0;
+
+    if (opos != oold)
+    {
+        // Add position check coords every 5 seconds.
+        if (currentTick % 50 == 0)
+            flags |= MOVING_POSITION;
+
+        flags |= MOVING_DESTINATION;
+    }
+
+    moveMsg.writeInt16(o->getComponent<ActorComponent>()->getPublicID());
+    moveMsg.writeInt8(flags);
+    if (flags & MOVING_POSITION)
+    {
+        moveMsg.writeInt16(oold.x);
+        moveMsg.writeInt16(oold.y);
+    }
+
+    if (flags & MOVING_DESTINATION)
+    {
+        moveMsg.writeInt16(opos.x);
+        moveMsg.writeInt16(opos.y);
+        // We multiply the sent speed (in tiles per second) by ten
+        // to get it within a byte with decimal precision.
+        // For instance, a value of 4.5 will be sent as 45.
+        moveMsg.writeInt8((unsigned short)
+            (o->getComponent<BeingComponent>()
+                    ->getModifiedAttribute(ATTR_MOVE_SPEED_TPS) * 10));
+    }
+}
+
+/**
+ * Serializes the changes of a being that happened during this tick. The
+ * result is appended to the messages sent to every character seeing it.
+ */
+static void serializeUpdates(Entity *o)
+{
+    auto *actorComponent = o->getComponent<ActorComponent>();
+    auto *beingComponent = o->getComponent<BeingComponent>();
+    int oid = actorComponent->getPublicID();
+    int oflags = actorComponent->getUpdateFlags();
+
+    if (oflags & UPDATEFLAG_ATTACK)
+    {
+        MessageOut &attack = beingComponent->getUpdateFragment(FRAGMENT_ATTACK);
+        attack.clear();
+        attack.writeInt16(oid);
+        attack.writeInt8(beingComponent->getDirection());
+        attack.writeInt8(o->getComponent<CombatComponent>()->getAttackId());
+    }
+
+    if (oflags & UPDATEFLAG_ACTIONCHANGE)
+    {
+        MessageOut &action = beingComponent->getUpdateFragment(FRAGMENT_ACTION);
+        action.clear();
+        action.writeInt16(oid);
+        action.writeInt8(beingComponent->getAction());
+    }
+
+    // The looks are also needed when the character comes into view, so they
+    // are kept until they change again.
+    if ((oflags & (UPDATEFLAG_LOOKSCHANGE | UPDATEFLAG_NEW_ON_MAP)) &&
+        o->getType() == OBJECT_CHARACTER)
+    {
+        MessageOut &looks = beingComponent->getUpdateFragment(FRAGMENT_LOOKS);
+        looks.clear();
+        serializeLooks(o, looks);
+    }
+
+    if (oflags & UPDATEFLAG_EMOTE)
+    {
+        MessageOut &emote = beingComponent->getUpdateFragment(FRAGMENT_EMOTE);
+        emote.clear();
+        int emoteId = beingComponent->getLastEmote();
+        if (emoteId > -1)
+        {
+            emote.writeInt16(oid);
+            emote.writeInt16(emoteId);
+        }
+    }
+
+    if (oflags & UPDATEFLAG_DIRCHANGE)
+    {
+        MessageOut &direction =
+                beingComponent->getUpdateFragment(FRAGMENT_DIRECTION);
+        direction.clear();
+        direction.writeInt16(oid);
+        direction.writeInt8(beingComponent->getDirection());
+    }
+
+    if (beingComponent->getOldPosition() != actorComponent->getPosition())
+    {
+        MessageOut &move = beingComponent->getUpdateFragment(FRAGMENT_MOVE);
+        move.clear();
+        serializeMove(o, move);
+    }
+
+    MessageOut &damage = beingComponent->getUpdateFragment(FRAGMENT_DAMAGE);
+    damage.clear();
+    if (o->canFight())
+    {
+        const Hits &hits = o->getComponent<CombatComponent>()->getHitsTaken();
+        for (Hits::const_iterator j = hits.begin(),
+             j_end = hits.end(); j != j_end; ++j)
+        {
+            damage.writeInt16(oid);
+            damage.writeInt16(*j);
+        }
+    }
+}
+
+/**
+ * Gets the position of an actor when the characters were last informed.
+ * Actors only move in BeingComponent::move, or by being inserted again.
+ */
+static const Point &getInformedPosition(Entity *o)
+{
+    if (o->canMove())
+        return o->getComponent<BeingComponent>()->getOldPosition();
+    return o->getComponent<ActorComponent>()->getPosition();
+}
+
 /**
  * Informs a player of what happened around the character.
+ *
+ * The actors known by the client are kept in the visible set of the
+ * character, so only those need to be checked for changes and for leaving
+ * the visual range. New actors can only come into view from the zones that
+ * changed, unless the character moved itself.
  */
-static void informPlayer(MapComposite *map, Entity *p)
+static void informPlayer(MapComposite *map, Entity *p, Outbox &outbox)
 {
     MessageOut moveMsg(GPMSG_BEINGS_MOVE);
     MessageOut damageMsg(GPMSG_BEINGS_DAMAGE);
+    MessageOut itemMsg(GPMSG_ITEMS);
     const Point &pold = p->getComponent<BeingComponent>()->getOldPosition();
     const Point &ppos = p->getComponent<ActorComponent>()->getPosition();
     int pid = p->getComponent<ActorComponent>()->getPublicID();
     int pflags = p->getComponent<ActorComponent>()->getUpdateFlags();
-    int visualRange = Configuration::getValue("game_visualRange", 448);
+    int visualRange = Configuration::getSettings().visualRange;
+    const std::set<Entity *> &visible =
+            p->getComponent<CharacterComponent>()->getVisibleActors();
+
+    // Actors can only come into view or leave it when they or the character
+    // moved since the last time
+    const bool pmoved = pold != ppos || (pflags & UPDATEFLAG_NEW_ON_MAP);
 
-    // Inform client about activities of other beings near its character
-    for (BeingIterator it(map->getAroundBeingIterator(p, visualRange));
-         it; ++it)
+    // Inform client about activities of the actors it knows about
+    for (std::set<Entity *>::const_iterator it = visible.begin(),
+         it_end = visible.end(); it != it_end; ++it)
     {
         Entity *o = *it;
 
-        const Point &oold =
-                o->getComponent<BeingComponent>()->getOldPosition();
         const Point &opos = o->getComponent<ActorComponent>()->getPosition();
-        int otype = o->getType();
+        bool inRange = (!pmoved && getInformedPosition(o) == opos) ||
+                       ppos.inRangeOf(opos, visualRange);
+
+        if (!o->canMove())
+        {
+            if (!inRange)
+            {
+                // Tell the client to forget about items out of sight.
+                if (o->getType() == OBJECT_ITEM)
+                {
+                    itemMsg.writeInt16(0);
+                    itemMsg.writeInt16(opos.x);
+                    itemMsg.writeInt16(opos.y);
+                }
+                outbox.visibilityChanged(p, o, false);
+            }
+            continue;
+        }
+
         int oid = o->getComponent<ActorComponent>()->getPublicID();
+
+        if (!inRange)
+        {
+            // o is no longer visible from p. Send leave message.
+            MessageOut leaveMsg(GPMSG_BEING_LEAVE);
+            leaveMsg.writeInt16(oid);
+            outbox.queue(p, leaveMsg);
+            outbox.visibilityChanged(p, o, false);
+            continue;
+        }
+
+        const BeingComponent *beingComponent =
+                o->getComponent<BeingComponent>();
         int oflags = o->getComponent<ActorComponent>()->getUpdateFlags();
-        int flags = 0;
 
-        // Check if the character p and the moving object o are around.
-        bool wereInRange = pold.inRangeOf(oold, visualRange) &&
-                           !((pflags | oflags) & UPDATEFLAG_NEW_ON_MAP);
-        bool willBeInRange = ppos.inRangeOf(opos, visualRange);
+        // Send attack messages.
+        if ((oflags & UPDATEFLAG_ATTACK) && oid != pid)
+        {
+            MessageOut AttackMsg(GPMSG_BEING_ATTACK);
+            AttackMsg.append(
+                    beingComponent->getUpdateFragment(FRAGMENT_ATTACK));
+            outbox.queue(p, AttackMsg);
+        }
 
-        if (!wereInRange && !willBeInRange)
+        // Send action change messages.
+        if ((oflags & UPDATEFLAG_ACTIONCHANGE))
         {
-            // Nothing to report: o and p are far away from each other.
-            continue;
+            MessageOut ActionMsg(GPMSG_BEING_ACTION_CHANGE);
+            ActionMsg.append(
+                    beingComponent->getUpdateFragment(FRAGMENT_ACTION));
+            outbox.queue(p, ActionMsg);
         }
 
+        // Send looks change messages.
+        if (oflags & UPDATEFLAG_LOOKSCHANGE)
+        {
+            MessageOut LooksMsg(GPMSG_BEING_LOOKS_CHANGE);
+            LooksMsg.writeInt16(oid);
+            LooksMsg.append(
+                    beingComponent->getUpdateFragment(FRAGMENT_LOOKS));
+            auto *characterComponent =
+                    o->getComponent<CharacterComponent>();
+            LooksMsg.writeInt16(characterComponent->getHairStyle());
+            LooksMsg.writeInt16(characterComponent->getHairColor());
+            LooksMsg.writeInt16(beingComponent->getGender());
+            outbox.queue(p, LooksMsg);
+        }
 
-        if (wereInRange && willBeInRange)
+        // Send emote messages.
+        if (oflags & UPDATEFLAG_EMOTE)
         {
-            // Send attack messages.
-            if ((oflags & UPDATEFLAG_ATTACK) && oid != pid)
+            const MessageOut &emote =
+                    beingComponent->getUpdateFragment(FRAGMENT_EMOTE);
+            if (emote.getLength() > 0)
             {
-                MessageOut AttackMsg(GPMSG_BEING_ATTACK);
-                AttackMsg.writeInt16(oid);
-                AttackMsg.writeInt8(
-                        o->getComponent<BeingComponent>()->getDirection());
-                CombatComponent *combatComponent =
-                        o->getComponent<CombatComponent>();
-                AttackMsg.writeInt8(combatComponent->getAttackId());
-                gameHandler->sendTo(p, AttackMsg);
+                MessageOut EmoteMsg(GPMSG_BEING_EMOTE);
+                EmoteMsg.append(emote);
+                outbox.queue(p, EmoteMsg);
             }
+        }
 
-            // Send action change messages.
-            if ((oflags & UPDATEFLAG_ACTIONCHANGE))
-            {
-                MessageOut ActionMsg(GPMSG_BEING_ACTION_CHANGE);
-                ActionMsg.writeInt16(oid);
-                ActionMsg.writeInt8(
-                        o->getComponent<BeingComponent>()->getAction());
-                gameHandler->sendTo(p, ActionMsg);
-            }
+        // Send direction change messages.
+        if (oflags & UPDATEFLAG_DIRCHANGE)
+        {
+            MessageOut DirMsg(GPMSG_BEING_DIR_CHANGE);
+            DirMsg.append(
+                    beingComponent->getUpdateFragment(FRAGMENT_DIRECTION));
+            outbox.queue(p, DirMsg);
+        }
 
-            // Send looks change messages.
-            if (oflags & UPDATEFLAG_LOOKSCHANGE)
-            {
-                MessageOut LooksMsg(GPMSG_BEING_LOOKS_CHANGE);
-                LooksMsg.writeInt16(oid);
-                serializeLooks(o, LooksMsg);
-                auto *characterComponent =
-                        o->getComponent<CharacterComponent>();
-                LooksMsg.writeInt16(characterComponent->getHairStyle());
-                LooksMsg.writeInt16(characterComponent->getHairColor());
-                LooksMsg.writeInt16(
-                        o->getComponent<BeingComponent>()->getGender());
-                gameHandler->sendTo(p, LooksMsg);
-            }
+        // Send damage messages.
+        damageMsg.append(beingComponent->getUpdateFragment(FRAGMENT_DAMAGE));
+
+        // Send move messages.
+        if (beingComponent->getOldPosition() != opos)
+            moveMsg.append(beingComponent->getUpdateFragment(FRAGMENT_MOVE));
+    }
+
+    // Look for actors that came into view. The ones that were already in
+    // range last time are known to the client, the others are looked up.
+    for (ZoneIterator z(map->getAroundPointIterator(ppos, visualRange));
+         z; ++z)
+    {
+        const MapZone *zone = *z;
+        if (!pmoved && !zone->changed)
+            continue;
+
+        for (std::vector< Entity * >::const_iterator
+             it = zone->objects.begin(), it_end = zone->objects.end();
+             it != it_end; ++it)
+        {
+            Entity *o = *it;
 
-            // Send emote messages.
-            if (oflags & UPDATEFLAG_EMOTE)
+            const Point &opos =
+                    o->getComponent<ActorComponent>()->getPosition();
+            if (!ppos.inRangeOf(opos, visualRange))
+                continue;
+
+            int oflags = o->getComponent<ActorComponent>()->getUpdateFlags();
+            if (!(pflags & UPDATEFLAG_NEW_ON_MAP) &&
+                !(oflags & UPDATEFLAG_NEW_ON_MAP) &&
+                pold.inRangeOf(getInformedPosition(o), visualRange))
+                continue;
+
+            if (visible.count(o))
+                continue;
+
+            outbox.visibilityChanged(p, o, true);
+
+            int otype = o->getType();
+
+            switch (otype)
             {
-                int emoteId =
-                        o->getComponent<BeingComponent>()->getLastEmote();
-                if (emoteId > -1)
+                case OBJECT_ITEM:
                 {
-                    MessageOut EmoteMsg(GPMSG_BEING_EMOTE);
-                    EmoteMsg.writeInt16(oid);
-                    EmoteMsg.writeInt16(emoteId);
-                    gameHandler->sendTo(p, EmoteMsg);
-                }
-            }
+                    ItemComponent *item = o->getComponent<ItemComponent>();
+                    ItemClass *itemClass = item->getItemClass();
 
-            // Send direction change messages.
-            if (oflags & UPDATEFLAG_DIRCHANGE)
-            {
-                MessageOut DirMsg(GPMSG_BEING_DIR_CHANGE);
-                DirMsg.writeInt16(oid);
-                DirMsg.writeInt8(
-                        o->getComponent<BeingComponent>()->getDirection());
-                gameHandler->sendTo(p, DirMsg);
-            }
+                    if (oflags & UPDATEFLAG_NEW_ON_MAP)
+                    {
+                        /* Send a specific message to the client when an item appears
+                           out of nowhere, so that a sound/animation can be performed. */
+                        MessageOut appearMsg(GPMSG_ITEM_APPEAR);
+                        appearMsg.writeInt16(itemClass->getDatabaseID());
+                        appearMsg.writeInt16(opos.x);
+                        appearMsg.writeInt16(opos.y);
+                        outbox.queue(p, appearMsg);
+                    }
+                    else
+                    {
+                        itemMsg.writeInt16(itemClass->getDatabaseID());
+                        itemMsg.writeInt16(opos.x);
+                        itemMsg.writeInt16(opos.y);
+                    }
+                    continue;
+                }
 
-            // Send damage messages.
-            if (o->canFight())
-            {
-                CombatComponent *combatComponent =
-                        o->getComponent<CombatComponent>();
-                const Hits &hits = combatComponent->getHitsTaken();
-                for (Hits::const_iterator j = hits.begin(),
-                     j_end = hits.end(); j != j_end; ++j)
+                case OBJECT_EFFECT:
                 {
-                    damageMsg.writeInt16(oid);
-                    damageMsg.writeInt16(*j);
+                    EffectComponent *e = o->getComponent<EffectComponent>();
+                    outbox.effectShown(e);
+                    // Don't show old effects
+                    if (!(oflags & UPDATEFLAG_NEW_ON_MAP))
+                        continue;
+
+                    if (Entity *b = e->getBeing())
+                    {
+                        auto *actorComponent =
+                                b->getComponent<ActorComponent>();
+                        MessageOut effectMsg(GPMSG_CREATE_EFFECT_BEING);
+                        effectMsg.writeInt16(e->getEffectId());
+                        effectMsg.writeInt16(actorComponent->getPublicID());
+                        outbox.queue(p, effectMsg);
+                    } else {
+                        MessageOut effectMsg(GPMSG_CREATE_EFFECT_POS);
+                        effectMsg.writeInt16(e->getEffectId());
+                        effectMsg.writeInt16(opos.x);
+                        effectMsg.writeInt16(opos.y);
+                        outbox.queue(p, effectMsg);
+                    }
+                    continue;
                 }
-            }
 
-            if (oold == opos)
-            {
-                // o does not move, nothing more to report.
-                continue;
+                default:
+                    break;
             }
-        }
 
-        if (!willBeInRange)
-        {
-            // o is no longer visible from p. Send leave message.
-            MessageOut leaveMsg(GPMSG_BEING_LEAVE);
-            leaveMsg.writeInt16(oid);
-            gameHandler->sendTo(p, leaveMsg);
-            continue;
-        }
-
-        if (!wereInRange)
-        {
             // o is now visible by p. Send enter message.
             MessageOut enterMsg(GPMSG_BEING_ENTER);
             enterMsg.writeInt8(otype);
-            enterMsg.writeInt16(oid);
+            enterMsg.writeInt16(o->getComponent<ActorComponent>()->getPublicID());
             enterMsg.writeInt8(o->getComponent<BeingComponent>()->getAction());
             enterMsg.writeInt16(opos.x);
             enterMsg.writeInt16(opos.y);
@@ -280,7 +637,8 @@ static void informPlayer(MapComposite *map, Entity *p)
                             o->getComponent<BeingComponent>()->getName());
                     enterMsg.writeInt8(characterComponent->getHairStyle());
                     enterMsg.writeInt8(characterComponent->getHairColor());
-                    serializeLooks(o, enterMsg);
+                    enterMsg.append(o->getComponent<BeingComponent>()
+                                    ->getUpdateFragment(FRAGMENT_LOOKS));
                 } break;
 
                 case OBJECT_MONSTER:
@@ -305,63 +663,41 @@ static void informPlayer(MapComposite *map, Entity *p)
                     assert(false); // TODO
                     break;
             }
-            gameHandler->sendTo(p, enterMsg);
-        }
+            outbox.queue(p, enterMsg);
 
-        if (opos != oold)
-        {
-            // Add position check coords every 5 seconds.
-            if (currentTick % 50 == 0)
-                flags |= MOVING_POSITION;
-
-            flags |= MOVING_DESTINATION;
-        }
-
-        // Send move messages.
-        moveMsg.writeInt16(oid);
-        moveMsg.writeInt8(flags);
-        if (flags & MOVING_POSITION)
-        {
-            moveMsg.writeInt16(oold.x);
-            moveMsg.writeInt16(oold.y);
-        }
-
-        if (flags & MOVING_DESTINATION)
-        {
-            moveMsg.writeInt16(opos.x);
-            moveMsg.writeInt16(opos.y);
-            // We multiply the sent speed (in tiles per second) by ten
-            // to get it within a byte with decimal precision.
-            // For instance, a value of 4.5 will be sent as 45.
-            moveMsg.writeInt8((unsigned short)
-                (o->getComponent<BeingComponent>()
-                        ->getModifiedAttribute(ATTR_MOVE_SPEED_TPS) * 10));
+            if (o->getComponent<BeingComponent>()->getOldPosition() != opos)
+            {
+                moveMsg.append(o->getComponent<BeingComponent>()
+                               ->getUpdateFragment(FRAGMENT_MOVE));
+            }
+            else
+            {
+                serializeMove(o, moveMsg);
+            }
         }
     }
 
     // Do not send a packet if nothing happened in p's range.
     if (moveMsg.getLength() > 2)
-        gameHandler->sendTo(p, moveMsg);
+        outbox.queue(p, moveMsg);
 
     if (damageMsg.getLength() > 2)
-        gameHandler->sendTo(p, damageMsg);
-
-    // Inform client about status change.
-    p->getComponent<CharacterComponent>()->sendStatus(*p);
+        outbox.queue(p, damageMsg);
 
     // Inform client about health change of party members
-    for (CharacterIterator i(map->getWholeMapIterator()); i; ++i)
+    if (int party = p->getComponent<CharacterComponent>()->getParty())
     {
-        Entity *c = *i;
+        const std::vector< Entity * > &partyMembers =
+                map->getPartyMembers(party);
+        for (std::vector< Entity * >::const_iterator i = partyMembers.begin(),
+             i_end = partyMembers.end(); i != i_end; ++i)
+        {
+            Entity *c = *i;
 
-        // Make sure its not the same character
-        if (c == p)
-            continue;
+            // Make sure its not the same character
+            if (c == p)
+                continue;
 
-        // make sure they are in the same party
-        if (c->getComponent<CharacterComponent>()->getParty() ==
-                p->getComponent<CharacterComponent>()->getParty())
-        {
             int cflags = c->getComponent<ActorComponent>()->getUpdateFlags();
             if (cflags & UPDATEFLAG_HEALTHCHANGE)
             {
@@ -374,87 +710,14 @@ static void informPlayer(MapComposite *map, Entity *p)
                         beingComponent->getModifiedAttribute(ATTR_HP));
                 healthMsg.writeInt16(
                         beingComponent->getModifiedAttribute(ATTR_MAX_HP));
-                gameHandler->sendTo(p, healthMsg);
+                outbox.queue(p, healthMsg);
             }
         }
     }
 
-    // Inform client about items on the ground around its character
-    MessageOut itemMsg(GPMSG_ITEMS);
-    for (FixedActorIterator it(map->getAroundBeingIterator(p, visualRange));
-         it; ++it)
-    {
-        Entity *o = *it;
-
-        assert(o->getType() == OBJECT_ITEM ||
-               o->getType() == OBJECT_EFFECT);
-
-        Point opos = o->getComponent<ActorComponent>()->getPosition();
-        int oflags = o->getComponent<ActorComponent>()->getUpdateFlags();
-        bool willBeInRange = ppos.inRangeOf(opos, visualRange);
-        bool wereInRange = pold.inRangeOf(opos, visualRange) &&
-                           !((pflags | oflags) & UPDATEFLAG_NEW_ON_MAP);
-
-        if (willBeInRange ^ wereInRange)
-        {
-            switch (o->getType())
-            {
-                case OBJECT_ITEM:
-                {
-                    ItemComponent *item = o->getComponent<ItemComponent>();
-                    ItemClass *itemClass = item->getItemClass();
-
-                    if (oflags & UPDATEFLAG_NEW_ON_MAP)
-                    {
-                        /* Send a specific message to the client when an item appears
-                           out of nowhere, so that a sound/animation can be performed. */
-                        MessageOut appearMsg(GPMSG_ITEM_APPEAR);
-                        appearMsg.writeInt16(itemClass->getDatabaseID());
-                        appearMsg.writeInt16(opos.x);
-                        appearMsg.writeInt16(opos.y);
-                        gameHandler->sendTo(p, appearMsg);
-                    }
-                    else
-                    {
-                        itemMsg.writeInt16(willBeInRange ? itemClass->getDatabaseID() : 0);
-                        itemMsg.writeInt16(opos.x);
-                        itemMsg.writeInt16(opos.y);
-                    }
-                }
-                break;
-                case OBJECT_EFFECT:
-                {
-                    EffectComponent *e = o->getComponent<EffectComponent>();
-                    e->setShown();
-                    // Don't show old effects
-                    if (!(oflags & UPDATEFLAG_NEW_ON_MAP))
-                        break;
-
-                    if (Entity *b = e->getBeing())
-                    {
-                        auto *actorComponent =
-                                b->getComponent<ActorComponent>();
-                        MessageOut effectMsg(GPMSG_CREATE_EFFECT_BEING);
-                        effectMsg.writeInt16(e->getEffectId());
-                        effectMsg.writeInt16(actorComponent->getPublicID());
-                        gameHandler->sendTo(p, effectMsg);
-                    } else {
-                        MessageOut effectMsg(GPMSG_CREATE_EFFECT_POS);
-                        effectMsg.writeInt16(e->getEffectId());
-                        effectMsg.writeInt16(opos.x);
-                        effectMsg.writeInt16(opos.y);
-                        gameHandler->sendTo(p, effectMsg);
-                    }
-                }
-                break;
-                default: break;
-            } // Switch
-        }
-    }
-
     // Do not send a packet if nothing happened in p's range.
     if (itemMsg.getLength() > 2)
-        gameHandler->sendTo(p, itemMsg);
+        outbox.queue(p, itemMsg);
 }
 
 #ifndef NDEBUG
@@ -465,26 +728,133 @@ void GameState::update(int tick)
 {
     currentTick = tick;
 
+    const std::chrono::steady_clock::time_point updateStart =
+            std::chrono::steady_clock::now();
+
+    // Follows changes of the configuration, does nothing most of the time.
+    const Configuration::Settings &settings = Configuration::getSettings();
+    workerPool.setThreadCount(settings.updateThreads);
+
 #ifndef NDEBUG
     dbgLockObjects = true;
 #endif
 
     ScriptManager::currentState()->update();
 
-    // Update game state (update AI, etc.)
+    // Paths queued during the last tick, for the beings to walk now
+    PathQueue::runSearches(workerPool);
+
+    static std::vector< MapComposite * > activeMaps;
+    static std::vector< Entity * > characters;
+    static std::vector< InformJob > jobs;
+    static std::vector< Outbox > outboxes;
+    static std::vector< SideEffects > mapSideEffects;
+    activeMaps.clear();
+    characters.clear();
+    jobs.clear();
+
     const MapManager::Maps &maps = MapManager::getMaps();
     for (MapManager::Maps::const_iterator m = maps.begin(),
          m_end = maps.end(); m != m_end; ++m)
     {
         MapComposite *map = m->second;
-        if (!map->isActive())
-            continue;
+        if (map->isActive() && map->needsUpdate(tick))
+            activeMaps.push_back(map);
+    }
 
-        map->update();
+    /* Update game state (update AI, etc.)
+
+       The maps only share the queues of delayed events, path searches and
+       status effect ticks, and the connections. With
+       game_parallelMapUpdates, each map keeps what it does to those aside
+       while the update threads update the maps, and it is replayed in the
+       order of the maps afterwards. The scripts still run one at a time on
+       the single script state. */
+    const bool parallelMaps = settings.parallelMapUpdates &&
+                              workerPool.getThreadCount() > 1 &&
+                              activeMaps.size() > 1;
+    if (parallelMaps)
+    {
+        mapSideEffects.resize(activeMaps.size());
+        workerPool.run(activeMaps.size(), [](unsigned index) {
+            currentSideEffects = &mapSideEffects[index];
+            activeMaps[index]->update();
+            currentSideEffects = nullptr;
+        });
+    }
 
+    for (unsigned i = 0; i < activeMaps.size(); ++i)
+    {
+        MapComposite *map = activeMaps[i];
+        if (parallelMaps)
+        {
+            SideEffects &sideEffects = mapSideEffects[i];
+            for (SideEffects::iterator it = sideEffects.begin(),
+                 it_end = sideEffects.end(); it != it_end; ++it)
+            {
+                (*it)();
+            }
+            sideEffects.clear();
+        }
+        else
+        {
+            map->update();
+        }
+        StatusManager::runTicks(map);
+        map->flushChangedAttributes();
+
+        // Split the characters of the map into jobs of limited size, so that
+        // a crowded map does not keep a single thread busy.
+        const unsigned first = characters.size();
+        for (CharacterIterator p(map->getWholeMapIterator()); p; ++p)
+            characters.push_back(*p);
+
+        const unsigned last = characters.size();
+        const unsigned chunkSize = settings.informChunkSize ?
+                settings.informChunkSize : last - first;
+        for (unsigned begin = first; begin < last; begin += chunkSize)
+        {
+            InformJob job;
+            job.map = map;
+            job.first = begin;
+            job.last = std::min(begin + chunkSize, last);
+            jobs.push_back(job);
+        }
+    }
+
+    // Serialize the changes of every being once, for all the characters
+    // that will be told about them.
+    workerPool.run(activeMaps.size(), [](unsigned index) {
+        MapComposite *map = activeMaps[index];
+        for (BeingIterator it(map->getWholeMapIterator()); it; ++it)
+            serializeUpdates(*it);
+    });
+
+    /* Informing the characters only reads the state of the world, and each
+       job only writes to its own outbox. So the jobs can be handled by
+       several threads at once. */
+    outboxes.resize(jobs.size());
+    workerPool.run(jobs.size(), [](unsigned index) {
+        const InformJob &job = jobs[index];
+        Outbox &outbox = outboxes[index];
+        for (unsigned i = job.first; i < job.last; ++i)
+            informPlayer(job.map, characters[i], outbox);
+    });
+
+    // Send the messages in the order of the jobs, so that the outcome does
+    // not depend on the way the work was shared between the threads.
+    for (unsigned i = 0; i < jobs.size(); ++i)
+        outboxes[i].flush();
+
+    for (std::vector< MapComposite * >::const_iterator m = activeMaps.begin(),
+         m_end = activeMaps.end(); m != m_end; ++m)
+    {
+        MapComposite *map = *m;
+
+        // Inform clients about status change.
         for (CharacterIterator p(map->getWholeMapIterator()); p; ++p)
         {
-            informPlayer(map, *p);
+            (*p)->getComponent<CharacterComponent>()->sendStatus(**p);
         }
 
         for (ActorIterator it(map->getWholeMapIterator()); it; ++it)
@@ -496,6 +866,7 @@ void GameState::update(int tick)
                 a->getComponent<CombatComponent>()->clearHitsTaken();
             }
         }
+        map->clearZoneChanges();
     }
 
 #   ifndef NDEBUG
@@ -531,6 +902,56 @@ void GameState::update(int tick)
         }
     }
     delayedEvents.clear();
+
+    const std::chrono::duration<double, std::milli> updateTime =
+            std::chrono::steady_clock::now() - updateStart;
+    updateStatistics.totalTime += updateTime.count();
+    updateStatistics.maxTime = std::max(updateStatistics.maxTime,
+                                        updateTime.count());
+
+    if (++updateStatistics.ticks == STATISTICS_INTERVAL)
+    {
+        LOG_DEBUG("World update took " << updateStatistics.totalTime /
+                 updateStatistics.ticks << " ms on average and "
+                 << updateStatistics.maxTime << " ms at most over the last "
+                 << updateStatistics.ticks << " ticks ("
+                 << workerPool.getThreadCount() << " update threads).");
+
+        // Zone changes are a large part of the cost of moving actors around.
+        // Every map is counted, as the maps updated on this tick are not
+        // those that were updated during the whole interval.
+        unsigned zoneChanges = 0;
+        for (MapManager::Maps::const_iterator m = maps.begin(),
+             m_end = maps.end(); m != m_end; ++m)
+        {
+            if (m->second->isActive())
+                zoneChanges += m->second->takeZoneChanges();
+        }
+        LOG_DEBUG("Actors changed zone " << zoneChanges
+                 << " times over the last " << updateStatistics.ticks
+                 << " ticks.");
+
+        // Monsters far from any character have their AI slowed down or
+        // stopped.
+        unsigned aiCounts[AI_LEVEL_COUNT] = { 0, 0, 0 };
+        for (std::vector< MapComposite * >::const_iterator
+             m = activeMaps.begin(), m_end = activeMaps.end(); m != m_end; ++m)
+        {
+            MapComposite *map = *m;
+            for (int level = 0; level < AI_LEVEL_COUNT; ++level)
+                aiCounts[level] += map->getAiCount(AiLevel(level));
+
+            LOG_DEBUG("Monsters on map " << map->getName() << ": "
+                      << map->getAiCount(AI_ACTIVE) << " active, "
+                      << map->getAiCount(AI_REDUCED) << " reduced, "
+                      << map->getAiCount(AI_SLEEPING) << " sleeping.");
+        }
+        LOG_DEBUG("Monsters: " << aiCounts[AI_ACTIVE] << " active, "
+                 << aiCounts[AI_REDUCED] << " reduced, "
+                 << aiCounts[AI_SLEEPING] << " sleeping.");
+
+        updateStatistics = UpdateStatistics();
+    }
 }
 
 bool GameState::insert(Entity *ptr)
@@ -634,6 +1055,11 @@ int GameState::getCurrentTick()
     return currentTick;
 }
 
+GameState::SideEffects *GameState::getSideEffects()
+{
+    return currentSideEffects;
+}
+
 bool GameState::insertOrDelete(Entity *ptr)
 {
     if (insert(ptr)) return true;
@@ -645,7 +1071,6 @@ void GameState::remove(Entity *ptr)
 {
     assert(!dbgLockObjects);
     MapComposite *map = ptr->getMap();
-    int visualRange = Configuration::getValue("game_visualRange", 448);
 
     ptr->signal_removed.emit(ptr);
 
@@ -686,6 +1111,10 @@ void GameState::remove(Entity *ptr)
             break;
     }
 
+    static const std::set<Entity *> noObservers;
+    const std::set<Entity *> &observers = ptr->isVisible() ?
+            ptr->getComponent<ActorComponent>()->getObservers() : noObservers;
+
     if (ptr->canMove())
     {
         if (ptr->getType() == OBJECT_CHARACTER)
@@ -701,17 +1130,12 @@ void GameState::remove(Entity *ptr)
 
         MessageOut msg(GPMSG_BEING_LEAVE);
         msg.writeInt16(ptr->getComponent<ActorComponent>()->getPublicID());
-        Point objectPos = ptr->getComponent<ActorComponent>()->getPosition();
 
-        for (CharacterIterator p(map->getAroundActorIterator(ptr, visualRange));
-             p; ++p)
+        for (std::set<Entity *>::const_iterator it = observers.begin(),
+             it_end = observers.end(); it != it_end; ++it)
         {
-            if (*p != ptr && objectPos.inRangeOf(
-                    (*p)->getComponent<ActorComponent>()->getPosition(),
-                visualRange))
-            {
-                gameHandler->sendTo(*p, msg);
-            }
+            if (*it != ptr)
+                gameHandler->sendTo(*it, msg);
         }
     }
     else if (ptr->getType() == OBJECT_ITEM)
@@ -722,13 +1146,28 @@ void GameState::remove(Entity *ptr)
         msg.writeInt16(pos.x);
         msg.writeInt16(pos.y);
 
-        for (CharacterIterator p(map->getAroundActorIterator(ptr, visualRange)); p; ++p)
+        for (std::set<Entity *>::const_iterator it = observers.begin(),
+             it_end = observers.end(); it != it_end; ++it)
         {
-            const Point &point =
-                    (*p)->getComponent<ActorComponent>()->getPosition();
-            if (pos.inRangeOf(point, visualRange))
+            gameHandler->sendTo(*it, msg);
+        }
+    }
+
+    if (ptr->isVisible())
+    {
+        // Forget about the actor, and about what it was seeing.
+        auto *actorComponent = ptr->getComponent<ActorComponent>();
+        while (!actorComponent->getObservers().empty())
+            setVisible(*actorComponent->getObservers().begin(), ptr, false);
+
+        if (ptr->getType() == OBJECT_CHARACTER)
+        {
+            auto *characterComponent =
+                    ptr->getComponent<CharacterComponent>();
+            while (!characterComponent->getVisibleActors().empty())
             {
-                gameHandler->sendTo(*p, msg);
+                setVisible(ptr, *characterComponent->getVisibleActors().begin(),
+                           false);
             }
         }
     }
@@ -790,6 +1229,12 @@ static void enqueueEvent(Entity *ptr, const DelayedEvent &e)
 
 void GameState::enqueueInsert(Entity *ptr)
 {
+    if (SideEffects *sideEffects = getSideEffects())
+    {
+        sideEffects->push_back([=] { enqueueInsert(ptr); });
+        return;
+    }
+
     DelayedEvent event;
     event.type = EVENT_INSERT;
     event.map = 0;
@@ -798,6 +1243,12 @@ void GameState::enqueueInsert(Entity *ptr)
 
 void GameState::enqueueRemove(Entity *ptr)
 {
+    if (SideEffects *sideEffects = getSideEffects())
+    {
+        sideEffects->push_back([=] { enqueueRemove(ptr); });
+        return;
+    }
+
     DelayedEvent event;
     event.type = EVENT_REMOVE;
     event.map = 0;
@@ -808,6 +1259,12 @@ void GameState::enqueueWarp(Entity *ptr,
                             MapComposite *map,
                             const Point &point)
 {
+    if (SideEffects *sideEffects = getSideEffects())
+    {
+        sideEffects->push_back([=] { enqueueWarp(ptr, map, point); });
+        return;
+    }
+
     // When the player has just disconnected, better not wait for the pointer
     // to become invalid.
     if (!ptr->getComponent<CharacterComponent>()->isConnected())
@@ -825,14 +1282,32 @@ void GameState::enqueueWarp(Entity *ptr,
 
 void GameState::sayAround(Entity *entity, const std::string &text)
 {
-    Point speakerPosition = entity->getComponent<ActorComponent>()->getPosition();
-    int visualRange = Configuration::getValue("game_visualRange", 448);
+    auto *actorComponent = entity->getComponent<ActorComponent>();
+    const bool speakerIsNew =
+            actorComponent->getUpdateFlags() & UPDATEFLAG_NEW_ON_MAP;
+
+    // Only the characters seeing the speaker can hear it.
+    const std::set<Entity *> &observers = actorComponent->getObservers();
+    for (std::set<Entity *>::const_iterator i = observers.begin(),
+         i_end = observers.end(); i != i_end; ++i)
+    {
+        sayTo(*i, entity, text);
+    }
 
-    for (CharacterIterator i(entity->getMap()->getAroundActorIterator(entity, visualRange)); i; ++i)
+    // Actors inserted during this tick are only seen once the characters
+    // are informed, so the ones in range are looked for on the map.
+    const Point &speakerPosition = actorComponent->getPosition();
+    int visualRange = Configuration::getSettings().visualRange;
+    for (CharacterIterator i(entity->getMap()->getAroundActorIterator(
+                                     entity, visualRange)); i; ++i)
     {
-        const Point &point =
-                (*i)->getComponent<ActorComponent>()->getPosition();
-        if (speakerPosition.inRangeOf(point, visualRange))
+        auto *characterActor = (*i)->getComponent<ActorComponent>();
+        if (!speakerIsNew &&
+            !(characterActor->getUpdateFlags() & UPDATEFLAG_NEW_ON_MAP))
+            continue;
+
+        if (speakerPosition.inRangeOf(characterActor->getPosition(),
+                                      visualRange))
         {
             sayTo(*i, entity, text);
         }
@@ -864,6 +1339,12 @@ void GameState::sayTo(Entity *destination, Entity *source, const std::string &te
 
 void GameState::sayToAll(const std::string &text)
 {
+    if (SideEffects *sideEffects = getSideEffects())
+    {
+        sideEffects->push_back([=] { sayToAll(text); });
+        return;
+    }
+
     MessageOut msg(GPMSG_SAY);
 
     // The message will be shown as if it was from the server
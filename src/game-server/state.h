@@ -23,7 +23,9 @@
 
 #include "utils/point.h"
 
+#include <functional>
 #include <string>
+#include <vector>
 
 class Entity;
 class ItemClass;
@@ -38,6 +40,22 @@ namespace GameState
 
     int getCurrentTick();
 
+    /**
+     * Changes made by the update of a map to what the maps share: the
+     * delayed events, the path queue, the status effect ticks and the
+     * messages to the clients and to the account server.
+     */
+    typedef std::vector< std::function<void()> > SideEffects;
+
+    /**
+     * Gets the side effects kept aside by the map being updated by this
+     * thread, or nullptr when they take place right away. The maps are only
+     * updated by several threads at once with game_parallelMapUpdates, and
+     * the side effects of each map are then replayed in the order of the
+     * maps once all of them are updated.
+     */
+    SideEffects *getSideEffects();
+
     /**
      * Inserts an entity in the game world.
      * @return false if the insertion failed and the entity is in limbo.
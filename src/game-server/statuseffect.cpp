@@ -23,8 +23,9 @@
 #include "game-server/being.h"
 #include "scripting/scriptmanager.h"
 
-StatusEffect::StatusEffect(int id):
-    mId(id)
+StatusEffect::StatusEffect(int id, int tickInterval):
+    mId(id),
+    mTickInterval(tickInterval)
 {
 }
 
@@ -32,14 +33,23 @@ StatusEffect::~StatusEffect()
 {
 }
 
-void StatusEffect::tick(Entity &target, int count)
+void StatusEffect::queueTick(Entity &target, int count)
 {
-    if (mTickCallback.isValid())
+    mTargets.push_back(&target);
+    mCounts.push_back(count);
+}
+
+void StatusEffect::runTicks(MapComposite *map)
+{
+    if (mTickCallback.isValid() && !mTargets.empty())
     {
         Script *s = ScriptManager::currentState();
         s->prepare(mTickCallback);
-        s->push(&target);
-        s->push(count);
-        s->execute(target.getMap());
+        s->push(mTargets);
+        s->push(mCounts);
+        s->execute(map);
     }
+
+    mTargets.clear();
+    mCounts.clear();
 }
@@ -23,25 +23,54 @@
 
 #include "scripting/script.h"
 
+#include <vector>
+
 class Entity;
+class MapComposite;
 
 class StatusEffect
 {
     public:
-        StatusEffect(int id);
+        StatusEffect(int id, int tickInterval = 1);
         ~StatusEffect();
 
-        void tick(Entity &target, int count);
+        /**
+         * Queues a tick of the effect on the given being, run together with
+         * the other queued ones by runTicks().
+         */
+        void queueTick(Entity &target, int count);
+
+        bool hasQueuedTicks() const
+        { return !mTargets.empty(); }
+
+        /**
+         * Calls the tick callback once for all the queued beings.
+         */
+        void runTicks(MapComposite *map);
 
         int getId() const
         { return mId; }
 
+        /**
+         * Gets the number of ticks between two calls of the tick callback.
+         */
+        int getTickInterval() const
+        { return mTickInterval; }
+
+        bool hasTickCallback() const
+        { return mTickCallback.isValid(); }
+
         void setTickCallback(Script *script)
         { script->assignCallback(mTickCallback); }
 
     private:
         int mId;
+        int mTickInterval;
         Script::Ref mTickCallback;
+
+        /** Beings with a queued tick and their remaining time. */
+        std::vector<Entity *> mTargets;
+        std::vector<int> mCounts;
 };
 
 #endif
@@ -21,6 +21,7 @@
 #include "game-server/statusmanager.h"
 
 #include "common/resourcemanager.h"
+#include "game-server/state.h"
 #include "game-server/statuseffect.h"
 #include "utils/logger.h"
 #include "utils/xml.h"
@@ -28,11 +29,15 @@
 #include <map>
 #include <set>
 #include <sstream>
+#include <vector>
 
 typedef std::map< int, StatusEffect * > StatusEffectsMap;
 static StatusEffectsMap statusEffects;
 static utils::NameMap<StatusEffect*> statusEffectsByName;
 
+/** Status effects with queued ticks. */
+static std::vector<StatusEffect *> queuedStatusEffects;
+
 void StatusManager::initialize()
 {
 
@@ -52,6 +57,7 @@ void StatusManager::deinitialize()
     }
     statusEffects.clear();
     statusEffectsByName.clear();
+    queuedStatusEffects.clear();
 }
 
 StatusEffect *StatusManager::getStatus(int statusId)
@@ -65,6 +71,31 @@ StatusEffect *StatusManager::getStatusByName(const std::string &name)
     return statusEffectsByName.value(name);
 }
 
+void StatusManager::queueTick(StatusEffect *statusEffect, Entity &target,
+                              int count)
+{
+    if (GameState::SideEffects *sideEffects = GameState::getSideEffects())
+    {
+        sideEffects->push_back([statusEffect, &target, count] {
+            queueTick(statusEffect, target, count);
+        });
+        return;
+    }
+
+    if (!statusEffect->hasQueuedTicks())
+        queuedStatusEffects.push_back(statusEffect);
+    statusEffect->queueTick(target, count);
+}
+
+void StatusManager::runTicks(MapComposite *map)
+{
+    // Callbacks may apply status effects, which queue nothing until the
+    // next update of the beings, so the list does not change meanwhile.
+    for (StatusEffect *statusEffect : queuedStatusEffects)
+        statusEffect->runTicks(map);
+    queuedStatusEffects.clear();
+}
+
 /**
  * Read a <attribute> element from settings.
  * Used by SettingsManager.
@@ -80,7 +111,15 @@ void StatusManager::readStatusNode(xmlNodePtr node, const std::string &filename)
         return;
     }
 
-    StatusEffect *statusEffect = new StatusEffect(id);
+    int tickInterval = XML::getProperty(node, "tick-interval", 1);
+    if (tickInterval < 1)
+    {
+        LOG_WARN("Status Manager: The status ID: " << id << " in "
+                 << filename << " has an invalid tick interval, using 1.");
+        tickInterval = 1;
+    }
+
+    StatusEffect *statusEffect = new StatusEffect(id, tickInterval);
 
     const std::string name = XML::getProperty(node, "name",
                                               std::string());
@@ -24,6 +24,8 @@
 #include <string>
 #include "utils/xml.h"
 
+class Entity;
+class MapComposite;
 class StatusEffect;
 
 namespace StatusManager
@@ -53,6 +55,17 @@ namespace StatusManager
      */
     StatusEffect *getStatusByName(const std::string &name);
 
+    /**
+     * Queues a tick of a status effect on a being. The ticks are run by
+     * runTicks() with one script call per status effect.
+     */
+    void queueTick(StatusEffect *statusEffect, Entity &target, int count);
+
+    /**
+     * Runs the queued ticks of the beings of the given map.
+     */
+    void runTicks(MapComposite *map);
+
     void readStatusNode(xmlNodePtr node, const std::string &filename);
 
     void checkStatus();
@@ -0,0 +1,124 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/timerwheel.h"
+
+TimerWheel::TimerWheel(int tick):
+    mCurrentTick(tick)
+{
+    for (int level = 0; level < LEVELS; ++level)
+        for (int index = 0; index < SLOTS; ++index)
+            mSlots[level][index] = nullptr;
+}
+
+TimerWheel::~TimerWheel()
+{
+    for (int level = 0; level < LEVELS; ++level)
+        for (int index = 0; index < SLOTS; ++index)
+            while (Timer *timer = mSlots[level][index])
+                cancel(*timer);
+}
+
+void TimerWheel::schedule(Timer &timer, int tick)
+{
+    cancel(timer);
+    timer.mTick = tick > mCurrentTick ? tick : mCurrentTick + 1;
+    place(timer);
+}
+
+void TimerWheel::cancel(Timer &timer)
+{
+    if (!timer.mSlot)
+        return;
+
+    if (timer.mPrevious)
+        timer.mPrevious->mNext = timer.mNext;
+    else
+        *timer.mSlot = timer.mNext;
+
+    if (timer.mNext)
+        timer.mNext->mPrevious = timer.mPrevious;
+
+    timer.mPrevious = nullptr;
+    timer.mNext = nullptr;
+    timer.mSlot = nullptr;
+}
+
+void TimerWheel::place(Timer &timer)
+{
+    const int range = 1 << (SLOT_BITS * LEVELS);
+
+    // Timers beyond the last level are parked in it until they come closer
+    int delta = timer.mTick - mCurrentTick;
+    int tick = delta < range ? timer.mTick : mCurrentTick + range - 1;
+    if (delta >= range)
+        delta = range - 1;
+
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= 1 << (SLOT_BITS * (level + 1)))
+        ++level;
+
+    const int index = (tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+    Timer *&slot = mSlots[level][index];
+
+    timer.mPrevious = nullptr;
+    timer.mNext = slot;
+    timer.mSlot = &slot;
+    if (slot)
+        slot->mPrevious = &timer;
+    slot = &timer;
+}
+
+void TimerWheel::cascade(int level, int index)
+{
+    Timer *timer = mSlots[level][index];
+    mSlots[level][index] = nullptr;
+
+    while (timer)
+    {
+        Timer *next = timer->mNext;
+        place(*timer);
+        timer = next;
+    }
+}
+
+void TimerWheel::advance(int tick, std::vector<Entity *> &expired)
+{
+    while (mCurrentTick < tick)
+    {
+        ++mCurrentTick;
+
+        // Bring the timers of the coarse levels closer when a turn of the
+        // finer level is completed.
+        int index = mCurrentTick & (SLOTS - 1);
+        for (int level = 1; index == 0 && level < LEVELS; ++level)
+        {
+            index = (mCurrentTick >> (SLOT_BITS * level)) & (SLOTS - 1);
+            cascade(level, index);
+        }
+
+        Timer *&slot = mSlots[0][mCurrentTick & (SLOTS - 1)];
+        while (Timer *timer = slot)
+        {
+            cancel(*timer);
+            expired.push_back(timer->mEntity);
+        }
+    }
+}
@@ -0,0 +1,122 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <vector>
+
+class Entity;
+
+/**
+ * Keeps track of the ticks at which sleeping entities want to be woken up.
+ *
+ * The wheel is made of several levels of slots. The first level has one slot
+ * per tick, each next level has slots covering a whole turn of the previous
+ * one. Timers far in the future sit in the coarse levels and move down to
+ * the finer ones as their tick comes closer, so scheduling, cancelling and
+ * advancing by one tick all take constant time.
+ */
+class TimerWheel
+{
+    public:
+        /**
+         * Wakeup of an entity. Stored inside the entity itself and linked
+         * into the slot of the wheel it falls in.
+         */
+        class Timer
+        {
+            public:
+                Timer(Entity *entity):
+                    mEntity(entity),
+                    mTick(0),
+                    mPrevious(nullptr),
+                    mNext(nullptr),
+                    mSlot(nullptr)
+                {}
+
+                bool isScheduled() const
+                { return mSlot; }
+
+                /**
+                 * Gets the tick at which the timer expires.
+                 */
+                int getTick() const
+                { return mTick; }
+
+            private:
+                Timer(const Timer &);
+                Timer &operator=(const Timer &);
+
+                Entity *mEntity;
+                int mTick;
+                Timer *mPrevious;
+                Timer *mNext;
+                Timer **mSlot;      /**< Slot the timer is linked into. */
+
+                friend class TimerWheel;
+        };
+
+        TimerWheel(int tick);
+        ~TimerWheel();
+
+        /**
+         * Schedules a timer at the given tick, replacing its previous
+         * schedule. Ticks that already passed are moved to the next tick.
+         */
+        void schedule(Timer &timer, int tick);
+
+        /**
+         * Cancels a timer. Does nothing when it is not scheduled.
+         */
+        void cancel(Timer &timer);
+
+        /**
+         * Advances the wheel up to the given tick and appends the entities
+         * of the timers that expired on the way to \a expired.
+         */
+        void advance(int tick, std::vector<Entity *> &expired);
+
+        int getCurrentTick() const
+        { return mCurrentTick; }
+
+    private:
+        TimerWheel(const TimerWheel &);
+        TimerWheel &operator=(const TimerWheel &);
+
+        static const int SLOT_BITS = 6;
+        static const int SLOTS = 1 << SLOT_BITS;
+        static const int LEVELS = 4;
+
+        /**
+         * Links a timer into the slot matching its tick.
+         */
+        void place(Timer &timer);
+
+        /**
+         * Places again the timers of a slot of a coarse level.
+         */
+        void cascade(int level, int index);
+
+        Timer *mSlots[LEVELS][SLOTS];
+        int mCurrentTick;           /**< Last tick the wheel advanced to. */
+};
+
+#endif // TIMERWHEEL_H
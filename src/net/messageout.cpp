@@ -54,6 +54,34 @@ MessageOut::MessageOut(int id):
     mDebugMode = debugModeEnabled;
 }
 
+MessageOut::MessageOut():
+    mData(nullptr),
+    mPos(0),
+    mDataSize(0),
+    mDebugMode(debugModeEnabled)
+{
+}
+
+MessageOut::MessageOut(MessageOut &&other):
+    mData(other.mData),
+    mPos(other.mPos),
+    mDataSize(other.mDataSize),
+    mDebugMode(other.mDebugMode)
+{
+    other.mData = nullptr;
+    other.mPos = 0;
+    other.mDataSize = 0;
+}
+
+MessageOut::MessageOut(const MessageOut &other):
+    mData(nullptr),
+    mPos(0),
+    mDataSize(0),
+    mDebugMode(other.mDebugMode)
+{
+    append(other);
+}
+
 MessageOut::~MessageOut()
 {
     free(mData);
@@ -63,11 +91,13 @@ void MessageOut::expand(size_t bytes)
 {
     if (bytes > mDataSize)
     {
-        do
+        if (mDataSize == 0)
+            mDataSize = INITIAL_DATA_CAPACITY;
+
+        while (bytes > mDataSize)
         {
             mDataSize *= CAPACITY_GROW_FACTOR;
         }
-        while (bytes > mDataSize);
 
         mData = (char*) realloc(mData, mDataSize);
     }
@@ -160,6 +190,16 @@ void MessageOut::writeString(const std::string &string, int length)
     mPos += length;
 }
 
+void MessageOut::append(const MessageOut &fragment)
+{
+    if (fragment.mPos == 0)
+        return;
+
+    expand(mPos + fragment.mPos);
+    memcpy(mData + mPos, fragment.mData, fragment.mPos);
+    mPos += fragment.mPos;
+}
+
 void MessageOut::writeValueType(ManaServ::ValueType type)
 {
     expand(mPos + 1);
@@ -38,6 +38,24 @@ class MessageOut
          */
         MessageOut(int id);
 
+        /**
+         * Creates a message without ID. Used for building pieces of data that
+         * are appended to several other messages.
+         */
+        MessageOut();
+
+        /**
+         * Takes over the contents of another message, which is left empty.
+         * Allows messages to be queued for sending later on.
+         */
+        MessageOut(MessageOut &&other);
+
+        /**
+         * Copies the contents of another message. Allows a message that is
+         * filled again afterwards to be queued for sending later on.
+         */
+        MessageOut(const MessageOut &other);
+
         ~MessageOut();
 
         /**
@@ -67,6 +85,18 @@ class MessageOut
          */
         void writeString(const std::string &string, int length = -1);
 
+        /**
+         * Appends the contents of a message without ID to this message.
+         */
+        void append(const MessageOut &fragment);
+
+        /**
+         * Discards the contents of a message without ID, keeping the buffer
+         * around so that it can be filled again.
+         */
+        void clear()
+        { mPos = 0; }
+
         /**
          * Returns the content of the message.
          */
@@ -76,11 +76,40 @@ extern "C" {
  * using those since they will most likely break your code in other places.
  */
 
+/** LUA on_update_derived_attributes (callbacks)
+ * on_update_derived_attributes(function ref)
+ **
+ * on_update_derived_attributes( function(Being*, table) ): void
+ * Will call the function ''ref'' when attributes changed and other attributes
+ * need recalculation. The function is expected to recalculate those then.
+ * It is called at most once per being and map update, with the being and a
+ * table of the ids of all the attributes that changed since the previous
+ * call. Changes made by the function itself do not call it again, so it has
+ * to recalculate chains of dependent attributes by itself.
+ *
+ * When set, it replaces the function given to
+ * [[scripting#on_update_derived_attribute|on_update_derived_attribute]].
+ *
+ * **See:** [[attributes.xml]] for more info.
+ *
+ */
+static int on_update_derived_attributes(lua_State *s)
+{
+    luaL_checktype(s, 1, LUA_TFUNCTION);
+    BeingComponent::setUpdateDerivedAttributesCallback(getScript(s));
+    return 0;
+}
+
 /** LUA on_update_derived_attribute (callbacks)
  * on_update_derived_attribute(function ref)
  **
+ * on_update_derived_attribute( function(Being*, int) ): void
  * Will call the function ''ref'' when an attribute changed and other attributes
  * need recalculation. The function is expected to recalculate those then.
+ * The changes are collected like for
+ * [[scripting#on_update_derived_attributes|on_update_derived_attributes]],
+ * and the function is then called once for each changed attribute, with the
+ * being and the id of the attribute.
  *
  * **See:** [[attributes.xml]] for more info.
  *
@@ -88,7 +117,7 @@ extern "C" {
 static int on_update_derived_attribute(lua_State *s)
 {
     luaL_checktype(s, 1, LUA_TFUNCTION);
-    BeingComponent::setUpdateDerivedAttributesCallback(getScript(s));
+    BeingComponent::setUpdateDerivedAttributeCallback(getScript(s));
     return 0;
 }
 
@@ -100,7 +129,7 @@ static int on_update_derived_attribute(lua_State *s)
  * The function is expected to do this recalculation then. The engine only
  * triggers this for characters. However you can use the same function for
  * recalculating derived attributes in the
- * [[scripting#on_update_derived_attribute|on_update_derived_attribute]] callback.
+ * [[scripting#on_update_derived_attributes|on_update_derived_attributes]] callback.
  *
  * **See:** [[attributes.xml]] for more info.
  */
@@ -2285,13 +2314,7 @@ static int chr_get_post(lua_State *s)
 static int entity_register(lua_State *s)
 {
     Entity *entity = LuaEntity::check(s, 1);
-    Script *script = getScript(s);
-
-    entity->signal_removed.connect(sigc::mem_fun(script, &Script::processRemoveEvent));
-
-    if (BeingComponent *bc = entity->findComponent<BeingComponent>())
-        bc->signal_died.connect(sigc::mem_fun(script, &Script::processDeathEvent));
-
+    getScript(s)->registerEntity(entity);
     return 0;
 }
 
@@ -2317,7 +2340,7 @@ static int entity_shake_screen(lua_State *s)
     if (lua_isnumber(s, 5))
         msg.writeInt16(lua_tointeger(s, 5));
 
-    c->getComponent<CharacterComponent>()->getClient()->send(msg);
+    gameHandler->sendTo(c, msg);
 
     return 0;
 }
@@ -2337,7 +2360,7 @@ static int entity_show_text_particle(lua_State *s)
 
     MessageOut msg(GPMSG_CREATE_TEXT_PARTICLE);
     msg.writeString(text);
-    c->getComponent<CharacterComponent>()->getClient()->send(msg);
+    gameHandler->sendTo(c, msg);
 
     return 0;
 }
@@ -3044,8 +3067,20 @@ static int get_status_effect(lua_State *s)
 /** LUA statuseffect:on_tick (statuseffectclass)
  * statuseffect:on_tick(function callback)
  **
- * Sets the callback that gets called for every tick when the status effect
- * is active.
+ * Sets the callback that gets called when the status effect ticks, which is
+ * every tick or every ''tick-interval'' ticks as given in the status effects
+ * file. To avoid a call for each being, the callback is called once per map
+ * with a table of the beings whose status effect ticked and a table of the
+ * remaining time of the effect on each of them. A being whose map was
+ * hibernating can appear several times, once for each tick it missed:
+ *
+ * <code lua>
+ * local function tick(targets, times)
+ *     for i, target in ipairs(targets) do
+ *         -- times[i] is the remaining time on target
+ *     end
+ * end
+ * </code>
  *
  * **Note:** See [[scripting#get_status_effect|get_status_effect]] for getting
  * a statuseffect object.
@@ -3618,7 +3653,8 @@ static int require_loader(lua_State *s)
 
 
 LuaScript::LuaScript():
-    nbArgs(-1)
+    nbArgs(-1),
+    mThreadStarting(false)
 {
     mRootState = luaL_newstate();
     mCurrentState = mRootState;
@@ -3639,6 +3675,7 @@ LuaScript::LuaScript():
     // Put the callback functions in the scripting environment.
     static luaL_Reg const callbacks[] = {
         { "on_update_derived_attribute",    on_update_derived_attribute       },
+        { "on_update_derived_attributes",   on_update_derived_attributes      },
         { "on_recalculate_base_attribute",  on_recalculate_base_attribute     },
         { "on_character_death",             on_character_death                },
         { "on_character_death_accept",      on_character_death_accept         },
@@ -42,6 +42,15 @@ LuaScript::~LuaScript()
 
 void LuaScript::prepare(Ref function)
 {
+    mMutex.lock();
+
+    // A new thread keeps the lock it took until it is resumed
+    if (mThreadStarting)
+    {
+        mThreadStarting = false;
+        mMutex.unlock();
+    }
+
     assert(nbArgs == -1);
 
     assert(function.isValid());
@@ -52,6 +61,9 @@ void LuaScript::prepare(Ref function)
 
 Script::Thread *LuaScript::newThread()
 {
+    mMutex.lock();
+    mThreadStarting = true;
+
     assert(nbArgs == -1);
     assert(!mCurrentThread);
 
@@ -64,6 +76,8 @@ Script::Thread *LuaScript::newThread()
 
 void LuaScript::prepareResume(Thread *thread)
 {
+    mMutex.lock();
+
     assert(nbArgs == -1);
     assert(!mCurrentThread);
 
@@ -113,6 +127,20 @@ void LuaScript::push(const std::list<InventoryItem> &itemList)
     ++nbArgs;
 }
 
+void LuaScript::push(const std::vector<int> &values)
+{
+    assert(nbArgs >= 0);
+    pushSTLContainer<int>(mCurrentState, values);
+    ++nbArgs;
+}
+
+void LuaScript::push(const std::vector<Entity *> &entities)
+{
+    assert(nbArgs >= 0);
+    pushSTLContainer<Entity *>(mCurrentState, entities);
+    ++nbArgs;
+}
+
 int LuaScript::execute(const Context &context)
 {
     assert(nbArgs >= 0);
@@ -132,11 +160,13 @@ int LuaScript::execute(const Context &context)
                  << "     Script  : " << mScriptFile << std::endl
                  << "     Error   : " << (s ? s : "") << std::endl);
         lua_pop(mCurrentState, 1);
+        mMutex.unlock();
         return 0;
     }
     res = lua_tointeger(mCurrentState, -1);
     lua_pop(mCurrentState, 1);
     mContext = previousContext;
+    mMutex.unlock();
     return res;
 }
 
@@ -190,6 +220,7 @@ bool LuaScript::resume()
 
     mCurrentThread = 0;
     mCurrentState = mRootState;
+    mMutex.unlock();
 
     return done;
 }
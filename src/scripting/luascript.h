@@ -28,6 +28,8 @@ extern "C" {
 
 #include "scripting/script.h"
 
+#include <mutex>
+
 class CharacterComponent;
 
 /**
@@ -61,6 +63,10 @@ class LuaScript : public Script
 
         void push(const std::list<InventoryItem> &itemList);
 
+        void push(const std::vector<int> &values);
+
+        void push(const std::vector<Entity *> &entities);
+
         int execute(const Context &context = Context());
 
         bool resume();
@@ -106,6 +112,15 @@ class LuaScript : public Script
         lua_State *mCurrentState;
         int nbArgs;
 
+        /**
+         * Held from the preparation of a function or thread until it is
+         * executed, so that the maps updated by several threads run their
+         * scripts one at a time. Recursive, as a script may cause another
+         * function to be executed.
+         */
+        std::recursive_mutex mMutex;
+        bool mThreadStarting;   /**< The lock of newThread() is still held. */
+
         static Ref mDeathNotificationCallback;
         static Ref mRemoveNotificationCallback;
 
@@ -49,6 +49,29 @@ Script::~Script()
     assert(mThreads.empty());
 }
 
+void Script::registerEntity(Entity *entity)
+{
+    EntityListeners &listeners = mRegisteredEntities[entity];
+
+    // Registering several times should not cause duplicate notifications
+    if (listeners.removed.isConnected())
+        return;
+
+    listeners.removed.connect<Script, &Script::processRemoveEvent>(
+            entity->signal_removed, this);
+    listeners.destroyed.connect<Script, &Script::entityDestroyed>(
+            entity->signal_destroyed, this);
+
+    if (BeingComponent *bc = entity->findComponent<BeingComponent>())
+        listeners.died.connect<Script, &Script::processDeathEvent>(
+                bc->signal_died, this);
+}
+
+void Script::entityDestroyed(Entity *entity)
+{
+    mRegisteredEntities.erase(entity);
+}
+
 void Script::registerEngine(const std::string &name, Factory f)
 {
     if (!engines)
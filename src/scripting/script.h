@@ -24,20 +24,21 @@
 #include "common/inventorydata.h"
 #include "common/manaserv_protocol.h"
 
+#include "utils/event.h"
+
 #include <list>
+#include <map>
 #include <string>
 #include <vector>
 #include <stack>
 
-#include <sigc++/trackable.h>
-
 class MapComposite;
 class Entity;
 
 /**
  * Abstract interface for calling functions written in an external language.
  */
-class Script : public sigc::trackable
+class Script
 {
     public:
         struct Context
@@ -193,6 +194,16 @@ class Script : public sigc::trackable
          */
         virtual void push(const std::list<InventoryItem> &itemList) = 0;
 
+        /**
+         * Pushes a list of integers as an array.
+         */
+        virtual void push(const std::vector<int> &values) = 0;
+
+        /**
+         * Pushes a list of game entities as an array.
+         */
+        virtual void push(const std::vector<Entity *> &entities) = 0;
+
         /**
          * Executes the function being prepared.
          * @param context the context that is supposed to be used for executing
@@ -245,6 +256,13 @@ class Script : public sigc::trackable
 
         virtual void processRemoveEvent(Entity *entity) = 0;
 
+        /**
+         * Makes the script process the death of the entity, if it is a
+         * being, and its removals from a map. The entity stays registered
+         * when it changes maps, and is forgotten once it is destroyed.
+         */
+        void registerEntity(Entity *entity);
+
         static void setCreateNpcDelayedCallback(Script *script)
         { script->assignCallback(mCreateNpcDelayedCallback); }
 
@@ -257,7 +275,17 @@ class Script : public sigc::trackable
         const Context *mContext;
 
     private:
+        void entityDestroyed(Entity *entity);
+
+        struct EntityListeners
+        {
+            utils::EventListener<Entity *> removed;
+            utils::EventListener<Entity *> died;
+            utils::EventListener<Entity *> destroyed;
+        };
+
         std::vector<Thread*> mThreads;
+        std::map<Entity *, EntityListeners> mRegisteredEntities;
 
         static Ref mCreateNpcDelayedCallback;
         static Ref mUpdateCallback;
@@ -0,0 +1,228 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILS_EVENT_H
+#define UTILS_EVENT_H
+
+namespace utils
+{
+
+template <typename... Args> class Event;
+
+/**
+ * A connection to an Event, stored inside the object that wants to be
+ * notified. Listeners are linked directly into the list of the event, so
+ * connecting never allocates memory.
+ *
+ * A listener disconnects itself when it is destroyed and gets disconnected
+ * when the event is destroyed. Copying a listener gives an unconnected one,
+ * so that objects holding listeners can still be stored in containers.
+ */
+template <typename... Args>
+class EventListener
+{
+    public:
+        EventListener():
+            mEvent(nullptr),
+            mPrevious(nullptr),
+            mNext(nullptr),
+            mObject(nullptr),
+            mCallback(nullptr)
+        {}
+
+        EventListener(const EventListener &):
+            mEvent(nullptr),
+            mPrevious(nullptr),
+            mNext(nullptr),
+            mObject(nullptr),
+            mCallback(nullptr)
+        {}
+
+        ~EventListener()
+        { disconnect(); }
+
+        /**
+         * Connects to an event, so that \a Method gets called on \a object
+         * each time the event is emitted. Disconnects from the previous event
+         * if needed.
+         */
+        template <class T, void (T::*Method)(Args...)>
+        void connect(Event<Args...> &event, T *object)
+        { connect(event, object, &callMethod<T, Method>); }
+
+        /**
+         * Connects to an event, so that \a Function gets called each time the
+         * event is emitted. Disconnects from the previous event if needed.
+         */
+        template <void (*Function)(Args...)>
+        void connect(Event<Args...> &event)
+        { connect(event, nullptr, &callFunction<Function>); }
+
+        /**
+         * Disconnects from the event. Allowed while the event is emitted,
+         * including from the callback of this listener.
+         */
+        void disconnect();
+
+        bool isConnected() const
+        { return mEvent; }
+
+        /**
+         * Tells whether the listener is connected to the given event.
+         */
+        bool isConnectedTo(const Event<Args...> &event) const
+        { return mEvent == &event; }
+
+    private:
+        typedef void (*Callback)(void *object, Args... args);
+
+        EventListener &operator=(const EventListener &);
+
+        void connect(Event<Args...> &, void *object, Callback);
+
+        template <class T, void (T::*Method)(Args...)>
+        static void callMethod(void *object, Args... args)
+        { (static_cast<T *>(object)->*Method)(args...); }
+
+        template <void (*Function)(Args...)>
+        static void callFunction(void *, Args... args)
+        { Function(args...); }
+
+        Event<Args...> *mEvent;
+        EventListener *mPrevious;
+        EventListener *mNext;
+        void *mObject;
+        Callback mCallback;
+
+        friend class Event<Args...>;
+};
+
+/**
+ * Notifies the listeners connected to it, in the order they were connected.
+ * Meant as a lightweight replacement of sigc::signal for events that are
+ * emitted often or exist on every entity: an event is three pointers and
+ * emitting it is a walk through a linked list.
+ */
+template <typename... Args>
+class Event
+{
+    public:
+        Event():
+            mFirst(nullptr),
+            mLast(nullptr),
+            mEmission(nullptr)
+        {}
+
+        ~Event()
+        {
+            while (mFirst)
+                mFirst->disconnect();
+        }
+
+        /**
+         * Calls every connected listener. Listeners may disconnect
+         * themselves or other listeners of this event from their callback.
+         */
+        void emit(Args... args)
+        {
+            Emission emission = { mFirst, mEmission };
+            mEmission = &emission;
+            while (EventListener<Args...> *listener = emission.next)
+            {
+                emission.next = listener->mNext;
+                listener->mCallback(listener->mObject, args...);
+            }
+            mEmission = emission.outer;
+        }
+
+        bool isEmpty() const
+        { return !mFirst; }
+
+    private:
+        Event(const Event &);
+        Event &operator=(const Event &);
+
+        /**
+         * Emission in progress. Keeps track of the next listener to call so
+         * that it can be skipped when disconnected by a callback.
+         */
+        struct Emission
+        {
+            EventListener<Args...> *next;
+            Emission *outer;    /**< Emission this one is nested in. */
+        };
+
+        EventListener<Args...> *mFirst;
+        EventListener<Args...> *mLast;
+        Emission *mEmission;
+
+        friend class EventListener<Args...>;
+};
+
+template <typename... Args>
+void EventListener<Args...>::connect(Event<Args...> &event, void *object,
+                                     Callback callback)
+{
+    disconnect();
+
+    mEvent = &event;
+    mObject = object;
+    mCallback = callback;
+    mPrevious = event.mLast;
+    mNext = nullptr;
+
+    if (event.mLast)
+        event.mLast->mNext = this;
+    else
+        event.mFirst = this;
+    event.mLast = this;
+}
+
+template <typename... Args>
+void EventListener<Args...>::disconnect()
+{
+    if (!mEvent)
+        return;
+
+    for (typename Event<Args...>::Emission *emission = mEvent->mEmission;
+         emission; emission = emission->outer)
+    {
+        if (emission->next == this)
+            emission->next = mNext;
+    }
+
+    if (mPrevious)
+        mPrevious->mNext = mNext;
+    else
+        mEvent->mFirst = mNext;
+
+    if (mNext)
+        mNext->mPrevious = mPrevious;
+    else
+        mEvent->mLast = mPrevious;
+
+    mEvent = nullptr;
+    mPrevious = nullptr;
+    mNext = nullptr;
+}
+
+} // namespace utils
+
+#endif // UTILS_EVENT_H
@@ -27,6 +27,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <mutex>
 
 #ifdef WIN32
 #include <windows.h>
@@ -58,6 +59,8 @@ static std::string mLastCallDate;
  * from the last call date.
  */
 static std::string mOldDate;
+/** Keeps the lines logged by several threads apart. */
+static std::mutex mOutputMutex;
 
 /**
   * Check whether the day has changed since the last call.
@@ -155,6 +158,8 @@ void Logger::output(const std::string &msg, Level atVerbosity)
             "[DBG]"
         };
 
+        std::lock_guard<std::mutex> lock(mOutputMutex);
+
         bool open = mLogFile.is_open();
 
         if (open)
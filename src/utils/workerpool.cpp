@@ -0,0 +1,135 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/workerpool.h"
+
+namespace utils
+{
+
+WorkerPool::WorkerPool():
+    mJob(nullptr),
+    mNextIndex(0),
+    mCount(0),
+    mPending(0),
+    mBatch(0),
+    mQuit(false)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    stopThreads();
+}
+
+void WorkerPool::setThreadCount(unsigned count)
+{
+    if (count < 1)
+        count = 1;
+
+    if (count == getThreadCount())
+        return;
+
+    stopThreads();
+
+    mQuit = false;
+    for (unsigned i = 1; i < count; ++i)
+        mThreads.push_back(std::thread(&WorkerPool::workerLoop, this));
+}
+
+void WorkerPool::stopThreads()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWakeUp.notify_all();
+
+    for (std::vector<std::thread>::iterator it = mThreads.begin(),
+         it_end = mThreads.end(); it != it_end; ++it)
+    {
+        it->join();
+    }
+    mThreads.clear();
+}
+
+void WorkerPool::run(unsigned count, const Job &job)
+{
+    if (count == 0)
+        return;
+
+    // No need to involve the other threads when there is nothing to share.
+    if (mThreads.empty() || count == 1)
+    {
+        for (unsigned i = 0; i < count; ++i)
+            job(i);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mJob = &job;
+    mNextIndex = 0;
+    mCount = count;
+    mPending = count;
+    ++mBatch;
+    mWakeUp.notify_all();
+
+    work(lock);
+
+    while (mPending > 0)
+        mDone.wait(lock);
+
+    mJob = nullptr;
+}
+
+void WorkerPool::work(std::unique_lock<std::mutex> &lock)
+{
+    while (mNextIndex < mCount)
+    {
+        const unsigned index = mNextIndex++;
+        const Job &job = *mJob;
+
+        lock.unlock();
+        job(index);
+        lock.lock();
+
+        if (--mPending == 0)
+            mDone.notify_all();
+    }
+}
+
+void WorkerPool::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    unsigned lastBatch = mBatch;
+
+    while (true)
+    {
+        while (!mQuit && (mBatch == lastBatch || mNextIndex >= mCount))
+            mWakeUp.wait(lock);
+
+        if (mQuit)
+            return;
+
+        lastBatch = mBatch;
+        work(lock);
+    }
+}
+
+} // namespace utils
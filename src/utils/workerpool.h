@@ -0,0 +1,90 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils
+{
+
+/**
+ * A fixed set of threads used to run independent jobs of a batch in
+ * parallel. The calling thread takes part in the work, so a pool of one
+ * thread simply runs the jobs in order on the caller.
+ */
+class WorkerPool
+{
+    public:
+        typedef std::function<void(unsigned)> Job;
+
+        WorkerPool();
+        ~WorkerPool();
+
+        /**
+         * Changes the amount of threads used to run jobs, including the
+         * calling thread. Values below 1 are treated as 1.
+         */
+        void setThreadCount(unsigned count);
+
+        unsigned getThreadCount() const
+        { return mThreads.size() + 1; }
+
+        /**
+         * Calls \a job once for each index in [0, count) and returns when all
+         * calls have finished. The order in which the indices are handed out
+         * is unspecified when more than one thread is used.
+         */
+        void run(unsigned count, const Job &job);
+
+    private:
+        WorkerPool(const WorkerPool &);
+        WorkerPool &operator=(const WorkerPool &);
+
+        void stopThreads();
+        void workerLoop();
+
+        /**
+         * Runs jobs of the current batch until none are left. Must be called
+         * with the lock held.
+         */
+        void work(std::unique_lock<std::mutex> &lock);
+
+        std::vector<std::thread> mThreads;
+        std::mutex mMutex;
+        std::condition_variable mWakeUp;    /**< Signals a new batch. */
+        std::condition_variable mDone;      /**< Signals a finished batch. */
+
+        const Job *mJob;            /**< Job of the current batch. */
+        unsigned mNextIndex;        /**< Next index to hand out. */
+        unsigned mCount;            /**< Size of the current batch. */
+        unsigned mPending;          /**< Jobs not finished yet. */
+        unsigned mBatch;            /**< Identifies the current batch. */
+        bool mQuit;
+};
+
+} // namespace utils
+
+#endif // WORKERPOOL_H